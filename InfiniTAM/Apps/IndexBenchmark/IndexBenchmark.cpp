@@ -0,0 +1,165 @@
+// Copyright 2014-2017 Oxford University Innovation Limited and the authors of InfiniTAM
+
+#include <cstdlib>
+#include <iostream>
+
+#include "../../InputSource/ImageSourceEngine.h"
+
+#include "../../ITMLib/ITMLibDefines.h"
+#include "../../ITMLib/Core/ITMBasicEngine.h"
+#include "../../ITMLib/Engines/Reconstruction/CPU/ITMSceneReconstructionEngine_CPU.tpp"
+#include "../../ITMLib/Engines/Visualisation/CPU/ITMVisualisationEngine_CPU.tpp"
+#include "../../ITMLib/Objects/RenderStates/ITMRenderStateFactory.h"
+
+#include "../../ORUtils/NVTimer.h"
+
+using namespace InputSource;
+using namespace ITMLib;
+
+/** \brief
+	Replays a recorded sequence into a scene with the given index
+	and times the stages whose cost is dominated by hash lookups:
+	allocation, integration and raycasting. The poses come from the
+	main engine, so all indices see exactly the same input.
+*/
+template<class TIndex>
+class IndexBenchmark
+{
+private:
+	const char *name;
+
+	ITMScene<ITMVoxel, TIndex> *scene;
+	ITMSceneReconstructionEngine_CPU<ITMVoxel, TIndex> *sceneRecoEngine;
+	ITMVisualisationEngine_CPU<ITMVoxel, TIndex> *visualisationEngine;
+
+	ITMRenderState *renderState;
+	ITMTrackingState *trackingState;
+
+	StopWatchInterface *timer_allocation, *timer_integration, *timer_raycast;
+
+public:
+	IndexBenchmark(const char *name, const ITMLibSettings *settings, const Vector2i & imgSize_d)
+	{
+		this->name = name;
+
+		scene = new ITMScene<ITMVoxel, TIndex>(&settings->sceneParams, false, MEMORYDEVICE_CPU);
+		sceneRecoEngine = new ITMSceneReconstructionEngine_CPU<ITMVoxel, TIndex>(&settings->sceneParams);
+		visualisationEngine = new ITMVisualisationEngine_CPU<ITMVoxel, TIndex>();
+
+		renderState = ITMRenderStateFactory<TIndex>::CreateRenderState(imgSize_d, &settings->sceneParams, MEMORYDEVICE_CPU);
+		trackingState = new ITMTrackingState(imgSize_d, MEMORYDEVICE_CPU);
+
+		sceneRecoEngine->ResetScene(scene);
+
+		sdkCreateTimer(&timer_allocation);
+		sdkCreateTimer(&timer_integration);
+		sdkCreateTimer(&timer_raycast);
+	}
+
+	~IndexBenchmark(void)
+	{
+		sdkDeleteTimer(&timer_allocation);
+		sdkDeleteTimer(&timer_integration);
+		sdkDeleteTimer(&timer_raycast);
+
+		delete trackingState;
+		delete renderState;
+		delete visualisationEngine;
+		delete sceneRecoEngine;
+		delete scene;
+	}
+
+	void ProcessFrame(const ITMView *view, const ORUtils::SE3Pose *pose)
+	{
+		trackingState->pose_d->SetFrom(pose);
+
+		sdkStartTimer(&timer_allocation);
+		sceneRecoEngine->AllocateSceneFromDepth(scene, view, trackingState, renderState);
+		sdkStopTimer(&timer_allocation);
+
+		sdkStartTimer(&timer_integration);
+		sceneRecoEngine->IntegrateIntoScene(scene, view, trackingState, renderState);
+		sdkStopTimer(&timer_integration);
+
+		sdkStartTimer(&timer_raycast);
+		visualisationEngine->CreateExpectedDepths(scene, trackingState->pose_d, &(view->calib.intrinsics_d), renderState);
+		visualisationEngine->CreateICPMaps(scene, view, trackingState, renderState);
+		sdkStopTimer(&timer_raycast);
+	}
+
+	void PrintResults(void)
+	{
+		int noAllocatedBlocks = 0;
+		const typename TIndex::IndexData *hashTable = scene->index.GetEntries();
+		for (int entryId = 0; entryId < scene->index.noTotalEntries; entryId++)
+			if (hashTable[entryId].ptr >= 0) noAllocatedBlocks++;
+
+		printf("%-24s blocks %7d  allocation %8.3f ms  integration %8.3f ms  raycast %8.3f ms\n", name, noAllocatedBlocks,
+			sdkGetAverageTimerValue(&timer_allocation), sdkGetAverageTimerValue(&timer_integration), sdkGetAverageTimerValue(&timer_raycast));
+	}
+};
+
+int main(int argc, char** argv)
+try
+{
+	if (argc < 4)
+	{
+		printf("usage: %s <calibfile> <rgbmask> <depthmask> [<maxframes>]\n"
+		       "  replays a recorded sequence and compares the per frame cost of the\n"
+		       "  voxel block hash indices on the CPU\n"
+		       "\n"
+		       "example:\n"
+		       "  %s ./Files/Teddy/calib.txt ./Files/Teddy/Frames/%%04i.ppm ./Files/Teddy/Frames/%%04i.pgm\n\n", argv[0], argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	int maxFrames = argc > 4 ? atoi(argv[4]) : -1;
+
+	ITMLibSettings *internalSettings = new ITMLibSettings();
+	internalSettings->deviceType = ITMLibSettings::DEVICE_CPU;
+	internalSettings->createMeshingEngine = false;
+
+	ImageMaskPathGenerator pathGenerator(argv[2], argv[3]);
+	ImageSourceEngine *imageSource = new ImageFileReader<ImageMaskPathGenerator>(argv[1], pathGenerator);
+
+	Vector2i imgSize_rgb = imageSource->getRGBImageSize(), imgSize_d = imageSource->getDepthImageSize();
+
+	// the main engine tracks the camera, the benchmarks only reconstruct and raycast
+	ITMBasicEngine<ITMVoxel, ITMVoxelIndex> *mainEngine = new ITMBasicEngine<ITMVoxel, ITMVoxelIndex>(
+		internalSettings, imageSource->getCalib(), imgSize_rgb, imgSize_d
+	);
+
+	IndexBenchmark<ITMVoxelBlockHash> benchmark_hash("ITMVoxelBlockHash", internalSettings, imgSize_d);
+	IndexBenchmark<ITMVoxelBlockProbingHash> benchmark_probing("ITMVoxelBlockProbingHash", internalSettings, imgSize_d);
+
+	ITMUChar4Image *inputRGBImage = new ITMUChar4Image(imgSize_rgb, true, false);
+	ITMShortImage *inputRawDepthImage = new ITMShortImage(imgSize_d, true, false);
+
+	int currentFrameNo = 0;
+	while (imageSource->hasMoreImages() && currentFrameNo != maxFrames)
+	{
+		imageSource->getImages(inputRGBImage, inputRawDepthImage);
+		mainEngine->ProcessFrame(inputRGBImage, inputRawDepthImage);
+
+		benchmark_hash.ProcessFrame(mainEngine->GetView(), mainEngine->GetTrackingState()->pose_d);
+		benchmark_probing.ProcessFrame(mainEngine->GetView(), mainEngine->GetTrackingState()->pose_d);
+
+		currentFrameNo++;
+	}
+
+	printf("average over %d frames:\n", currentFrameNo);
+	benchmark_hash.PrintResults();
+	benchmark_probing.PrintResults();
+
+	delete inputRawDepthImage;
+	delete inputRGBImage;
+	delete mainEngine;
+	delete internalSettings;
+	delete imageSource;
+	return 0;
+}
+catch(std::exception& e)
+{
+	std::cerr << e.what() << '\n';
+	return EXIT_FAILURE;
+}
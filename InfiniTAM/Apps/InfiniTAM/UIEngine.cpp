@@ -117,11 +117,11 @@ void UIEngine::glutDisplayFunction()
 	glColor3f(1.0f, 0.0f, 0.0f); glRasterPos2f(-0.98f, -0.95f);
 	if (uiEngine->freeviewActive)
 	{
-		sprintf(str, "n: one frame \t b: continous \t e/esc: exit \t r: reset \t k: save \t l: load \t f: follow camera \t c: colours (currently %s) \t t: turn fusion %s", uiEngine->colourModes_freeview[uiEngine->currentColourMode].name, uiEngine->integrationActive ? "off" : "on");
+		sprintf(str, "n: one frame \t b: continous \t e/esc: exit \t r: reset \t k: save \t j: checkpoint \t l: load \t f: follow camera \t c: colours (currently %s) \t t: turn fusion %s", uiEngine->colourModes_freeview[uiEngine->currentColourMode].name, uiEngine->integrationActive ? "off" : "on");
 	}
 	else
 	{
-		sprintf(str, "n: one frame \t b: continous \t e/esc: exit \t r: reset \t k: save \t l: load \t f: free viewpoint \t c: colours (currently %s) \t t: turn fusion %s", uiEngine->colourModes_main[uiEngine->currentColourMode].name, uiEngine->integrationActive ? "off" : "on");
+		sprintf(str, "n: one frame \t b: continous \t e/esc: exit \t r: reset \t k: save \t j: checkpoint \t l: load \t f: free viewpoint \t c: colours (currently %s) \t t: turn fusion %s", uiEngine->colourModes_main[uiEngine->currentColourMode].name, uiEngine->integrationActive ? "off" : "on");
 	}
 	safe_glutBitmapString(GLUT_BITMAP_HELVETICA_12, (const char*)str);
 
@@ -322,6 +322,21 @@ void UIEngine::glutKeyUpFunction(unsigned char key, int x, int y)
 		}
 	}
 	break;
+	case 'j':
+	{
+		printf("saving scene changes to disk ... ");
+
+		try
+		{
+			uiEngine->mainEngine->SaveCheckpoint();
+			printf("done\n");
+		}
+		catch (const std::runtime_error &e)
+		{
+			printf("failed: %s\n", e.what());
+		}
+	}
+	break;
 	case 'l':
 	{
 		printf("loading scene from disk ... ");
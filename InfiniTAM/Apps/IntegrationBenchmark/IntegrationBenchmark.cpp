@@ -0,0 +1,251 @@
+// Copyright 2014-2017 Oxford University Innovation Limited and the authors of InfiniTAM
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+#include "../../InputSource/ImageSourceEngine.h"
+
+#include "../../ITMLib/ITMLibDefines.h"
+#include "../../ITMLib/Core/ITMBasicEngine.h"
+#include "../../ITMLib/Engines/Reconstruction/CPU/ITMSceneReconstructionEngine_CPU.tpp"
+#include "../../ITMLib/Objects/RenderStates/ITMRenderStateFactory.h"
+
+#include "../../ORUtils/NVTimer.h"
+
+using namespace InputSource;
+using namespace ITMLib;
+
+/** \brief
+	Replays a recorded sequence into two identical scenes and times
+	the fusion of the depth images: once with the scalar reference
+	loop, which calls ComputeUpdatedVoxelInfo for every voxel, and
+	once with IntegrateIntoScene, which uses ITMVoxelRowIntegrator
+	where the voxel type and the instruction set allow it. The two
+	scenes are compared voxel by voxel at the end. They agree up to
+	rounding, so the number of differing voxels and the largest
+	divergence of their sdf and weight are reported.
+*/
+template<class TVoxel>
+class IntegrationBenchmark
+{
+private:
+	const char *name;
+
+	ITMScene<TVoxel, ITMVoxelBlockHash> *scene_reference, *scene_engine;
+	ITMSceneReconstructionEngine_CPU<TVoxel, ITMVoxelBlockHash> *sceneRecoEngine;
+
+	ITMRenderState *renderState_reference, *renderState_engine;
+	ITMTrackingState *trackingState;
+
+	StopWatchInterface *timer_reference, *timer_engine;
+
+	/** Same loop as ITMSceneReconstructionEngine_CPU::IntegrateIntoScene, one voxel at a time. */
+	void IntegrateReference(const ITMView *view)
+	{
+		ITMScene<TVoxel, ITMVoxelBlockHash> *scene = scene_reference;
+		ITMRenderState_VH *renderState_vh = (ITMRenderState_VH*)renderState_reference;
+
+		Vector2i rgbImgSize = view->rgb->noDims;
+		Vector2i depthImgSize = view->depth->noDims;
+		float voxelSize = scene->sceneParams->voxelSize;
+
+		Matrix4f M_d = trackingState->pose_d->GetM(), M_rgb;
+		if (TVoxel::hasColorInformation) M_rgb = view->calib.trafo_rgb_to_depth.calib_inv * M_d;
+
+		Vector4f projParams_d = view->calib.intrinsics_d.projectionParamsSimple.all;
+		Vector4f projParams_rgb = view->calib.intrinsics_rgb.projectionParamsSimple.all;
+
+		float mu = scene->sceneParams->mu; int maxW = scene->sceneParams->maxW;
+		bool stopIntegratingAtMaxW = scene->sceneParams->stopIntegratingAtMaxW;
+
+		float *depth = view->depth->GetData(MEMORYDEVICE_CPU);
+		float *confidence = view->depthConfidence->GetData(MEMORYDEVICE_CPU);
+		Vector4u *rgb = view->rgb->GetData(MEMORYDEVICE_CPU);
+		TVoxel *localVBA = scene->localVBA.GetVoxelBlocks();
+		ITMHashEntry *hashTable = scene->index.GetEntries();
+
+		int *visibleEntryIds = renderState_vh->GetVisibleEntryIDs();
+		int noVisibleEntries = renderState_vh->noVisibleEntries;
+
+		for (int entryId = 0; entryId < noVisibleEntries; entryId++)
+		{
+			const ITMHashEntry &currentHashEntry = hashTable[visibleEntryIds[entryId]];
+			if (currentHashEntry.ptr < 0) continue;
+
+			Vector3i globalPos = currentHashEntry.pos.toInt() * SDF_BLOCK_SIZE;
+			TVoxel *localVoxelBlock = &(localVBA[currentHashEntry.ptr * (SDF_BLOCK_SIZE3)]);
+
+			for (int z = 0; z < SDF_BLOCK_SIZE; z++) for (int y = 0; y < SDF_BLOCK_SIZE; y++) for (int x = 0; x < SDF_BLOCK_SIZE; x++)
+			{
+				int locId = voxelIdInBlock(x, y, z);
+
+				if (stopIntegratingAtMaxW) if (localVoxelBlock[locId].w_depth == maxW) continue;
+
+				Vector4f pt_model((float)(globalPos.x + x) * voxelSize, (float)(globalPos.y + y) * voxelSize, (float)(globalPos.z + z) * voxelSize, 1.0f);
+
+				ComputeUpdatedVoxelInfo<TVoxel::hasColorInformation, TVoxel::hasConfidenceInformation, TVoxel>::compute(localVoxelBlock[locId], pt_model, M_d,
+					projParams_d, M_rgb, projParams_rgb, mu, maxW, depth, confidence, depthImgSize, rgb, rgbImgSize);
+			}
+		}
+	}
+
+public:
+	IntegrationBenchmark(const char *name, const ITMLibSettings *settings, const Vector2i & imgSize_d)
+	{
+		this->name = name;
+
+		scene_reference = new ITMScene<TVoxel, ITMVoxelBlockHash>(&settings->sceneParams, false, MEMORYDEVICE_CPU);
+		scene_engine = new ITMScene<TVoxel, ITMVoxelBlockHash>(&settings->sceneParams, false, MEMORYDEVICE_CPU);
+		sceneRecoEngine = new ITMSceneReconstructionEngine_CPU<TVoxel, ITMVoxelBlockHash>(&settings->sceneParams);
+
+		renderState_reference = ITMRenderStateFactory<ITMVoxelBlockHash>::CreateRenderState(imgSize_d, &settings->sceneParams, MEMORYDEVICE_CPU);
+		renderState_engine = ITMRenderStateFactory<ITMVoxelBlockHash>::CreateRenderState(imgSize_d, &settings->sceneParams, MEMORYDEVICE_CPU);
+		trackingState = new ITMTrackingState(imgSize_d, MEMORYDEVICE_CPU);
+
+		sceneRecoEngine->ResetScene(scene_reference);
+		sceneRecoEngine->ResetScene(scene_engine);
+
+		sdkCreateTimer(&timer_reference);
+		sdkCreateTimer(&timer_engine);
+	}
+
+	~IntegrationBenchmark(void)
+	{
+		sdkDeleteTimer(&timer_reference);
+		sdkDeleteTimer(&timer_engine);
+
+		delete trackingState;
+		delete renderState_engine;
+		delete renderState_reference;
+		delete sceneRecoEngine;
+		delete scene_engine;
+		delete scene_reference;
+	}
+
+	void ProcessFrame(const ITMView *view, const ORUtils::SE3Pose *pose)
+	{
+		trackingState->pose_d->SetFrom(pose);
+
+		// both scenes see the same input, so they allocate the same blocks
+		sceneRecoEngine->AllocateSceneFromDepth(scene_reference, view, trackingState, renderState_reference);
+		sceneRecoEngine->AllocateSceneFromDepth(scene_engine, view, trackingState, renderState_engine);
+
+		sdkStartTimer(&timer_reference);
+		IntegrateReference(view);
+		sdkStopTimer(&timer_reference);
+
+		sdkStartTimer(&timer_engine);
+		sceneRecoEngine->IntegrateIntoScene(scene_engine, view, trackingState, renderState_engine);
+		sdkStopTimer(&timer_engine);
+	}
+
+	void PrintResults(void)
+	{
+		const ITMHashEntry *hashTable_reference = scene_reference->index.GetEntries();
+		const ITMHashEntry *hashTable_engine = scene_engine->index.GetEntries();
+		const TVoxel *localVBA_reference = scene_reference->localVBA.GetVoxelBlocks();
+		const TVoxel *localVBA_engine = scene_engine->localVBA.GetVoxelBlocks();
+
+		int noAllocatedBlocks = 0, noMismatchedBlocks = 0, noDifferentVoxels = 0, maxWeightDifference = 0;
+		float maxSdfDifference = 0.0f;
+		for (int entryId = 0; entryId < scene_reference->index.noTotalEntries; entryId++)
+		{
+			const ITMHashEntry &entry_reference = hashTable_reference[entryId], &entry_engine = hashTable_engine[entryId];
+			if (entry_reference.ptr < 0) continue;
+			noAllocatedBlocks++;
+
+			if (entry_engine.ptr != entry_reference.ptr || entry_engine.pos != entry_reference.pos) { noMismatchedBlocks++; continue; }
+
+			const TVoxel *voxelBlock_reference = &localVBA_reference[entry_reference.ptr * SDF_BLOCK_SIZE3];
+			const TVoxel *voxelBlock_engine = &localVBA_engine[entry_engine.ptr * SDF_BLOCK_SIZE3];
+			for (int locId = 0; locId < SDF_BLOCK_SIZE3; locId++)
+			{
+				const TVoxel &voxel_reference = voxelBlock_reference[locId], &voxel_engine = voxelBlock_engine[locId];
+				if (voxel_reference.sdf == voxel_engine.sdf && voxel_reference.w_depth == voxel_engine.w_depth) continue;
+
+				noDifferentVoxels++;
+				maxSdfDifference = MAX(maxSdfDifference, fabsf(TVoxel::valueToFloat(voxel_reference.sdf) - TVoxel::valueToFloat(voxel_engine.sdf)));
+				maxWeightDifference = MAX(maxWeightDifference, abs((int)voxel_reference.w_depth - (int)voxel_engine.w_depth));
+			}
+		}
+
+		float time_reference = sdkGetAverageTimerValue(&timer_reference), time_engine = sdkGetAverageTimerValue(&timer_engine);
+		printf("%-12s %-10s blocks %7d  reference %8.3f ms  engine %8.3f ms  speedup %5.2fx  different voxels %d (largest divergence: sdf %g, weight %d)\n", name,
+			ITMVoxelRowIntegrator<TVoxel>::isVectorised ? "vectorised" : "scalar", noAllocatedBlocks, time_reference, time_engine,
+			time_reference / time_engine, noDifferentVoxels, maxSdfDifference, maxWeightDifference);
+
+		if (noMismatchedBlocks > 0) printf("%-12s %d blocks were allocated differently and not compared\n", name, noMismatchedBlocks);
+	}
+};
+
+int main(int argc, char** argv)
+try
+{
+	if (argc < 4)
+	{
+		printf("usage: %s <calibfile> <rgbmask> <depthmask> [<maxframes>]\n"
+		       "  replays a recorded sequence and compares the per frame cost of the\n"
+		       "  scalar and the vectorised TSDF integration on the CPU\n"
+		       "\n"
+		       "example:\n"
+		       "  %s ./Files/Teddy/calib.txt ./Files/Teddy/Frames/%%04i.ppm ./Files/Teddy/Frames/%%04i.pgm\n\n", argv[0], argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	int maxFrames = argc > 4 ? atoi(argv[4]) : -1;
+
+	ITMLibSettings *internalSettings = new ITMLibSettings();
+	internalSettings->deviceType = ITMLibSettings::DEVICE_CPU;
+	internalSettings->createMeshingEngine = false;
+
+	ImageMaskPathGenerator pathGenerator(argv[2], argv[3]);
+	ImageSourceEngine *imageSource = new ImageFileReader<ImageMaskPathGenerator>(argv[1], pathGenerator);
+
+	Vector2i imgSize_rgb = imageSource->getRGBImageSize(), imgSize_d = imageSource->getDepthImageSize();
+
+	// the main engine tracks the camera, the benchmarks only fuse the depth images
+	ITMBasicEngine<ITMVoxel, ITMVoxelIndex> *mainEngine = new ITMBasicEngine<ITMVoxel, ITMVoxelIndex>(
+		internalSettings, imageSource->getCalib(), imgSize_rgb, imgSize_d
+	);
+
+	IntegrationBenchmark<ITMVoxel_s> benchmark_short("ITMVoxel_s", internalSettings, imgSize_d);
+	IntegrationBenchmark<ITMVoxel_f> benchmark_float("ITMVoxel_f", internalSettings, imgSize_d);
+	IntegrationBenchmark<ITMVoxel_u8> benchmark_u8("ITMVoxel_u8", internalSettings, imgSize_d);
+	IntegrationBenchmark<ITMVoxel_h> benchmark_half("ITMVoxel_h", internalSettings, imgSize_d);
+
+	ITMUChar4Image *inputRGBImage = new ITMUChar4Image(imgSize_rgb, true, false);
+	ITMShortImage *inputRawDepthImage = new ITMShortImage(imgSize_d, true, false);
+
+	int currentFrameNo = 0;
+	while (imageSource->hasMoreImages() && currentFrameNo != maxFrames)
+	{
+		imageSource->getImages(inputRGBImage, inputRawDepthImage);
+		mainEngine->ProcessFrame(inputRGBImage, inputRawDepthImage);
+
+		benchmark_short.ProcessFrame(mainEngine->GetView(), mainEngine->GetTrackingState()->pose_d);
+		benchmark_float.ProcessFrame(mainEngine->GetView(), mainEngine->GetTrackingState()->pose_d);
+		benchmark_u8.ProcessFrame(mainEngine->GetView(), mainEngine->GetTrackingState()->pose_d);
+		benchmark_half.ProcessFrame(mainEngine->GetView(), mainEngine->GetTrackingState()->pose_d);
+
+		currentFrameNo++;
+	}
+
+	printf("average over %d frames:\n", currentFrameNo);
+	benchmark_short.PrintResults();
+	benchmark_float.PrintResults();
+	benchmark_u8.PrintResults();
+	benchmark_half.PrintResults();
+
+	delete inputRawDepthImage;
+	delete inputRGBImage;
+	delete mainEngine;
+	delete internalSettings;
+	delete imageSource;
+	return 0;
+}
+catch(std::exception& e)
+{
+	std::cerr << e.what() << '\n';
+	return EXIT_FAILURE;
+}
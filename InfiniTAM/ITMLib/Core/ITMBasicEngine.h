@@ -3,6 +3,7 @@
 #pragma once
 
 #include "ITMDenseMapper.h"
+#include "ITMFusionGate.h"
 #include "ITMMainEngine.h"
 #include "ITMTrackingController.h"
 #include "../Engines/LowLevel/Interface/ITMLowLevelEngine.h"
@@ -10,6 +11,7 @@
 #include "../Engines/ViewBuilding/Interface/ITMViewBuilder.h"
 #include "../Engines/Visualisation/Interface/ITMVisualisationEngine.h"
 #include "../Objects/Misc/ITMIMUCalibrator.h"
+#include "../Objects/Scene/ITMSceneStatistics.h"
 
 #include "../../FernRelocLib/Relocaliser.h"
 
@@ -32,6 +34,7 @@ namespace ITMLib
 		ITMViewBuilder *viewBuilder;
 		ITMDenseMapper<TVoxel, TIndex> *denseMapper;
 		ITMTrackingController *trackingController;
+		ITMFusionGate *fusionGate;
 
 		ITMScene<TVoxel, TIndex> *scene;
 		ITMRenderState *renderState_live;
@@ -65,6 +68,13 @@ namespace ITMLib
 		void SaveToFile();
 		void LoadFromFile();
 
+		/// appends the blocks changed or removed since the last save or checkpoint to the state saved by SaveToFile,
+		/// or saves the full state again if these changes are no longer known, e.g. after a reset
+		void SaveCheckpoint();
+
+		/// computes the fill state of the scene index and of the local voxel block array
+		void GetHashStatistics(ITMHashStatistics &stats) const;
+
 		/// Get a result image as output
 		Vector2i GetImageSize(void) const;
 
@@ -7,6 +7,8 @@
 #include "../Engines/ViewBuilding/ITMViewBuilderFactory.h"
 #include "../Engines/Visualisation/ITMVisualisationEngineFactory.h"
 #include "../Objects/RenderStates/ITMRenderStateFactory.h"
+#include "../Objects/RenderStates/ITMRenderState_VH.h"
+#include "../Objects/Scene/ITMSceneSnapshot.h"
 #include "../Trackers/ITMTrackerFactory.h"
 
 #include "../../ORUtils/NVTimer.h"
@@ -34,7 +36,7 @@ ITMBasicEngine<TVoxel,TIndex>::ITMBasicEngine(const ITMLibSettings *settings, co
 
 	meshingEngine = NULL;
 	if (settings->createMeshingEngine)
-		meshingEngine = ITMMeshingEngineFactory::MakeMeshingEngine<TVoxel,TIndex>(deviceType);
+		meshingEngine = ITMMeshingEngineFactory::MakeMeshingEngine<TVoxel,TIndex>(deviceType, &settings->sceneParams);
 
 	denseMapper = new ITMDenseMapper<TVoxel,TIndex>(settings);
 	denseMapper->ResetScene(scene);
@@ -43,6 +45,8 @@ ITMBasicEngine<TVoxel,TIndex>::ITMBasicEngine(const ITMLibSettings *settings, co
 	tracker = ITMTrackerFactory::Instance().Make(imgSize_rgb, imgSize_d, settings, lowLevelEngine, imuCalibrator, scene->sceneParams);
 	trackingController = new ITMTrackingController(tracker, settings);
 
+	fusionGate = settings->useMotionGatedFusion ? new ITMFusionGate(settings) : NULL;
+
 	Vector2i trackedImageSize = trackingController->GetTrackedImageSize(imgSize_rgb, imgSize_d);
 
 	renderState_live = ITMRenderStateFactory<TIndex>::CreateRenderState(trackedImageSize, scene->sceneParams, memoryType);
@@ -77,6 +81,7 @@ ITMBasicEngine<TVoxel,TIndex>::~ITMBasicEngine()
 
 	delete denseMapper;
 	delete trackingController;
+	delete fusionGate;
 
 	delete tracker;
 	delete imuCalibrator;
@@ -100,7 +105,7 @@ void ITMBasicEngine<TVoxel,TIndex>::SaveSceneToMesh(const char *objFileName)
 {
 	if (meshingEngine == NULL) return;
 
-	ITMMesh *mesh = new ITMMesh(settings->GetMemoryType());
+	ITMMesh *mesh = new ITMMesh(settings->GetMemoryType(), ITMMesh::GetDefaultMaxTriangles(settings->sceneParams.localBlockNum));
 
 	meshingEngine->MeshScene(mesh, scene);
 	mesh->WriteSTL(objFileName);
@@ -108,6 +113,20 @@ void ITMBasicEngine<TVoxel,TIndex>::SaveSceneToMesh(const char *objFileName)
 	delete mesh;
 }
 
+/** Whether ITMSceneSnapshot supports the index, which is only the case for the voxel block hash. */
+template <typename TIndex>
+static inline bool IndexSupportsSnapshots(const TIndex &index) { return false; }
+
+static inline bool IndexSupportsSnapshots(const ITMVoxelBlockHash &index) { return true; }
+
+/** Voxel block hash scenes in host memory are saved as a snapshot of the allocated blocks, the others as a dump of all arrays. */
+template <typename TVoxel, typename TIndex>
+static bool UsesSceneSnapshots(const ITMScene<TVoxel, TIndex> *scene, const ITMLibSettings *settings)
+{
+	// snapshots hold the voxel blocks only, so a separate colour stream needs the dump as well
+	return IndexSupportsSnapshots(scene->index) && settings->GetMemoryType() == MEMORYDEVICE_CPU && !TVoxel::hasSeparateColourInformation;
+}
+
 template <typename TVoxel, typename TIndex>
 void ITMBasicEngine<TVoxel, TIndex>::SaveToFile()
 {
@@ -115,14 +134,55 @@ void ITMBasicEngine<TVoxel, TIndex>::SaveToFile()
 
 	std::string saveOutputDirectory = "State/";
 	std::string relocaliserOutputDirectory = saveOutputDirectory + "Relocaliser/", sceneOutputDirectory = saveOutputDirectory + "Scene/";
+	std::string sceneSnapshotFileName = saveOutputDirectory + "scene.snap", sceneLogFileName = saveOutputDirectory + "scene.log";
 	
 	MakeDir(saveOutputDirectory.c_str());
 	MakeDir(relocaliserOutputDirectory.c_str());
-	MakeDir(sceneOutputDirectory.c_str());
 
 	if (relocaliser) relocaliser->SaveToDirectory(relocaliserOutputDirectory);
 
-	scene->SaveToDirectory(sceneOutputDirectory);
+	if (UsesSceneSnapshots(scene, settings))
+	{
+		ITMSceneSnapshot<TVoxel, TIndex>::SaveToFile(scene, sceneSnapshotFileName);
+
+		// the new snapshot supersedes all earlier checkpoints
+		remove(sceneLogFileName.c_str());
+	}
+	else
+	{
+		MakeDir(sceneOutputDirectory.c_str());
+		scene->SaveToDirectory(sceneOutputDirectory);
+	}
+}
+
+template <typename TVoxel, typename TIndex>
+void ITMBasicEngine<TVoxel, TIndex>::SaveCheckpoint()
+{
+	std::string saveOutputDirectory = "State/";
+	std::string sceneSnapshotFileName = saveOutputDirectory + "scene.snap", sceneLogFileName = saveOutputDirectory + "scene.log";
+
+	// checkpoints need a snapshot to apply to
+	if (!UsesSceneSnapshots(scene, settings) || !std::ifstream(sceneSnapshotFileName.c_str()).good())
+	{
+		SaveToFile();
+		return;
+	}
+
+	// once the changes are lost, e.g. after a reset, only a new snapshot can bring the saved state up to date
+	if (ITMSceneSnapshot<TVoxel, TIndex>::AppendToLog(scene, sceneLogFileName) < 0)
+	{
+		SaveToFile();
+		return;
+	}
+
+	// once the log outgrows the snapshot, loading it costs more than rewriting the snapshot
+	std::ifstream snapshotFile(sceneSnapshotFileName.c_str(), std::ios::binary | std::ios::ate);
+	std::ifstream logFile(sceneLogFileName.c_str(), std::ios::binary | std::ios::ate);
+	if (logFile.tellg() > snapshotFile.tellg())
+	{
+		snapshotFile.close(); logFile.close();
+		ITMSceneSnapshot<TVoxel, TIndex>::CompactFiles(sceneSnapshotFileName, sceneLogFileName);
+	}
 }
 
 template <typename TVoxel, typename TIndex>
@@ -130,6 +190,7 @@ void ITMBasicEngine<TVoxel, TIndex>::LoadFromFile()
 {
 	std::string saveInputDirectory = "State/";
 	std::string relocaliserInputDirectory = saveInputDirectory + "Relocaliser/", sceneInputDirectory = saveInputDirectory + "Scene/";
+	std::string sceneSnapshotFileName = saveInputDirectory + "scene.snap", sceneLogFileName = saveInputDirectory + "scene.log";
 
 	////TODO: add factory for relocaliser and rebuild using config from relocaliserOutputDirectory + "config.txt"
 	////TODO: add proper management of case when scene load fails (keep old scene or also reset relocaliser)
@@ -152,7 +213,13 @@ void ITMBasicEngine<TVoxel, TIndex>::LoadFromFile()
 
 	try // load scene
 	{
-		scene->LoadFromDirectory(sceneInputDirectory);
+		if (UsesSceneSnapshots(scene, settings) && std::ifstream(sceneSnapshotFileName.c_str()).good())
+		{
+			// fold the checkpoints written since the snapshot into it first
+			if (std::ifstream(sceneLogFileName.c_str()).good()) ITMSceneSnapshot<TVoxel, TIndex>::CompactFiles(sceneSnapshotFileName, sceneLogFileName);
+			ITMSceneSnapshot<TVoxel, TIndex>::LoadFromFile(scene, sceneSnapshotFileName);
+		}
+		else scene->LoadFromDirectory(sceneInputDirectory);
 	}
 	catch (std::runtime_error &e)
 	{
@@ -166,6 +233,7 @@ void ITMBasicEngine<TVoxel,TIndex>::resetAll()
 {
 	denseMapper->ResetScene(scene);
 	trackingState->Reset();
+	if (fusionGate != NULL) fusionGate->Reset();
 }
 
 #ifdef OUTPUT_TRAJECTORY_QUATERNIONS
@@ -299,22 +367,28 @@ ITMTrackingState::TrackingResult ITMBasicEngine<TVoxel,TIndex>::ProcessFrame(ITM
 		}
 	}
 
-	bool didFusion = false;
+	bool didFusion = false, skippedFusion = false;
 	if ((trackerResult == ITMTrackingState::TRACKING_GOOD || !trackingInitialised) && (fusionActive) && (relocalisationCount == 0)) {
-		// fusion
-		denseMapper->ProcessFrame(view, trackingState, scene, renderState_live);
-		didFusion = true;
-		if (framesProcessed > 50) trackingInitialised = true;
+		if (fusionGate == NULL || fusionGate->RequiresFusion(view, trackingState))
+		{
+			// fusion
+			denseMapper->ProcessFrame(view, trackingState, scene, renderState_live);
+			didFusion = true;
+			if (fusionGate != NULL) fusionGate->SetFusedFrame(view, trackingState);
+			if (framesProcessed > 50) trackingInitialised = true;
 
-		framesProcessed++;
+			framesProcessed++;
+		}
+		else skippedFusion = true;
 	}
 
 	if (trackerResult == ITMTrackingState::TRACKING_GOOD || trackerResult == ITMTrackingState::TRACKING_POOR)
 	{
-		if (!didFusion) denseMapper->UpdateVisibleList(view, trackingState, scene, renderState_live);
+		if (!didFusion && !skippedFusion) denseMapper->UpdateVisibleList(view, trackingState, scene, renderState_live);
 
-		// raycast to renderState_live for tracking and free visualisation
-		trackingController->Prepare(trackingState, scene, view, visualisationEngine, renderState_live);
+		// raycast to renderState_live for tracking and free visualisation, the scene is unchanged
+		// and the camera close to the last raycast if the frame was not fused
+		if (!skippedFusion) trackingController->Prepare(trackingState, scene, view, visualisationEngine, renderState_live);
 
 		if (addKeyframeIdx >= 0)
 		{
@@ -326,6 +400,21 @@ ITMTrackingState::TrackingResult ITMBasicEngine<TVoxel,TIndex>::ProcessFrame(ITM
 	}
 	else *trackingState->pose_d = oldPose;
 
+	trackingState->StorePreviousPose();
+
+	if (settings->reportHashStatistics)
+	{
+		ITMHashStatistics stats;
+		GetHashStatistics(stats);
+
+		printf("hash: buckets %.1f%% (chain %d) excess %d/%d blocks %d/%d (swapped out %d) visible %d dropped %d (total %d)",
+			stats.bucketLoadFactor * 100.0f, stats.longestChain, stats.noUsedExcessEntries, stats.excessListSize,
+			stats.noUsedLocalBlocks, stats.noLocalBlocks, stats.noSwappedOutBlocks, stats.noVisibleBlocks,
+			stats.noDroppedAllocations, stats.noTotalDroppedAllocations);
+		if (stats.neighbourLinkBytes > 0) printf(" links %.1fMB", stats.neighbourLinkBytes / (1024.0f * 1024.0f));
+		printf("\n");
+	}
+
 #ifdef OUTPUT_TRAJECTORY_QUATERNIONS
 	const ORUtils::SE3Pose *p = trackingState->pose_d;
 	double t[3];
@@ -341,6 +430,15 @@ ITMTrackingState::TrackingResult ITMBasicEngine<TVoxel,TIndex>::ProcessFrame(ITM
     return trackerResult;
 }
 
+template <typename TVoxel, typename TIndex>
+void ITMBasicEngine<TVoxel,TIndex>::GetHashStatistics(ITMHashStatistics &stats) const
+{
+	ITMSceneStatistics<TVoxel, TIndex>::Compute(scene, stats);
+
+	const ITMRenderState_VH *renderState_vh = dynamic_cast<const ITMRenderState_VH*>(renderState_live);
+	if (renderState_vh != NULL) stats.noVisibleBlocks = renderState_vh->noVisibleEntries;
+}
+
 template <typename TVoxel, typename TIndex>
 Vector2i ITMBasicEngine<TVoxel,TIndex>::GetImageSize(void) const
 {
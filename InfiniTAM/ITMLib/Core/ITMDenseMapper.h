@@ -19,6 +19,8 @@ namespace ITMLib
 
 		ITMLibSettings::SwappingMode swappingMode;
 
+		int freeEmptyBlocksInterval, noProcessedFrames;
+
 	public:
 		void ResetScene(ITMScene<TVoxel,TIndex> *scene) const;
 
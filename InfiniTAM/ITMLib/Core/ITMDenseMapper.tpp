@@ -7,13 +7,25 @@
 #include "../Objects/RenderStates/ITMRenderState_VH.h"
 using namespace ITMLib;
 
+/** Links the blocks allocated in a frame to their neighbours if the index keeps such links, see ITMVoxelBlockHash::BuildNeighbourLinks(). */
+template<class TIndex>
+static inline void BuildNeighbourLinks(TIndex &index) {}
+
+static inline void BuildNeighbourLinks(ITMVoxelBlockHash &index)
+{
+	index.BuildNeighbourLinks();
+}
+
 template<class TVoxel, class TIndex>
 ITMDenseMapper<TVoxel, TIndex>::ITMDenseMapper(const ITMLibSettings *settings)
 {
-	sceneRecoEngine = ITMSceneReconstructionEngineFactory::MakeSceneReconstructionEngine<TVoxel,TIndex>(settings->deviceType);
-	swappingEngine = settings->swappingMode != ITMLibSettings::SWAPPINGMODE_DISABLED ? ITMSwappingEngineFactory::MakeSwappingEngine<TVoxel,TIndex>(settings->deviceType) : NULL;
+	sceneRecoEngine = ITMSceneReconstructionEngineFactory::MakeSceneReconstructionEngine<TVoxel,TIndex>(settings->deviceType, &settings->sceneParams);
+	swappingEngine = settings->swappingMode != ITMLibSettings::SWAPPINGMODE_DISABLED ? ITMSwappingEngineFactory::MakeSwappingEngine<TVoxel,TIndex>(settings->deviceType, &settings->sceneParams) : NULL;
 
 	swappingMode = settings->swappingMode;
+
+	freeEmptyBlocksInterval = settings->sceneParams.freeEmptyBlocksInterval;
+	noProcessedFrames = 0;
 }
 
 template<class TVoxel, class TIndex>
@@ -55,6 +67,13 @@ void ITMDenseMapper<TVoxel,TIndex>::ProcessFrame(const ITMView *view, const ITMT
 			break;
 		} 
 	}
+
+	// garbage collection: return blocks that hold no surface to the free lists
+	noProcessedFrames++;
+	if (freeEmptyBlocksInterval > 0 && noProcessedFrames % freeEmptyBlocksInterval == 0) sceneRecoEngine->FreeEmptyBlocks(scene, renderState);
+
+	// the raycast and meshing only read the neighbour links, so they are brought up to date here
+	BuildNeighbourLinks(scene->index);
 }
 
 template<class TVoxel, class TIndex>
@@ -0,0 +1,114 @@
+// Copyright 2014-2017 Oxford University Innovation Limited and the authors of InfiniTAM
+
+#pragma once
+
+#include <math.h>
+
+#include "../Objects/Tracking/ITMTrackingState.h"
+#include "../Objects/Views/ITMView.h"
+#include "../Utils/ITMLibSettings.h"
+
+namespace ITMLib
+{
+	/** \brief
+	    Decides whether a tracked frame is worth fusing into the scene.
+	    A frame is fused once the camera has moved or rotated by more
+	    than the thresholds in ITMLibSettings since the last fused frame,
+	    once enough of the depth image has changed, or after a maximum
+	    number of skipped frames. Frames from a still camera pointed at
+	    a still scene add no new information, so skipping them keeps
+	    the cost of an idle camera close to the cost of tracking.
+	*/
+	class ITMFusionGate
+	{
+	private:
+		const ITMLibSettings *settings;
+
+		ORUtils::SE3Pose lastFusedPose;
+		ITMFloatImage *lastFusedDepth;
+
+		int noSkippedFrames;
+		bool hasFusedFrame;
+
+		/** Returns whether more than @p maxFraction of the depth pixels appeared, vanished or moved by more than mu since the last fused frame. */
+		bool HasDepthChanged(const ITMFloatImage *depthImage, float maxFraction) const
+		{
+			const float *depth = depthImage->GetData(MEMORYDEVICE_CPU);
+			const float *lastDepth = lastFusedDepth->GetData(MEMORYDEVICE_CPU);
+			float mu = settings->sceneParams.mu;
+
+			int noPixels = (int)depthImage->dataSize;
+			int maxChangedPixels = (int)(maxFraction * noPixels), noChangedPixels = 0;
+
+			for (int locId = 0; locId < noPixels; locId++)
+			{
+				bool isValid = depth[locId] > 0.0f, wasValid = lastDepth[locId] > 0.0f;
+				if (isValid != wasValid || (isValid && fabs(depth[locId] - lastDepth[locId]) > mu))
+					if (++noChangedPixels > maxChangedPixels) return true;
+			}
+
+			return false;
+		}
+
+	public:
+		explicit ITMFusionGate(const ITMLibSettings *settings)
+		{
+			this->settings = settings;
+			lastFusedDepth = NULL;
+			Reset();
+		}
+
+		~ITMFusionGate(void)
+		{
+			delete lastFusedDepth;
+		}
+
+		/** Forgets the last fused frame, so the next frame is fused in any case. */
+		void Reset(void)
+		{
+			noSkippedFrames = 0;
+			hasFusedFrame = false;
+		}
+
+		/** Returns whether the current frame should be fused, counts it as skipped otherwise. */
+		bool RequiresFusion(const ITMView *view, const ITMTrackingState *trackingState)
+		{
+			if (!hasFusedFrame || noSkippedFrames >= settings->fusionMaxSkippedFrames) return true;
+
+			// rotation angle and distance between the camera centres since the last fused frame
+			Matrix3f R = trackingState->pose_d->GetR(), lastR = lastFusedPose.GetR();
+			Vector3f cameraCentre = -1.0f * (R.t() * trackingState->pose_d->GetT());
+			Vector3f lastCameraCentre = -1.0f * (lastR.t() * lastFusedPose.GetT());
+
+			Matrix3f deltaR = R * lastR.t();
+			float cosAngle = CLAMP((deltaR.m00 + deltaR.m11 + deltaR.m22 - 1.0f) * 0.5f, -1.0f, 1.0f);
+
+			if (length(cameraCentre - lastCameraCentre) > settings->fusionMinTranslation) return true;
+			if (acosf(cosAngle) > settings->fusionMinRotation) return true;
+
+			view->depth->UpdateHostFromDevice();
+			if (HasDepthChanged(view->depth, settings->fusionMinDepthChange)) return true;
+
+			noSkippedFrames++;
+			return false;
+		}
+
+		/** Remembers the pose and the depth image of a frame that has just been fused. */
+		void SetFusedFrame(const ITMView *view, const ITMTrackingState *trackingState)
+		{
+			if (lastFusedDepth == NULL) lastFusedDepth = new ITMFloatImage(view->depth->noDims, true, false);
+			lastFusedDepth->ChangeDims(view->depth->noDims);
+
+			if (settings->deviceType == ITMLibSettings::DEVICE_CUDA) lastFusedDepth->SetFrom(view->depth, ORUtils::MemoryBlock<float>::CUDA_TO_CPU);
+			else lastFusedDepth->SetFrom(view->depth, ORUtils::MemoryBlock<float>::CPU_TO_CPU);
+
+			lastFusedPose.SetFrom(trackingState->pose_d);
+			noSkippedFrames = 0;
+			hasFusedFrame = true;
+		}
+
+		// Suppress the default copy constructor and assignment operator
+		ITMFusionGate(const ITMFusionGate&);
+		ITMFusionGate& operator=(const ITMFusionGate&);
+	};
+}
@@ -98,6 +98,9 @@ namespace ITMLib
 		virtual void SaveToFile() { };
 		virtual void LoadFromFile() { };
 
+		/// save the changes to the scene since the last save or checkpoint, falls back to SaveToFile if unsupported
+		virtual void SaveCheckpoint() { SaveToFile(); };
+
 		virtual ~ITMMainEngine() {}
 	};
 }
@@ -4,6 +4,7 @@
 
 #include "../Interface/ITMMeshingEngine.h"
 #include "../../../Objects/Scene/ITMPlainVoxelArray.h"
+#include "../../../Objects/Scene/ITMVoxelBlockProbingHash.h"
 
 namespace ITMLib
 {
@@ -22,4 +23,14 @@ namespace ITMLib
 		ITMMeshingEngine_CPU(void) { }
 		~ITMMeshingEngine_CPU(void) { }
 	};
+
+	template<class TVoxel>
+	class ITMMeshingEngine_CPU<TVoxel, ITMVoxelBlockProbingHash> : public ITMMeshingEngine < TVoxel, ITMVoxelBlockProbingHash >
+	{
+	public:
+		void MeshScene(ITMMesh *mesh, const ITMScene<TVoxel, ITMVoxelBlockProbingHash> *scene);
+
+		ITMMeshingEngine_CPU(void) { }
+		~ITMMeshingEngine_CPU(void) { }
+	};
 }
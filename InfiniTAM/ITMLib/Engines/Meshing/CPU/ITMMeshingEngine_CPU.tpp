@@ -11,6 +11,54 @@ void ITMMeshingEngine_CPU<TVoxel, ITMVoxelBlockHash>::MeshScene(ITMMesh *mesh, c
 	ITMMesh::Triangle *triangles = mesh->triangles->GetData(MEMORYDEVICE_CPU);
 	const TVoxel *localVBA = scene->localVBA.GetVoxelBlocks();
 	const ITMHashEntry *hashTable = scene->index.GetEntries();
+	const int *liveEntryIDs = scene->index.GetLiveEntryIDs();
+	const int *neighbourLinks = scene->index.GetNeighbourLinks();
+
+	int noTriangles = 0, noMaxTriangles = mesh->noMaxTriangles, noLiveEntries = scene->index.GetNoLiveEntries();
+	float factor = scene->sceneParams->voxelSize;
+
+	mesh->triangles->Clear();
+
+	for (int liveId = 0; liveId < noLiveEntries; liveId++)
+	{
+		Vector3i globalPos;
+		const ITMHashEntry &currentHashEntry = hashTable[liveEntryIDs[liveId]];
+
+		globalPos = currentHashEntry.pos.toInt() * SDF_BLOCK_SIZE;
+
+		// start from the current block, so the border cells reach their neighbours through its links
+		ITMVoxelBlockHash::IndexCache cache;
+		cache.neighbourLinks = neighbourLinks;
+		cache.blockPos = currentHashEntry.pos.toInt();
+		cache.blockPtr = currentHashEntry.ptr * SDF_BLOCK_SIZE3;
+
+		for (int z = 0; z < SDF_BLOCK_SIZE; z++) for (int y = 0; y < SDF_BLOCK_SIZE; y++) for (int x = 0; x < SDF_BLOCK_SIZE; x++)
+		{
+			Vector3f vertList[12];
+			int cubeIndex = buildVertList(vertList, globalPos, Vector3i(x, y, z), localVBA, hashTable, cache);
+			
+			if (cubeIndex < 0) continue;
+
+			for (int i = 0; triangleTable[cubeIndex][i] != -1; i += 3)
+			{
+				triangles[noTriangles].p0 = vertList[triangleTable[cubeIndex][i]] * factor;
+				triangles[noTriangles].p1 = vertList[triangleTable[cubeIndex][i + 1]] * factor;
+				triangles[noTriangles].p2 = vertList[triangleTable[cubeIndex][i + 2]] * factor;
+
+				if (noTriangles < noMaxTriangles - 1) noTriangles++;
+			}
+		}
+	}
+
+	mesh->noTotalTriangles = noTriangles;
+}
+
+template<class TVoxel>
+void ITMMeshingEngine_CPU<TVoxel, ITMVoxelBlockProbingHash>::MeshScene(ITMMesh *mesh, const ITMScene<TVoxel, ITMVoxelBlockProbingHash> *scene)
+{
+	ITMMesh::Triangle *triangles = mesh->triangles->GetData(MEMORYDEVICE_CPU);
+	const TVoxel *localVBA = scene->localVBA.GetVoxelBlocks();
+	const ITMProbingHashEntry *hashTable = scene->index.GetEntries();
 
 	int noTriangles = 0, noMaxTriangles = mesh->noMaxTriangles, noTotalEntries = scene->index.noTotalEntries;
 	float factor = scene->sceneParams->voxelSize;
@@ -20,16 +68,18 @@ void ITMMeshingEngine_CPU<TVoxel, ITMVoxelBlockHash>::MeshScene(ITMMesh *mesh, c
 	for (int entryId = 0; entryId < noTotalEntries; entryId++)
 	{
 		Vector3i globalPos;
-		const ITMHashEntry &currentHashEntry = hashTable[entryId];
+		const ITMProbingHashEntry &currentHashEntry = hashTable[entryId];
 
 		if (currentHashEntry.ptr < 0) continue;
 
-		globalPos = currentHashEntry.pos.toInt() * SDF_BLOCK_SIZE;
+		globalPos = unpackBlockKey(currentHashEntry.key).toInt() * SDF_BLOCK_SIZE;
+
+		ITMVoxelBlockProbingHash::IndexCache cache;
 
 		for (int z = 0; z < SDF_BLOCK_SIZE; z++) for (int y = 0; y < SDF_BLOCK_SIZE; y++) for (int x = 0; x < SDF_BLOCK_SIZE; x++)
 		{
 			Vector3f vertList[12];
-			int cubeIndex = buildVertList(vertList, globalPos, Vector3i(x, y, z), localVBA, hashTable);
+			int cubeIndex = buildVertList(vertList, globalPos, Vector3i(x, y, z), localVBA, hashTable, cache);
 			
 			if (cubeIndex < 0) continue;
 
@@ -36,7 +36,7 @@ inline void ITMMultiMeshingEngine_CPU<TVoxel, ITMVoxelBlockHash>::MeshScene(ITMM
 	ITMMesh::Triangle *triangles = mesh->triangles->GetData(MEMORYDEVICE_CPU);
 	mesh->triangles->Clear();
 
-	int noTriangles = 0, noMaxTriangles = mesh->noMaxTriangles, noTotalEntriesPerLocalMap = ITMVoxelBlockHash::noTotalEntries;
+	int noTriangles = 0, noMaxTriangles = mesh->noMaxTriangles;
 	float factor = sceneParams.voxelSize;
 
 	// very dumb rendering -- likely to generate lots of duplicates
@@ -44,12 +44,14 @@ inline void ITMMultiMeshingEngine_CPU<TVoxel, ITMVoxelBlockHash>::MeshScene(ITMM
 	{
 		ITMHashEntry *hashTable = hashTables.index[localMapId];
 
-		for (int entryId = 0; entryId < noTotalEntriesPerLocalMap; entryId++)
+		const ITMVoxelBlockHash &index = sceneManager.getLocalMap(localMapId)->scene->index;
+		const int *liveEntryIDs = index.GetLiveEntryIDs();
+		int noLiveEntries = index.GetNoLiveEntries();
+
+		for (int liveId = 0; liveId < noLiveEntries; liveId++)
 		{
 			Vector3i globalPos;
-			const ITMHashEntry &currentHashEntry = hashTable[entryId];
-
-			if (currentHashEntry.ptr < 0) continue;
+			const ITMHashEntry &currentHashEntry = hashTable[liveEntryIDs[liveId]];
 
 			globalPos = currentHashEntry.pos.toInt() * SDF_BLOCK_SIZE;
 
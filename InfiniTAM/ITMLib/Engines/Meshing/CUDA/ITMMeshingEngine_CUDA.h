@@ -17,11 +17,12 @@ namespace ITMLib
 	private:
 		unsigned int  *noTriangles_device;
 		Vector4s *visibleBlockGlobalPos_device;
+		int noLocalBlocks;
 
 	public:
 		void MeshScene(ITMMesh *mesh, const ITMScene<TVoxel, ITMVoxelBlockHash> *scene);
 
-		ITMMeshingEngine_CUDA(void);
+		explicit ITMMeshingEngine_CUDA(const ITMSceneParams *sceneParams);
 		~ITMMeshingEngine_CUDA(void);
 	};
 
@@ -31,7 +32,7 @@ namespace ITMLib
 	public:
 		void MeshScene(ITMMesh *mesh, const ITMScene<TVoxel, ITMPlainVoxelArray> *scene);
 
-		ITMMeshingEngine_CUDA(void);
+		explicit ITMMeshingEngine_CUDA(const ITMSceneParams *sceneParams);
 		~ITMMeshingEngine_CUDA(void);
 	};
 }
@@ -11,6 +11,8 @@ namespace ITMLib
 	class ITMMultiMeshingEngine_CUDA : public ITMMultiMeshingEngine<TVoxel, TIndex>
 	{
 	public:
+		explicit ITMMultiMeshingEngine_CUDA(const ITMSceneParams *sceneParams) {}
+
 		void MeshScene(ITMMesh *mesh, const ITMVoxelMapGraphManager<TVoxel, TIndex> & sceneManager) {}
 	};
 
@@ -20,6 +22,7 @@ namespace ITMLib
 	private:
 		unsigned int  *noTriangles_device;
 		Vector4s *visibleBlockGlobalPos_device;
+		int noLocalBlocks;
 
 	public:
 		typedef typename ITMMultiIndex<ITMVoxelBlockHash>::IndexData MultiIndexData;
@@ -31,7 +34,7 @@ namespace ITMLib
 
 		void MeshScene(ITMMesh *mesh, const MultiSceneManager & sceneManager);
 
-		ITMMultiMeshingEngine_CUDA(void);
+		explicit ITMMultiMeshingEngine_CUDA(const ITMSceneParams *sceneParams);
 		~ITMMultiMeshingEngine_CUDA(void);
 	};
 }
@@ -21,9 +21,10 @@ namespace ITMLib
 		 * \brief Makes a meshing engine.
 		 *
 		 * \param deviceType  The device on which the meshing engine should operate.
+		 * \param sceneParams The scene parameters, used to size the buffers for the voxel block hash.
 		 */
 		template <typename TVoxel, typename TIndex>
-		static ITMMultiMeshingEngine<TVoxel, TIndex> *MakeMeshingEngine(ITMLibSettings::DeviceType deviceType)
+		static ITMMultiMeshingEngine<TVoxel, TIndex> *MakeMeshingEngine(ITMLibSettings::DeviceType deviceType, const ITMSceneParams *sceneParams)
 		{
 			ITMMultiMeshingEngine<TVoxel, TIndex> *meshingEngine = NULL;
 
@@ -34,7 +35,7 @@ namespace ITMLib
 				break;
 			case ITMLibSettings::DEVICE_CUDA:
 #ifndef COMPILE_WITHOUT_CUDA
-				meshingEngine = new ITMMultiMeshingEngine_CUDA<TVoxel, TIndex>();
+				meshingEngine = new ITMMultiMeshingEngine_CUDA<TVoxel, TIndex>(sceneParams);
 #endif
 				break;
 			case ITMLibSettings::DEVICE_METAL:
@@ -91,7 +91,7 @@ namespace ITMLib
 		if ((localMapId < 0) || ((unsigned)localMapId >= allData.size())) return -1;
 
 		ITMScene<TVoxel, TIndex> *scene = allData[localMapId]->scene;
-		return scene->index.getNumAllocatedVoxelBlocks() - scene->localVBA.lastFreeBlockId - 1;
+		return scene->localVBA.GetNumCommittedBlocks() - scene->localVBA.lastFreeBlockId - 1;
 	}
 
 	template<class TVoxel, class TIndex>
@@ -2,8 +2,11 @@
 
 #pragma once
 
+#include <vector>
+
 #include "../Interface/ITMSceneReconstructionEngine.h"
 #include "../../../Objects/Scene/ITMPlainVoxelArray.h"
+#include "../../../Objects/Scene/ITMVoxelBlockProbingHash.h"
 
 namespace ITMLib
 {
@@ -18,6 +21,10 @@ namespace ITMLib
 		ORUtils::MemoryBlock<unsigned char> *entriesAllocType;
 		ORUtils::MemoryBlock<Vector4s> *blockCoords;
 
+		/** Per-chunk counts and offsets used to compact the allocation requests and the visible list in parallel. */
+		std::vector<Vector3i> hashChunkCounts;
+		static const int hashChunkSize = 0x1000;
+
 	public:
 		void ResetScene(ITMScene<TVoxel, ITMVoxelBlockHash> *scene);
 
@@ -27,7 +34,33 @@ namespace ITMLib
 		void IntegrateIntoScene(ITMScene<TVoxel, ITMVoxelBlockHash> *scene, const ITMView *view, const ITMTrackingState *trackingState,
 			const ITMRenderState *renderState);
 
-		ITMSceneReconstructionEngine_CPU(void);
+		int FreeEmptyBlocks(ITMScene<TVoxel, ITMVoxelBlockHash> *scene, const ITMRenderState *renderState);
+
+		explicit ITMSceneReconstructionEngine_CPU(const ITMSceneParams *sceneParams);
+		~ITMSceneReconstructionEngine_CPU(void);
+	};
+
+	template<class TVoxel>
+	class ITMSceneReconstructionEngine_CPU<TVoxel, ITMVoxelBlockProbingHash> : public ITMSceneReconstructionEngine < TVoxel, ITMVoxelBlockProbingHash >
+	{
+	protected:
+		ORUtils::MemoryBlock<unsigned char> *entriesAllocType;
+		ORUtils::MemoryBlock<Vector4s> *blockCoords;
+
+		/** Per-chunk counts and offsets used to compact the allocation requests and the visible list in parallel. */
+		std::vector<Vector2i> hashChunkCounts;
+		static const int hashChunkSize = 0x1000;
+
+	public:
+		void ResetScene(ITMScene<TVoxel, ITMVoxelBlockProbingHash> *scene);
+
+		void AllocateSceneFromDepth(ITMScene<TVoxel, ITMVoxelBlockProbingHash> *scene, const ITMView *view, const ITMTrackingState *trackingState,
+			const ITMRenderState *renderState, bool onlyUpdateVisibleList = false, bool resetVisibleList = false);
+
+		void IntegrateIntoScene(ITMScene<TVoxel, ITMVoxelBlockProbingHash> *scene, const ITMView *view, const ITMTrackingState *trackingState,
+			const ITMRenderState *renderState);
+
+		explicit ITMSceneReconstructionEngine_CPU(const ITMSceneParams *sceneParams);
 		~ITMSceneReconstructionEngine_CPU(void);
 	};
 
@@ -43,7 +76,7 @@ namespace ITMLib
 		void IntegrateIntoScene(ITMScene<TVoxel, ITMPlainVoxelArray> *scene, const ITMView *view, const ITMTrackingState *trackingState,
 			const ITMRenderState *renderState);
 
-		ITMSceneReconstructionEngine_CPU(void);
+		explicit ITMSceneReconstructionEngine_CPU(const ITMSceneParams *sceneParams);
 		~ITMSceneReconstructionEngine_CPU(void);
 	};
 }
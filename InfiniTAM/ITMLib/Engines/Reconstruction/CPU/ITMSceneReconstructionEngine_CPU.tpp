@@ -1,51 +1,47 @@
 // Copyright 2014-2017 Oxford University Innovation Limited and the authors of InfiniTAM
 
 #include "ITMSceneReconstructionEngine_CPU.h"
+#include "ITMSceneReconstructionEngine_SIMD.h"
 
 #include "../Shared/ITMSceneReconstructionEngine_Shared.h"
 #include "../../../Objects/RenderStates/ITMRenderState_VH.h"
-using namespace ITMLib;
 
-template<class TVoxel>
-ITMSceneReconstructionEngine_CPU<TVoxel,ITMVoxelBlockHash>::ITMSceneReconstructionEngine_CPU(void) 
-{
-	int noTotalEntries = ITMVoxelBlockHash::noTotalEntries;
-	entriesAllocType = new ORUtils::MemoryBlock<unsigned char>(noTotalEntries, MEMORYDEVICE_CPU);
-	blockCoords = new ORUtils::MemoryBlock<Vector4s>(noTotalEntries, MEMORYDEVICE_CPU);
-}
+#include <algorithm>
+#include <vector>
 
-template<class TVoxel>
-ITMSceneReconstructionEngine_CPU<TVoxel,ITMVoxelBlockHash>::~ITMSceneReconstructionEngine_CPU(void) 
-{
-	delete entriesAllocType;
-	delete blockCoords;
-}
+using namespace ITMLib;
 
-template<class TVoxel>
-void ITMSceneReconstructionEngine_CPU<TVoxel,ITMVoxelBlockHash>::ResetScene(ITMScene<TVoxel, ITMVoxelBlockHash> *scene)
+/** \brief
+    Collects the allocation requests marked in @p entriesAllocType
+    as (depth, entry) pairs, ordered by the depth of their block
+    in the camera frame @p M_d, nearest first. Once the scene runs
+    out of space, the requests are served in this order: surfaces
+    close to the camera are measured most accurately and are the
+    ones tracking relies on, while the far ones are the noisiest.
+*/
+inline void sortAllocRequestsByDepth(std::vector<std::pair<float, int> > &allocRequests, const uchar *entriesAllocType,
+	const Vector4s *blockCoords, int noTotalEntries, const Matrix4f &M_d, float blockSideLength)
 {
-	int numBlocks = scene->index.getNumAllocatedVoxelBlocks();
-	int blockSize = scene->index.getVoxelBlockSize();
-
-	TVoxel *voxelBlocks_ptr = scene->localVBA.GetVoxelBlocks();
-	for (int i = 0; i < numBlocks * blockSize; ++i) voxelBlocks_ptr[i] = TVoxel();
-	int *vbaAllocationList_ptr = scene->localVBA.GetAllocationList();
-	for (int i = 0; i < numBlocks; ++i) vbaAllocationList_ptr[i] = i;
-	scene->localVBA.lastFreeBlockId = numBlocks - 1;
+	allocRequests.clear();
+	for (int targetIdx = 0; targetIdx < noTotalEntries; targetIdx++)
+	{
+		if (entriesAllocType[targetIdx] == 0) continue;
 
-	ITMHashEntry tmpEntry;
-	memset(&tmpEntry, 0, sizeof(ITMHashEntry));
-	tmpEntry.ptr = -2;
-	ITMHashEntry *hashEntry_ptr = scene->index.GetEntries();
-	for (int i = 0; i < scene->index.noTotalEntries; ++i) hashEntry_ptr[i] = tmpEntry;
-	int *excessList_ptr = scene->index.GetExcessAllocationList();
-	for (int i = 0; i < SDF_EXCESS_LIST_SIZE; ++i) excessList_ptr[i] = i;
+		const Vector4s &blockPos = blockCoords[targetIdx];
+		Vector4f blockCentre((blockPos.x + 0.5f) * blockSideLength, (blockPos.y + 0.5f) * blockSideLength, (blockPos.z + 0.5f) * blockSideLength, 1.0f);
+		allocRequests.push_back(std::make_pair((M_d * blockCentre).z, targetIdx));
+	}
 
-	scene->index.SetLastFreeExcessListId(SDF_EXCESS_LIST_SIZE - 1);
+	std::sort(allocRequests.begin(), allocRequests.end());
 }
 
-template<class TVoxel>
-void ITMSceneReconstructionEngine_CPU<TVoxel, ITMVoxelBlockHash>::IntegrateIntoScene(ITMScene<TVoxel, ITMVoxelBlockHash> *scene, const ITMView *view,
+/** \brief
+    Fuses the depth (and colour) of @p view into the visible voxel
+    blocks of a hashed scene. The hash indexes only differ in how an
+    entry stores the position of its block, see getBlockPos().
+*/
+template<class TVoxel, class TIndex>
+static void integrateVisibleBlocks(ITMScene<TVoxel, TIndex> *scene, const ITMView *view,
 	const ITMTrackingState *trackingState, const ITMRenderState *renderState)
 {
 	Vector2i rgbImgSize = view->rgb->noDims;
@@ -58,7 +54,7 @@ void ITMSceneReconstructionEngine_CPU<TVoxel, ITMVoxelBlockHash>::IntegrateIntoS
 	ITMRenderState_VH *renderState_vh = (ITMRenderState_VH*)renderState;
 
 	M_d = trackingState->pose_d->GetM();
-	if (TVoxel::hasColorInformation) M_rgb = view->calib.trafo_rgb_to_depth.calib_inv * M_d;
+	if (TVoxel::hasColorInformation || TVoxel::hasSeparateColourInformation) M_rgb = view->calib.trafo_rgb_to_depth.calib_inv * M_d;
 
 	projParams_d = view->calib.intrinsics_d.projectionParamsSimple.all;
 	projParams_rgb = view->calib.intrinsics_rgb.projectionParamsSimple.all;
@@ -69,7 +65,9 @@ void ITMSceneReconstructionEngine_CPU<TVoxel, ITMVoxelBlockHash>::IntegrateIntoS
 	float *confidence = view->depthConfidence->GetData(MEMORYDEVICE_CPU);
 	Vector4u *rgb = view->rgb->GetData(MEMORYDEVICE_CPU);
 	TVoxel *localVBA = scene->localVBA.GetVoxelBlocks();
-	ITMHashEntry *hashTable = scene->index.GetEntries();
+	typedef typename ITMColourVoxel<TVoxel>::Type TColourVoxel;
+	TColourVoxel *colourVBA = scene->localVBA.GetColourBlocks();
+	const typename TIndex::IndexData *hashTable = scene->index.GetEntries();
 
 	int *visibleEntryIds = renderState_vh->GetVisibleEntryIDs();
 	int noVisibleEntries = renderState_vh->noVisibleEntries;
@@ -77,43 +75,132 @@ void ITMSceneReconstructionEngine_CPU<TVoxel, ITMVoxelBlockHash>::IntegrateIntoS
 	bool stopIntegratingAtMaxW = scene->sceneParams->stopIntegratingAtMaxW;
 	//bool approximateIntegration = !trackingState->requiresFullRendering;
 
+	// blocks without an effect on their voxels are skipped, but with mu >= 4 ComputeUpdatedVoxelInfo
+	// fuses colour even where the depth update returned -1
+	bool cullBlocks = !(TVoxel::hasColorInformation || TVoxel::hasSeparateColourInformation) || mu < 4.0f;
+
 #ifdef WITH_OPENMP
 	#pragma omp parallel for
 #endif
 	for (int entryId = 0; entryId < noVisibleEntries; entryId++)
 	{
-		Vector3i globalPos;
-		const ITMHashEntry &currentHashEntry = hashTable[visibleEntryIds[entryId]];
+		const typename TIndex::IndexData &currentHashEntry = hashTable[visibleEntryIds[entryId]];
 
 		if (currentHashEntry.ptr < 0) continue;
 
-		globalPos.x = currentHashEntry.pos.x;
-		globalPos.y = currentHashEntry.pos.y;
-		globalPos.z = currentHashEntry.pos.z;
-		globalPos *= SDF_BLOCK_SIZE;
+		Vector3i globalPos = getBlockPos(currentHashEntry).toInt() * SDF_BLOCK_SIZE;
 
 		TVoxel *localVoxelBlock = &(localVBA[currentHashEntry.ptr * (SDF_BLOCK_SIZE3)]);
+		TColourVoxel *localColourBlock = &(colourVBA[currentHashEntry.ptr * (SDF_BLOCK_SIZE3)]);
 
-		for (int z = 0; z < SDF_BLOCK_SIZE; z++) for (int y = 0; y < SDF_BLOCK_SIZE; y++) for (int x = 0; x < SDF_BLOCK_SIZE; x++)
+		if (cullBlocks)
 		{
-			Vector4f pt_model; int locId;
+			VoxelBlockFootprint footprint = classifyVoxelBlockFootprint(globalPos, voxelSize, M_d, projParams_d, mu, depth, depthImgSize);
+			if (footprint == BLOCK_FOOTPRINT_UNOBSERVED) continue;
 
-			locId = x + y * SDF_BLOCK_SIZE + z * SDF_BLOCK_SIZE * SDF_BLOCK_SIZE;
+			// the confidence still needs the pixel of each voxel
+			if (footprint == BLOCK_FOOTPRINT_FREE_SPACE && !TVoxel::hasConfidenceInformation)
+			{
+				for (int locId = 0; locId < SDF_BLOCK_SIZE3; locId++)
+				{
+					if (stopIntegratingAtMaxW) if (localVoxelBlock[locId].w_depth == maxW) continue;
+					updateVoxelDepthInfoFreeSpace(localVoxelBlock[locId], maxW);
+				}
+				continue;
+			}
+		}
 
-			if (stopIntegratingAtMaxW) if (localVoxelBlock[locId].w_depth == maxW) continue;
-			//if (approximateIntegration) if (localVoxelBlock[locId].w_depth != 0) continue;
+		for (int z = 0; z < SDF_BLOCK_SIZE; z++) for (int y = 0; y < SDF_BLOCK_SIZE; y++)
+		{
+			if (ITMVoxelRowIntegrator<TVoxel>::isVectorised)
+			{
+				ITMVoxelRowIntegrator<TVoxel>::Integrate(localVoxelBlock + (y + z * SDF_BLOCK_SIZE) * SDF_BLOCK_SIZE, Vector3i(globalPos.x, globalPos.y + y, globalPos.z + z),
+					voxelSize, M_d, projParams_d, mu, maxW, stopIntegratingAtMaxW, depth, depthImgSize);
+				continue;
+			}
+
+			for (int x = 0; x < SDF_BLOCK_SIZE; x++)
+			{
+				Vector4f pt_model; int locId;
 
-			pt_model.x = (float)(globalPos.x + x) * voxelSize;
-			pt_model.y = (float)(globalPos.y + y) * voxelSize;
-			pt_model.z = (float)(globalPos.z + z) * voxelSize;
-			pt_model.w = 1.0f;
+				locId = voxelIdInBlock(x, y, z);
 
-			ComputeUpdatedVoxelInfo<TVoxel::hasColorInformation,TVoxel::hasConfidenceInformation, TVoxel>::compute(localVoxelBlock[locId], pt_model, M_d, 
-				projParams_d, M_rgb, projParams_rgb, mu, maxW, depth, confidence, depthImgSize, rgb, rgbImgSize);
+				if (stopIntegratingAtMaxW) if (localVoxelBlock[locId].w_depth == maxW) continue;
+				//if (approximateIntegration) if (localVoxelBlock[locId].w_depth != 0) continue;
+
+				pt_model.x = (float)(globalPos.x + x) * voxelSize;
+				pt_model.y = (float)(globalPos.y + y) * voxelSize;
+				pt_model.z = (float)(globalPos.z + z) * voxelSize;
+				pt_model.w = 1.0f;
+
+				ComputeUpdatedVoxelStreams<TVoxel::hasSeparateColourInformation, TVoxel, TColourVoxel>::compute(localVoxelBlock[locId], localColourBlock[locId], pt_model, M_d,
+					projParams_d, M_rgb, projParams_rgb, mu, maxW, depth, confidence, depthImgSize, rgb, rgbImgSize);
+			}
 		}
 	}
 }
 
+template<class TVoxel>
+ITMSceneReconstructionEngine_CPU<TVoxel,ITMVoxelBlockHash>::ITMSceneReconstructionEngine_CPU(const ITMSceneParams *sceneParams) 
+{
+	int noTotalEntries = sceneParams->hashBucketNum + sceneParams->excessListSize;
+	entriesAllocType = new ORUtils::MemoryBlock<unsigned char>(noTotalEntries, MEMORYDEVICE_CPU);
+	blockCoords = new ORUtils::MemoryBlock<Vector4s>(noTotalEntries, MEMORYDEVICE_CPU);
+	hashChunkCounts.resize((noTotalEntries + hashChunkSize - 1) / hashChunkSize);
+}
+
+template<class TVoxel>
+ITMSceneReconstructionEngine_CPU<TVoxel,ITMVoxelBlockHash>::~ITMSceneReconstructionEngine_CPU(void) 
+{
+	delete entriesAllocType;
+	delete blockCoords;
+}
+
+template<class TVoxel>
+void ITMSceneReconstructionEngine_CPU<TVoxel,ITMVoxelBlockHash>::ResetScene(ITMScene<TVoxel, ITMVoxelBlockHash> *scene)
+{
+	int numBlocks = scene->index.getNumAllocatedVoxelBlocks();
+
+	// only the blocks that remain committed are handed out, further pages are committed on demand
+	scene->localVBA.Shrink();
+	int firstBlockId = numBlocks - scene->localVBA.GetNumCommittedBlocks();
+
+	// the voxels are not touched here, each block is cleared when it is next allocated
+	scene->localVBA.InvalidateBlocks();
+	int *vbaAllocationList_ptr = scene->localVBA.GetAllocationList();
+	for (int i = firstBlockId; i < numBlocks; ++i) vbaAllocationList_ptr[i - firstBlockId] = i;
+	scene->localVBA.lastFreeBlockId = numBlocks - firstBlockId - 1;
+
+	ITMHashEntry tmpEntry;
+	memset(&tmpEntry, 0, sizeof(ITMHashEntry));
+	tmpEntry.ptr = -2;
+	ITMHashEntry *hashEntry_ptr = scene->index.GetEntries();
+	for (int i = 0; i < scene->index.noTotalEntries; ++i) hashEntry_ptr[i] = tmpEntry;
+	int *excessList_ptr = scene->index.GetExcessAllocationList();
+	int excessListSize = scene->index.getExcessListSize();
+	for (int i = 0; i < excessListSize; ++i) excessList_ptr[i] = i;
+
+	scene->index.SetLastFreeExcessListId(excessListSize - 1);
+	scene->index.SetNoLiveEntries(0);
+	scene->index.ResetNeighbourLinks();
+	scene->index.ResetModificationStamps();
+	scene->index.ResetDroppedAllocations();
+}
+
+template<class TVoxel>
+void ITMSceneReconstructionEngine_CPU<TVoxel, ITMVoxelBlockHash>::IntegrateIntoScene(ITMScene<TVoxel, ITMVoxelBlockHash> *scene, const ITMView *view,
+	const ITMTrackingState *trackingState, const ITMRenderState *renderState)
+{
+	integrateVisibleBlocks(scene, view, trackingState, renderState);
+
+	// stamp the integrated blocks, see ITMVoxelBlockHash::GetChangedBlocks()
+	const ITMHashEntry *hashTable = scene->index.GetEntries();
+	const ITMRenderState_VH *renderState_vh = (const ITMRenderState_VH*)renderState;
+	const int *visibleEntryIds = renderState_vh->GetVisibleEntryIDs();
+	for (int entryId = 0; entryId < renderState_vh->noVisibleEntries; entryId++)
+		if (hashTable[visibleEntryIds[entryId]].ptr >= 0) scene->index.StampEntry(visibleEntryIds[entryId]);
+}
+
 template<class TVoxel>
 void ITMSceneReconstructionEngine_CPU<TVoxel, ITMVoxelBlockHash>::AllocateSceneFromDepth(ITMScene<TVoxel, ITMVoxelBlockHash> *scene, const ITMView *view,
 	const ITMTrackingState *trackingState, const ITMRenderState *renderState, bool onlyUpdateVisibleList, bool resetVisibleList)
@@ -146,6 +233,7 @@ void ITMSceneReconstructionEngine_CPU<TVoxel, ITMVoxelBlockHash>::AllocateSceneF
 	uchar *entriesAllocType = this->entriesAllocType->GetData(MEMORYDEVICE_CPU);
 	Vector4s *blockCoords = this->blockCoords->GetData(MEMORYDEVICE_CPU);
 	int noTotalEntries = scene->index.noTotalEntries;
+	int noBuckets = scene->index.getNumBuckets();
 
 	bool useSwapping = scene->globalCache != NULL;
 
@@ -153,8 +241,9 @@ void ITMSceneReconstructionEngine_CPU<TVoxel, ITMVoxelBlockHash>::AllocateSceneF
 
 	int lastFreeVoxelBlockId = scene->localVBA.lastFreeBlockId;
 	int lastFreeExcessListId = scene->index.GetLastFreeExcessListId();
+	int noLiveEntries = scene->index.GetNoLiveEntries();
 
-	int noVisibleEntries = 0;
+	int noVisibleEntries = 0, noDroppedAllocations = 0;
 
 	memset(entriesAllocType, 0, noTotalEntries);
 
@@ -174,142 +263,662 @@ void ITMSceneReconstructionEngine_CPU<TVoxel, ITMVoxelBlockHash>::AllocateSceneF
 			scene->sceneParams->viewFrustum_max);
 	}
 
+	int noChunks = (noTotalEntries + hashChunkSize - 1) / hashChunkSize;
+	Vector3i *chunkCounts = &this->hashChunkCounts[0];
+
 	if (onlyUpdateVisibleList) useSwapping = false;
+
+	//blocks seen from the extrapolated pose are marked with visible type 4, they are swapped in but not put in the visible list
+	bool usePrediction = useSwapping && scene->sceneParams->swapPrefetchFrames > 0;
+	Matrix4f M_predicted;
+	if (usePrediction)
+	{
+		ORUtils::SE3Pose predictedPose;
+		trackingState->PredictPose(&predictedPose, scene->sceneParams->swapPrefetchFrames);
+		M_predicted = predictedPose.GetM();
+	}
+	float maxPredictedDepth = scene->sceneParams->viewFrustum_max;
+
 	if (!onlyUpdateVisibleList)
 	{
-		//allocate
-		for (int targetIdx = 0; targetIdx < noTotalEntries; targetIdx++)
+		//count allocation requests per chunk, x: all requests, y: requests in the excess list
+#ifdef WITH_OPENMP
+		#pragma omp parallel for
+#endif
+		for (int chunkId = 0; chunkId < noChunks; chunkId++)
 		{
-			int vbaIdx, exlIdx;
-			unsigned char hashChangeType = entriesAllocType[targetIdx];
+			int noChunkAllocRequests = 0, noChunkExcessRequests = 0;
+			int endIdx = MIN((chunkId + 1) * hashChunkSize, noTotalEntries);
 
-			switch (hashChangeType)
+			for (int targetIdx = chunkId * hashChunkSize; targetIdx < endIdx; targetIdx++)
 			{
-			case 1: //needs allocation, fits in the ordered list
-				vbaIdx = lastFreeVoxelBlockId; lastFreeVoxelBlockId--;
+				unsigned char hashChangeType = entriesAllocType[targetIdx];
+				if (hashChangeType > 0) noChunkAllocRequests++;
+				if (hashChangeType == 2) noChunkExcessRequests++;
+			}
+
+			chunkCounts[chunkId].x = noChunkAllocRequests; chunkCounts[chunkId].y = noChunkExcessRequests;
+		}
+
+		//turn the counts into the rank of the first request of each chunk
+		int noAllocRequests = 0, noExcessRequests = 0;
+		for (int chunkId = 0; chunkId < noChunks; chunkId++)
+		{
+			int noChunkAllocRequests = chunkCounts[chunkId].x, noChunkExcessRequests = chunkCounts[chunkId].y;
+			chunkCounts[chunkId].x = noAllocRequests; chunkCounts[chunkId].y = noExcessRequests;
+			noAllocRequests += noChunkAllocRequests; noExcessRequests += noChunkExcessRequests;
+		}
+
+		while (lastFreeVoxelBlockId + 1 < noAllocRequests && noExcessRequests <= lastFreeExcessListId + 1)
+		{
+			int grownLastFreeVoxelBlockId = scene->localVBA.Grow(lastFreeVoxelBlockId);
+			if (grownLastFreeVoxelBlockId == lastFreeVoxelBlockId) break;
+			lastFreeVoxelBlockId = grownLastFreeVoxelBlockId;
+		}
 
-				if (vbaIdx >= 0) //there is room in the voxel block array
+		if (noAllocRequests <= lastFreeVoxelBlockId + 1 && noExcessRequests <= lastFreeExcessListId + 1)
+		{
+			//allocate: every request can be served, so the n-th request takes the n-th free block and live list slot, as in the serial loop below
+#ifdef WITH_OPENMP
+			#pragma omp parallel for
+#endif
+			for (int chunkId = 0; chunkId < noChunks; chunkId++)
+			{
+				int allocRank = chunkCounts[chunkId].x, excessRank = chunkCounts[chunkId].y;
+				int endIdx = MIN((chunkId + 1) * hashChunkSize, noTotalEntries);
+
+				for (int targetIdx = chunkId * hashChunkSize; targetIdx < endIdx; targetIdx++)
 				{
+					unsigned char hashChangeType = entriesAllocType[targetIdx];
+					if (hashChangeType == 0) continue;
+
 					Vector4s pt_block_all = blockCoords[targetIdx];
 
 					ITMHashEntry hashEntry;
 					hashEntry.pos.x = pt_block_all.x; hashEntry.pos.y = pt_block_all.y; hashEntry.pos.z = pt_block_all.z;
-					hashEntry.ptr = voxelAllocationList[vbaIdx];
+					hashEntry.ptr = voxelAllocationList[lastFreeVoxelBlockId - allocRank];
 					hashEntry.offset = 0;
+					scene->localVBA.InitialiseBlock(hashEntry.ptr);
 
-					hashTable[targetIdx] = hashEntry;
-				}
-				else
-				{
-					// Mark entry as not visible since we couldn't allocate it but buildHashAllocAndVisibleTypePP changed its state.
-					entriesVisibleType[targetIdx] = 0;
+					int entryId = targetIdx;
+					if (hashChangeType == 1) //needs allocation, fits in the ordered list
+					{
+						hashTable[targetIdx] = hashEntry;
+					}
+					else //needs allocation in the excess list
+					{
+						int exlOffset = excessAllocationList[lastFreeExcessListId - excessRank]; excessRank++;
+
+						hashTable[targetIdx].offset = exlOffset + 1; //connect to child
+
+						hashTable[noBuckets + exlOffset] = hashEntry; //add child to the excess list
+
+						entriesVisibleType[noBuckets + exlOffset] = 1; //make child visible and in memory
 
-					// Restore previous value to avoid leaks.
-					lastFreeVoxelBlockId++;
+						entryId = noBuckets + exlOffset;
+					}
+
+					scene->index.SetLiveEntry(noLiveEntries + allocRank, entryId, hashEntry.ptr); allocRank++;
 				}
+			}
 
-				break;
-			case 2: //needs allocation in the excess list
-				vbaIdx = lastFreeVoxelBlockId; lastFreeVoxelBlockId--;
-				exlIdx = lastFreeExcessListId; lastFreeExcessListId--;
+			lastFreeVoxelBlockId -= noAllocRequests;
+			lastFreeExcessListId -= noExcessRequests;
+			scene->index.SetNoLiveEntries(noLiveEntries + noAllocRequests);
+		}
+		else
+		{
+			//allocate: out of voxel blocks or excess list entries, serve the requests nearest to the camera first for as long as they last
+			std::vector<std::pair<float, int> > allocRequests;
+			sortAllocRequestsByDepth(allocRequests, entriesAllocType, blockCoords, noTotalEntries, M_d, voxelSize * SDF_BLOCK_SIZE);
+
+			for (size_t requestId = 0; requestId < allocRequests.size(); requestId++)
+			{
+				int targetIdx = allocRequests[requestId].second;
+				int vbaIdx, exlIdx;
+				unsigned char hashChangeType = entriesAllocType[targetIdx];
 
-				if (vbaIdx >= 0 && exlIdx >= 0) //there is room in the voxel block array and excess list
+				switch (hashChangeType)
 				{
-					Vector4s pt_block_all = blockCoords[targetIdx];
+				case 1: //needs allocation, fits in the ordered list
+					if (lastFreeVoxelBlockId < 0) lastFreeVoxelBlockId = scene->localVBA.Grow(lastFreeVoxelBlockId);
+					vbaIdx = lastFreeVoxelBlockId; lastFreeVoxelBlockId--;
+
+					if (vbaIdx >= 0) //there is room in the voxel block array
+					{
+						Vector4s pt_block_all = blockCoords[targetIdx];
+
+						ITMHashEntry hashEntry;
+						hashEntry.pos.x = pt_block_all.x; hashEntry.pos.y = pt_block_all.y; hashEntry.pos.z = pt_block_all.z;
+						hashEntry.ptr = voxelAllocationList[vbaIdx];
+						hashEntry.offset = 0;
+						scene->localVBA.InitialiseBlock(hashEntry.ptr);
+
+						hashTable[targetIdx] = hashEntry;
+						scene->index.AddLiveEntry(targetIdx, hashEntry.ptr);
+					}
+					else
+					{
+						// Mark entry as not visible since we couldn't allocate it but buildHashAllocAndVisibleTypePP changed its state.
+						entriesVisibleType[targetIdx] = 0;
+
+						// Restore previous value to avoid leaks.
+						lastFreeVoxelBlockId++;
+						noDroppedAllocations++;
+					}
+
+					break;
+				case 2: //needs allocation in the excess list
+					if (lastFreeVoxelBlockId < 0) lastFreeVoxelBlockId = scene->localVBA.Grow(lastFreeVoxelBlockId);
+					vbaIdx = lastFreeVoxelBlockId; lastFreeVoxelBlockId--;
+					exlIdx = lastFreeExcessListId; lastFreeExcessListId--;
+
+					if (vbaIdx >= 0 && exlIdx >= 0) //there is room in the voxel block array and excess list
+					{
+						Vector4s pt_block_all = blockCoords[targetIdx];
+
+						ITMHashEntry hashEntry;
+						hashEntry.pos.x = pt_block_all.x; hashEntry.pos.y = pt_block_all.y; hashEntry.pos.z = pt_block_all.z;
+						hashEntry.ptr = voxelAllocationList[vbaIdx];
+						hashEntry.offset = 0;
+						scene->localVBA.InitialiseBlock(hashEntry.ptr);
+
+						int exlOffset = excessAllocationList[exlIdx];
+
+						hashTable[targetIdx].offset = exlOffset + 1; //connect to child
+
+						hashTable[noBuckets + exlOffset] = hashEntry; //add child to the excess list
+
+						entriesVisibleType[noBuckets + exlOffset] = 1; //make child visible and in memory
+
+						scene->index.AddLiveEntry(noBuckets + exlOffset, hashEntry.ptr);
+					}
+					else
+					{
+						// No need to mark the entry as not visible since buildHashAllocAndVisibleTypePP did not mark it.
+						// Restore previous value to avoid leaks.
+						lastFreeVoxelBlockId++;
+						lastFreeExcessListId++;
+						noDroppedAllocations++;
+					}
+
+					break;
+				}
+			}
+		}
+	}
 
-					ITMHashEntry hashEntry;
-					hashEntry.pos.x = pt_block_all.x; hashEntry.pos.y = pt_block_all.y; hashEntry.pos.z = pt_block_all.z;
-					hashEntry.ptr = voxelAllocationList[vbaIdx];
-					hashEntry.offset = 0;
+	//update visibility and count the visible entries of each chunk, z: visible, x: predicted to become visible
+#ifdef WITH_OPENMP
+	#pragma omp parallel for
+#endif
+	for (int chunkId = 0; chunkId < noChunks; chunkId++)
+	{
+		int noChunkVisibleEntries = 0, noChunkPredictedEntries = 0;
+		int endIdx = MIN((chunkId + 1) * hashChunkSize, noTotalEntries);
 
-					int exlOffset = excessAllocationList[exlIdx];
+		for (int targetIdx = chunkId * hashChunkSize; targetIdx < endIdx; targetIdx++)
+		{
+			unsigned char hashVisibleType = entriesVisibleType[targetIdx];
+			const ITMHashEntry &hashEntry = hashTable[targetIdx];
 
-					hashTable[targetIdx].offset = exlOffset + 1; //connect to child
+			if (hashVisibleType == 4) //predicted at the previous frame, checked again below
+			{
+				hashVisibleType = 0;
+				entriesVisibleType[targetIdx] = hashVisibleType;
+			}
 
-					hashTable[SDF_BUCKET_NUM + exlOffset] = hashEntry; //add child to the excess list
+			if (hashVisibleType == 3)
+			{
+				bool isVisibleEnlarged, isVisible;
 
-					entriesVisibleType[SDF_BUCKET_NUM + exlOffset] = 1; //make child visible and in memory
+				if (useSwapping)
+				{
+					checkBlockVisibility<true>(isVisible, isVisibleEnlarged, hashEntry.pos, M_d, projParams_d, voxelSize, depthImgSize);
+					if (!isVisibleEnlarged) hashVisibleType = 0;
+				} else {
+					checkBlockVisibility<false>(isVisible, isVisibleEnlarged, hashEntry.pos, M_d, projParams_d, voxelSize, depthImgSize);
+					if (!isVisible) { hashVisibleType = 0; }
 				}
-				else
+				entriesVisibleType[targetIdx] = hashVisibleType;
+			}
+
+			//only swapped out blocks can be prefetched, so the others are not projected
+			if (usePrediction && hashVisibleType == 0 && hashEntry.ptr == -1)
+			{
+				if (checkBlockPredictedVisibility(hashEntry.pos, M_predicted, projParams_d, voxelSize, depthImgSize, maxPredictedDepth))
 				{
-					// No need to mark the entry as not visible since buildHashAllocAndVisibleTypePP did not mark it.
-					// Restore previous value to avoid leaks.
-					lastFreeVoxelBlockId++;
-					lastFreeExcessListId++;
+					hashVisibleType = 4;
+					entriesVisibleType[targetIdx] = hashVisibleType;
 				}
+			}
 
-				break;
+			if (useSwapping)
+			{
+				if (hashVisibleType > 0 && swapStates[targetIdx].state != 2) swapStates[targetIdx].state = 1;
 			}
+
+			if (hashVisibleType == 4) noChunkPredictedEntries++;
+			else if (hashVisibleType > 0) noChunkVisibleEntries++;
 		}
+
+		chunkCounts[chunkId].z = noChunkVisibleEntries;
+		chunkCounts[chunkId].x = noChunkPredictedEntries;
+	}
+
+	int noPredictedEntries = 0;
+	for (int chunkId = 0; chunkId < noChunks; chunkId++)
+	{
+		int noChunkVisibleEntries = chunkCounts[chunkId].z;
+		chunkCounts[chunkId].z = noVisibleEntries;
+		noVisibleEntries += noChunkVisibleEntries;
+		noPredictedEntries += chunkCounts[chunkId].x;
 	}
 
 	//build visible list
-	for (int targetIdx = 0; targetIdx < noTotalEntries; targetIdx++)
+#ifdef WITH_OPENMP
+	#pragma omp parallel for
+#endif
+	for (int chunkId = 0; chunkId < noChunks; chunkId++)
 	{
-		unsigned char hashVisibleType = entriesVisibleType[targetIdx];
-		const ITMHashEntry &hashEntry = hashTable[targetIdx];
-		
-		if (hashVisibleType == 3)
+		int visibleEntryId = chunkCounts[chunkId].z;
+		int endIdx = MIN((chunkId + 1) * hashChunkSize, noTotalEntries);
+
+		for (int targetIdx = chunkId * hashChunkSize; targetIdx < endIdx; targetIdx++)
 		{
-			bool isVisibleEnlarged, isVisible;
+			unsigned char hashVisibleType = entriesVisibleType[targetIdx];
+			if (hashVisibleType > 0 && hashVisibleType != 4) visibleEntryIDs[visibleEntryId++] = targetIdx;
+		}
+	}
 
-			if (useSwapping)
+	//reallocate deleted ones from previous swap operation
+	if (useSwapping)
+	{
+		for (int targetIdx = 0; targetIdx < noTotalEntries; targetIdx++)
+		{
+			int vbaIdx;
+			ITMHashEntry hashEntry = hashTable[targetIdx];
+
+			if (entriesVisibleType[targetIdx] > 0 && entriesVisibleType[targetIdx] != 4 && hashEntry.ptr == -1) 
 			{
-				checkBlockVisibility<true>(isVisible, isVisibleEnlarged, hashEntry.pos, M_d, projParams_d, voxelSize, depthImgSize);
-				if (!isVisibleEnlarged) hashVisibleType = 0;
-			} else {
-				checkBlockVisibility<false>(isVisible, isVisibleEnlarged, hashEntry.pos, M_d, projParams_d, voxelSize, depthImgSize);
-				if (!isVisible) { hashVisibleType = 0; }
+				if (lastFreeVoxelBlockId < 0) lastFreeVoxelBlockId = scene->localVBA.Grow(lastFreeVoxelBlockId);
+				vbaIdx = lastFreeVoxelBlockId; lastFreeVoxelBlockId--;
+				if (vbaIdx >= 0)
+				{
+					hashTable[targetIdx].ptr = voxelAllocationList[vbaIdx];
+					scene->localVBA.InitialiseBlock(hashTable[targetIdx].ptr);
+					scene->index.AddLiveEntry(targetIdx, hashTable[targetIdx].ptr);
+				}
+				else
+				{
+					lastFreeVoxelBlockId++; // Avoid leaks
+					noDroppedAllocations++;
+				}
+			}
+		}
+
+		//then the predicted ones, as many as can be swapped in at once
+		int noPrefetchedEntries = 0;
+		for (int targetIdx = 0; targetIdx < noTotalEntries && noPredictedEntries > 0; targetIdx++)
+		{
+			if (noPrefetchedEntries >= SDF_TRANSFER_BLOCK_NUM) break;
+
+			int vbaIdx;
+			ITMHashEntry hashEntry = hashTable[targetIdx];
+
+			if (entriesVisibleType[targetIdx] == 4 && hashEntry.ptr == -1)
+			{
+				if (lastFreeVoxelBlockId < 0) lastFreeVoxelBlockId = scene->localVBA.Grow(lastFreeVoxelBlockId);
+				vbaIdx = lastFreeVoxelBlockId; lastFreeVoxelBlockId--;
+				if (vbaIdx < 0) { lastFreeVoxelBlockId++; break; }
+
+				hashTable[targetIdx].ptr = voxelAllocationList[vbaIdx];
+				scene->localVBA.InitialiseBlock(hashTable[targetIdx].ptr);
+				scene->index.AddLiveEntry(targetIdx, hashTable[targetIdx].ptr);
+				noPrefetchedEntries++;
 			}
-			entriesVisibleType[targetIdx] = hashVisibleType;
 		}
+	}
+
+	renderState_vh->noVisibleEntries = noVisibleEntries;
+
+	scene->localVBA.lastFreeBlockId = lastFreeVoxelBlockId;
+	scene->index.SetLastFreeExcessListId(lastFreeExcessListId);
+	if (!onlyUpdateVisibleList) scene->index.AddDroppedAllocations(noDroppedAllocations);
+}
+
+template<class TVoxel>
+int ITMSceneReconstructionEngine_CPU<TVoxel, ITMVoxelBlockHash>::FreeEmptyBlocks(ITMScene<TVoxel, ITMVoxelBlockHash> *scene, const ITMRenderState *renderState)
+{
+	ITMRenderState_VH *renderState_vh = (ITMRenderState_VH*)renderState;
 
-		if (useSwapping)
+	TVoxel *localVBA = scene->localVBA.GetVoxelBlocks();
+	int *voxelAllocationList = scene->localVBA.GetAllocationList();
+	int *excessAllocationList = scene->index.GetExcessAllocationList();
+	ITMHashEntry *hashTable = scene->index.GetEntries();
+	ITMHashSwapState *swapStates = scene->globalCache != NULL ? scene->globalCache->GetSwapStates(false) : 0;
+	const uchar *entriesVisibleType = renderState_vh->GetEntriesVisibleType();
+	const int *liveEntryIDs = scene->index.GetLiveEntryIDs();
+	int noBuckets = scene->index.getNumBuckets();
+	int hashMask = getHashMask(hashTable);
+
+	int lastFreeVoxelBlockId = scene->localVBA.lastFreeBlockId;
+	int lastFreeExcessListId = scene->index.GetLastFreeExcessListId();
+
+	ITMHashEntry freeEntry;
+	freeEntry.pos = Vector3s((short)0, (short)0, (short)0);
+	freeEntry.offset = 0;
+	freeEntry.ptr = -2;
+
+	int noFreedBlocks = 0;
+
+	// backwards, so that the entries moved into the place of removed ones have already been visited
+	for (int liveId = scene->index.GetNoLiveEntries() - 1; liveId >= 0; liveId--)
+	{
+		int entryId = liveEntryIDs[liveId];
+		ITMHashEntry hashEntry = hashTable[entryId];
+
+		if (entriesVisibleType[entryId] != 0) continue;
+
+		// blocks waiting to be combined with swapped in data are left alone
+		if (swapStates != NULL && swapStates[entryId].state != 2) continue;
+
+		// a free bucket ends the lookup, so buckets that still lead into the excess list are kept
+		bool isExcess = entryId >= noBuckets;
+		if (!isExcess && hashEntry.offset >= 1) continue;
+
+		if (!isEmptyVoxelBlock(localVBA + hashEntry.ptr * SDF_BLOCK_SIZE3)) continue;
+
+		if (isExcess)
 		{
-			if (hashVisibleType > 0 && swapStates[targetIdx].state != 2) swapStates[targetIdx].state = 1;
+			//unlink from the parent and return the entry to the excess list
+			int parentId = hashIndex(hashEntry.pos, hashMask);
+			while (noBuckets + hashTable[parentId].offset - 1 != entryId) parentId = noBuckets + hashTable[parentId].offset - 1;
+			hashTable[parentId].offset = hashEntry.offset;
+
+			lastFreeExcessListId++;
+			excessAllocationList[lastFreeExcessListId] = entryId - noBuckets;
 		}
 
-		if (hashVisibleType > 0)
-		{	
-			visibleEntryIDs[noVisibleEntries] = targetIdx;
-			noVisibleEntries++;
+		lastFreeVoxelBlockId++;
+		voxelAllocationList[lastFreeVoxelBlockId] = hashEntry.ptr;
+		scene->localVBA.ReleaseBlock(hashEntry.ptr);
+		scene->index.RemoveLiveEntry(hashEntry.ptr);
+
+		scene->index.StampEntry(entryId);
+		hashTable[entryId] = freeEntry;
+
+		// a block allocated later at this entry must not be combined with the data swapped out from this one
+		if (swapStates != NULL)
+		{
+			if (noFreedBlocks == 0) scene->globalCache->WaitForAllTransfers();
+			scene->globalCache->ClearStoredData(entryId);
+			swapStates[entryId].state = 0;
 		}
 
-#if 0
-		// "active list", currently disabled
-		if (hashVisibleType == 1)
+		noFreedBlocks++;
+	}
+
+	scene->localVBA.lastFreeBlockId = lastFreeVoxelBlockId;
+	scene->index.SetLastFreeExcessListId(lastFreeExcessListId);
+
+	return noFreedBlocks;
+}
+
+template<class TVoxel>
+ITMSceneReconstructionEngine_CPU<TVoxel,ITMVoxelBlockProbingHash>::ITMSceneReconstructionEngine_CPU(const ITMSceneParams *sceneParams) 
+{
+	int noTotalEntries = ITMVoxelBlockProbingHash::getNumEntries(sceneParams);
+	entriesAllocType = new ORUtils::MemoryBlock<unsigned char>(noTotalEntries, MEMORYDEVICE_CPU);
+	blockCoords = new ORUtils::MemoryBlock<Vector4s>(noTotalEntries, MEMORYDEVICE_CPU);
+	hashChunkCounts.resize((noTotalEntries + hashChunkSize - 1) / hashChunkSize);
+}
+
+template<class TVoxel>
+ITMSceneReconstructionEngine_CPU<TVoxel,ITMVoxelBlockProbingHash>::~ITMSceneReconstructionEngine_CPU(void) 
+{
+	delete entriesAllocType;
+	delete blockCoords;
+}
+
+template<class TVoxel>
+void ITMSceneReconstructionEngine_CPU<TVoxel,ITMVoxelBlockProbingHash>::ResetScene(ITMScene<TVoxel, ITMVoxelBlockProbingHash> *scene)
+{
+	int numBlocks = scene->index.getNumAllocatedVoxelBlocks();
+
+	// only the blocks that remain committed are handed out, further pages are committed on demand
+	scene->localVBA.Shrink();
+	int firstBlockId = numBlocks - scene->localVBA.GetNumCommittedBlocks();
+
+	// the voxels are not touched here, each block is cleared when it is next allocated
+	scene->localVBA.InvalidateBlocks();
+	int *vbaAllocationList_ptr = scene->localVBA.GetAllocationList();
+	for (int i = firstBlockId; i < numBlocks; ++i) vbaAllocationList_ptr[i - firstBlockId] = i;
+	scene->localVBA.lastFreeBlockId = numBlocks - firstBlockId - 1;
+
+	ITMProbingHashEntry tmpEntry;
+	memset(&tmpEntry, 0, sizeof(ITMProbingHashEntry));
+	tmpEntry.key = PROBING_HASH_EMPTY_KEY;
+	tmpEntry.ptr = -2;
+	ITMProbingHashEntry *hashEntry_ptr = scene->index.GetEntries();
+	for (int i = 0; i < scene->index.noTotalEntries; ++i) hashEntry_ptr[i] = tmpEntry;
+
+	scene->index.ResetDroppedAllocations();
+}
+
+template<class TVoxel>
+void ITMSceneReconstructionEngine_CPU<TVoxel, ITMVoxelBlockProbingHash>::IntegrateIntoScene(ITMScene<TVoxel, ITMVoxelBlockProbingHash> *scene, const ITMView *view,
+	const ITMTrackingState *trackingState, const ITMRenderState *renderState)
+{
+	integrateVisibleBlocks(scene, view, trackingState, renderState);
+}
+
+template<class TVoxel>
+void ITMSceneReconstructionEngine_CPU<TVoxel, ITMVoxelBlockProbingHash>::AllocateSceneFromDepth(ITMScene<TVoxel, ITMVoxelBlockProbingHash> *scene, const ITMView *view,
+	const ITMTrackingState *trackingState, const ITMRenderState *renderState, bool onlyUpdateVisibleList, bool resetVisibleList)
+{
+	Vector2i depthImgSize = view->depth->noDims;
+	float voxelSize = scene->sceneParams->voxelSize;
+
+	Matrix4f M_d, invM_d;
+	Vector4f projParams_d, invProjParams_d;
+
+	ITMRenderState_VH *renderState_vh = (ITMRenderState_VH*)renderState;
+	if (resetVisibleList) renderState_vh->noVisibleEntries = 0;
+
+	M_d = trackingState->pose_d->GetM(); M_d.inv(invM_d);
+
+	projParams_d = view->calib.intrinsics_d.projectionParamsSimple.all;
+	invProjParams_d = projParams_d;
+	invProjParams_d.x = 1.0f / invProjParams_d.x;
+	invProjParams_d.y = 1.0f / invProjParams_d.y;
+
+	float mu = scene->sceneParams->mu;
+
+	float *depth = view->depth->GetData(MEMORYDEVICE_CPU);
+	int *voxelAllocationList = scene->localVBA.GetAllocationList();
+	ITMProbingHashEntry *hashTable = scene->index.GetEntries();
+	int *visibleEntryIDs = renderState_vh->GetVisibleEntryIDs();
+	uchar *entriesVisibleType = renderState_vh->GetEntriesVisibleType();
+	uchar *entriesAllocType = this->entriesAllocType->GetData(MEMORYDEVICE_CPU);
+	Vector4s *blockCoords = this->blockCoords->GetData(MEMORYDEVICE_CPU);
+	int noTotalEntries = scene->index.noTotalEntries;
+
+	float oneOverVoxelSize = 1.0f / (voxelSize * SDF_BLOCK_SIZE);
+
+	int lastFreeVoxelBlockId = scene->localVBA.lastFreeBlockId;
+
+	int noVisibleEntries = 0;
+
+	memset(entriesAllocType, 0, noTotalEntries);
+
+	for (int i = 0; i < renderState_vh->noVisibleEntries; i++)
+		entriesVisibleType[visibleEntryIDs[i]] = 3; // visible at previous frame and unstreamed
+
+	//build hashVisibility
+#ifdef WITH_OPENMP
+	#pragma omp parallel for
+#endif
+	for (int locId = 0; locId < depthImgSize.x*depthImgSize.y; locId++)
+	{
+		int y = locId / depthImgSize.x;
+		int x = locId - y * depthImgSize.x;
+		buildProbingHashAllocAndVisibleTypePP(entriesAllocType, entriesVisibleType, x, y, blockCoords, depth, invM_d,
+			invProjParams_d, mu, depthImgSize, oneOverVoxelSize, hashTable, scene->sceneParams->viewFrustum_min,
+			scene->sceneParams->viewFrustum_max);
+	}
+
+	int noChunks = (noTotalEntries + hashChunkSize - 1) / hashChunkSize;
+	Vector2i *chunkCounts = &this->hashChunkCounts[0];
+
+	if (!onlyUpdateVisibleList)
+	{
+		//count allocation requests per chunk
+#ifdef WITH_OPENMP
+		#pragma omp parallel for
+#endif
+		for (int chunkId = 0; chunkId < noChunks; chunkId++)
 		{
-			activeEntryIDs[noActiveEntries] = targetIdx;
-			noActiveEntries++;
+			int noChunkAllocRequests = 0;
+			int endIdx = MIN((chunkId + 1) * hashChunkSize, noTotalEntries);
+
+			for (int targetIdx = chunkId * hashChunkSize; targetIdx < endIdx; targetIdx++)
+				if (entriesAllocType[targetIdx] > 0) noChunkAllocRequests++;
+
+			chunkCounts[chunkId].x = noChunkAllocRequests;
+		}
+
+		//turn the counts into the rank of the first request of each chunk
+		int noAllocRequests = 0;
+		for (int chunkId = 0; chunkId < noChunks; chunkId++)
+		{
+			int noChunkAllocRequests = chunkCounts[chunkId].x;
+			chunkCounts[chunkId].x = noAllocRequests;
+			noAllocRequests += noChunkAllocRequests;
+		}
+
+		while (lastFreeVoxelBlockId + 1 < noAllocRequests)
+		{
+			int grownLastFreeVoxelBlockId = scene->localVBA.Grow(lastFreeVoxelBlockId);
+			if (grownLastFreeVoxelBlockId == lastFreeVoxelBlockId) break;
+			lastFreeVoxelBlockId = grownLastFreeVoxelBlockId;
+		}
+
+		if (noAllocRequests > lastFreeVoxelBlockId + 1)
+		{
+			//out of voxel blocks: drop the requests farthest from the camera and rank the remaining ones again
+			std::vector<std::pair<float, int> > allocRequests;
+			sortAllocRequestsByDepth(allocRequests, entriesAllocType, blockCoords, noTotalEntries, M_d, voxelSize * SDF_BLOCK_SIZE);
+
+			for (size_t requestId = lastFreeVoxelBlockId + 1; requestId < allocRequests.size(); requestId++)
+			{
+				int targetIdx = allocRequests[requestId].second;
+
+				// Mark entry as not visible since we couldn't allocate it but buildProbingHashAllocAndVisibleTypePP changed its state.
+				entriesAllocType[targetIdx] = 0;
+				entriesVisibleType[targetIdx] = 0;
+			}
+
+			scene->index.AddDroppedAllocations(noAllocRequests - (lastFreeVoxelBlockId + 1));
+
+			noAllocRequests = 0;
+			for (int chunkId = 0; chunkId < noChunks; chunkId++)
+			{
+				chunkCounts[chunkId].x = noAllocRequests;
+
+				int endIdx = MIN((chunkId + 1) * hashChunkSize, noTotalEntries);
+				for (int targetIdx = chunkId * hashChunkSize; targetIdx < endIdx; targetIdx++)
+					if (entriesAllocType[targetIdx] > 0) noAllocRequests++;
+			}
 		}
+		else scene->index.AddDroppedAllocations(0);
+
+		//allocate: every remaining request can be served, the n-th request takes the n-th free block
+#ifdef WITH_OPENMP
+		#pragma omp parallel for
 #endif
+		for (int chunkId = 0; chunkId < noChunks; chunkId++)
+		{
+			int allocRank = chunkCounts[chunkId].x;
+			int endIdx = MIN((chunkId + 1) * hashChunkSize, noTotalEntries);
+
+			for (int targetIdx = chunkId * hashChunkSize; targetIdx < endIdx; targetIdx++)
+			{
+				if (entriesAllocType[targetIdx] == 0) continue;
+
+				ITMProbingHashEntry hashEntry;
+				hashEntry.key = packBlockKey(blockCoords[targetIdx]);
+				hashEntry.ptr = voxelAllocationList[lastFreeVoxelBlockId - allocRank];
+				hashEntry.padding = 0;
+				scene->localVBA.InitialiseBlock(hashEntry.ptr);
+
+				hashTable[targetIdx] = hashEntry;
+
+				allocRank++;
+			}
+		}
+
+		lastFreeVoxelBlockId -= noAllocRequests;
 	}
 
-	//reallocate deleted ones from previous swap operation
-	if (useSwapping)
+	//update visibility and count the visible entries of each chunk
+#ifdef WITH_OPENMP
+	#pragma omp parallel for
+#endif
+	for (int chunkId = 0; chunkId < noChunks; chunkId++)
 	{
-		for (int targetIdx = 0; targetIdx < noTotalEntries; targetIdx++)
+		int noChunkVisibleEntries = 0;
+		int endIdx = MIN((chunkId + 1) * hashChunkSize, noTotalEntries);
+
+		for (int targetIdx = chunkId * hashChunkSize; targetIdx < endIdx; targetIdx++)
 		{
-			int vbaIdx;
-			ITMHashEntry hashEntry = hashTable[targetIdx];
+			unsigned char hashVisibleType = entriesVisibleType[targetIdx];
 
-			if (entriesVisibleType[targetIdx] > 0 && hashEntry.ptr == -1) 
+			if (hashVisibleType == 3)
 			{
-				vbaIdx = lastFreeVoxelBlockId; lastFreeVoxelBlockId--;
-				if (vbaIdx >= 0) hashTable[targetIdx].ptr = voxelAllocationList[vbaIdx];
-				else lastFreeVoxelBlockId++; // Avoid leaks
+				bool isVisibleEnlarged, isVisible;
+				Vector3s blockPos = unpackBlockKey(hashTable[targetIdx].key);
+
+				checkBlockVisibility<false>(isVisible, isVisibleEnlarged, blockPos, M_d, projParams_d, voxelSize, depthImgSize);
+				if (!isVisible) { hashVisibleType = 0; }
+				entriesVisibleType[targetIdx] = hashVisibleType;
 			}
+
+			if (hashVisibleType > 0) noChunkVisibleEntries++;
+		}
+
+		chunkCounts[chunkId].y = noChunkVisibleEntries;
+	}
+
+	for (int chunkId = 0; chunkId < noChunks; chunkId++)
+	{
+		int noChunkVisibleEntries = chunkCounts[chunkId].y;
+		chunkCounts[chunkId].y = noVisibleEntries;
+		noVisibleEntries += noChunkVisibleEntries;
+	}
+
+	//build visible list
+#ifdef WITH_OPENMP
+	#pragma omp parallel for
+#endif
+	for (int chunkId = 0; chunkId < noChunks; chunkId++)
+	{
+		int visibleEntryId = chunkCounts[chunkId].y;
+		int endIdx = MIN((chunkId + 1) * hashChunkSize, noTotalEntries);
+
+		for (int targetIdx = chunkId * hashChunkSize; targetIdx < endIdx; targetIdx++)
+		{
+			if (entriesVisibleType[targetIdx] > 0) visibleEntryIDs[visibleEntryId++] = targetIdx;
 		}
 	}
 
 	renderState_vh->noVisibleEntries = noVisibleEntries;
 
 	scene->localVBA.lastFreeBlockId = lastFreeVoxelBlockId;
-	scene->index.SetLastFreeExcessListId(lastFreeExcessListId);
 }
 
 template<class TVoxel>
-ITMSceneReconstructionEngine_CPU<TVoxel,ITMPlainVoxelArray>::ITMSceneReconstructionEngine_CPU(void) 
+ITMSceneReconstructionEngine_CPU<TVoxel,ITMPlainVoxelArray>::ITMSceneReconstructionEngine_CPU(const ITMSceneParams *sceneParams) 
 {}
 
 template<class TVoxel>
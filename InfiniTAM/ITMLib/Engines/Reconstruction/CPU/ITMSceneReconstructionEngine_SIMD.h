@@ -0,0 +1,484 @@
+// Copyright 2014-2017 Oxford University Innovation Limited and the authors of InfiniTAM
+
+#pragma once
+
+#include "../../../Objects/Scene/ITMVoxelBlockHash.h"
+#include "../../../Objects/Scene/ITMVoxelTypes.h"
+
+// the instruction set comes from the compiler flags (-march=native), COMPILE_WITHOUT_SIMD forces the scalar path,
+// as does USE_MORTON_VOXEL_ORDER, in which the voxels of a row are no longer consecutive
+#if !defined(COMPILE_WITHOUT_SIMD) && !defined(USE_MORTON_VOXEL_ORDER) && defined(__AVX2__)
+#include <immintrin.h>
+#define ITM_INTEGRATE_AVX2
+#elif !defined(COMPILE_WITHOUT_SIMD) && !defined(USE_MORTON_VOXEL_ORDER) && defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define ITM_INTEGRATE_NEON
+#endif
+
+namespace ITMLib
+{
+	/** \brief
+	    Fuses the depth image into one row of SDF_BLOCK_SIZE voxels of a
+	    voxel block at once. The generic version is not vectorised and
+	    the engines fall back to ComputeUpdatedVoxelInfo per voxel, which
+	    stays the reference implementation. The specialisations for the
+	    depth only voxel types evaluate the same float expressions in the
+	    same order, including the rounding of floatToValue, only the part
+	    of the camera transform that is constant along the row is computed
+	    once. They agree with the scalar path up to rounding: with the
+	    default -march=native the compiler fuses multiply-adds in either
+	    path differently, which changes the last bit of some sdf values.
+	    IntegrationBenchmark reports the largest divergence.
+	*/
+	template<class TVoxel>
+	struct ITMVoxelRowIntegrator
+	{
+		static const bool isVectorised = false;
+
+		/** @p rowPos is the voxel position of the first voxel of @p voxelRow in the scene. */
+		static void Integrate(TVoxel *voxelRow, const Vector3i &rowPos, float voxelSize, const Matrix4f &M_d, const Vector4f &projParams_d,
+			float mu, int maxW, bool stopIntegratingAtMaxW, const float *depth, const Vector2i &imgSize) {}
+	};
+
+#if defined(ITM_INTEGRATE_AVX2)
+
+	/** Loads and stores the sdf and w_depth fields of eight consecutive voxels in vector registers. */
+	template<class TVoxel> struct ITMVoxelRow_AVX2;
+
+	template<>
+	struct ITMVoxelRow_AVX2<ITMVoxel_s>
+	{
+		static inline void Load(const ITMVoxel_s *voxelRow, __m256 &sdf, __m256i &w_depth)
+		{
+			// one voxel per 32 bit lane: sdf in the low half, w_depth in the third byte
+			__m256i voxels = _mm256_loadu_si256((const __m256i*)voxelRow);
+			sdf = _mm256_div_ps(_mm256_cvtepi32_ps(_mm256_srai_epi32(_mm256_slli_epi32(voxels, 16), 16)), _mm256_set1_ps(32767.0f));
+			w_depth = _mm256_and_si256(_mm256_srli_epi32(voxels, 16), _mm256_set1_epi32(0xff));
+		}
+
+		static inline void Store(ITMVoxel_s *voxelRow, __m256 sdf, __m256i w_depth, __m256 updateMask)
+		{
+			__m256i voxels = _mm256_loadu_si256((const __m256i*)voxelRow);
+			__m256i sdf_short = _mm256_cvttps_epi32(_mm256_mul_ps(sdf, _mm256_set1_ps(32767.0f)));
+
+			__m256i newVoxels = _mm256_and_si256(sdf_short, _mm256_set1_epi32(0xffff));
+			newVoxels = _mm256_or_si256(newVoxels, _mm256_slli_epi32(_mm256_and_si256(w_depth, _mm256_set1_epi32(0xff)), 16));
+			newVoxels = _mm256_or_si256(newVoxels, _mm256_and_si256(voxels, _mm256_set1_epi32((int)0xff000000)));
+
+			_mm256_storeu_si256((__m256i*)voxelRow, _mm256_blendv_epi8(voxels, newVoxels, _mm256_castps_si256(updateMask)));
+		}
+	};
+
+	template<>
+	struct ITMVoxelRow_AVX2<ITMVoxel_f>
+	{
+		static inline void Load(const ITMVoxel_f *voxelRow, __m256 &sdf, __m256i &w_depth)
+		{
+			// two 32 bit words per voxel: sdf, then w_depth in the low byte
+			const __m256i wordIds = _mm256_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14);
+			sdf = _mm256_i32gather_ps((const float*)voxelRow, wordIds, 4);
+			w_depth = _mm256_and_si256(_mm256_i32gather_epi32((const int*)voxelRow + 1, wordIds, 4), _mm256_set1_epi32(0xff));
+		}
+
+		static inline void Store(ITMVoxel_f *voxelRow, __m256 sdf, __m256i w_depth, __m256 updateMask)
+		{
+			float sdf_lanes[8]; int w_depth_lanes[8];
+			_mm256_storeu_ps(sdf_lanes, sdf);
+			_mm256_storeu_si256((__m256i*)w_depth_lanes, w_depth);
+
+			int laneMask = _mm256_movemask_ps(updateMask);
+			for (int x = 0; x < 8; x++) if (laneMask & (1 << x))
+			{
+				voxelRow[x].sdf = sdf_lanes[x];
+				voxelRow[x].w_depth = (uchar)w_depth_lanes[x];
+			}
+		}
+	};
+
+	template<>
+	struct ITMVoxelRow_AVX2<ITMVoxel_u8>
+	{
+		/** Widens the eight 16 bit voxels to one per 32 bit lane: sdf in the low byte, w_depth in the second. */
+		static inline __m256i LoadWords(const ITMVoxel_u8 *voxelRow)
+		{
+			return _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)voxelRow));
+		}
+
+		static inline void Load(const ITMVoxel_u8 *voxelRow, __m256 &sdf, __m256i &w_depth)
+		{
+			__m256i voxels = LoadWords(voxelRow);
+			sdf = _mm256_div_ps(_mm256_cvtepi32_ps(_mm256_srai_epi32(_mm256_slli_epi32(voxels, 24), 24)), _mm256_set1_ps(127.0f));
+			w_depth = _mm256_srli_epi32(voxels, 8);
+		}
+
+		static inline void Store(ITMVoxel_u8 *voxelRow, __m256 sdf, __m256i w_depth, __m256 updateMask)
+		{
+			__m256i voxels = LoadWords(voxelRow);
+
+			// rounded like ITMVoxel_u8::floatToValue
+			__m256 rounding = _mm256_blendv_ps(_mm256_set1_ps(-0.5f), _mm256_set1_ps(0.5f), _mm256_cmp_ps(sdf, _mm256_setzero_ps(), _CMP_GE_OQ));
+			__m256i sdf_char = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(sdf, _mm256_set1_ps(127.0f)), rounding));
+
+			__m256i newVoxels = _mm256_and_si256(sdf_char, _mm256_set1_epi32(0xff));
+			newVoxels = _mm256_or_si256(newVoxels, _mm256_slli_epi32(_mm256_and_si256(w_depth, _mm256_set1_epi32(0xff)), 8));
+			newVoxels = _mm256_blendv_epi8(voxels, newVoxels, _mm256_castps_si256(updateMask));
+
+			// narrow back to 16 bits, the pack works within 128 bit halves
+			__m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(newVoxels, newVoxels), 0x08);
+			_mm_storeu_si128((__m128i*)voxelRow, _mm256_castsi256_si128(packed));
+		}
+	};
+
+#ifdef ITM_HALF_F16C
+	template<>
+	struct ITMVoxelRow_AVX2<ITMVoxel_h>
+	{
+		static inline void Load(const ITMVoxel_h *voxelRow, __m256 &sdf, __m256i &w_depth)
+		{
+			// one voxel per 32 bit lane: sdf in the low half, w_depth in the third byte
+			__m256i voxels = _mm256_loadu_si256((const __m256i*)voxelRow);
+			__m256i sdf_half = _mm256_permute4x64_epi64(_mm256_packus_epi32(_mm256_and_si256(voxels, _mm256_set1_epi32(0xffff)), voxels), 0x08);
+			sdf = _mm256_cvtph_ps(_mm256_castsi256_si128(sdf_half));
+			w_depth = _mm256_and_si256(_mm256_srli_epi32(voxels, 16), _mm256_set1_epi32(0xff));
+		}
+
+		static inline void Store(ITMVoxel_h *voxelRow, __m256 sdf, __m256i w_depth, __m256 updateMask)
+		{
+			__m256i voxels = _mm256_loadu_si256((const __m256i*)voxelRow);
+			__m256i sdf_half = _mm256_cvtepu16_epi32(_mm256_cvtps_ph(sdf, _MM_FROUND_TO_NEAREST_INT));
+
+			__m256i newVoxels = _mm256_or_si256(sdf_half, _mm256_slli_epi32(_mm256_and_si256(w_depth, _mm256_set1_epi32(0xff)), 16));
+			newVoxels = _mm256_or_si256(newVoxels, _mm256_and_si256(voxels, _mm256_set1_epi32((int)0xff000000)));
+
+			_mm256_storeu_si256((__m256i*)voxelRow, _mm256_blendv_epi8(voxels, newVoxels, _mm256_castps_si256(updateMask)));
+		}
+	};
+#endif
+
+	/** AVX2 version of computeUpdatedVoxelDepthInfo for a row of eight voxels. */
+	template<class TVoxel>
+	inline void integrateVoxelRow_AVX2(TVoxel *voxelRow, const Vector3i &rowPos, float voxelSize, const Matrix4f &M_d, const Vector4f &projParams_d,
+		float mu, int maxW, bool stopIntegratingAtMaxW, const float *depth, const Vector2i &imgSize)
+	{
+		__m256 sdf; __m256i w_depth;
+		ITMVoxelRow_AVX2<TVoxel>::Load(voxelRow, sdf, w_depth);
+
+		__m256 updateMask = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		if (stopIntegratingAtMaxW)
+		{
+			updateMask = _mm256_andnot_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(w_depth, _mm256_set1_epi32(maxW))), updateMask);
+			if (_mm256_movemask_ps(updateMask) == 0) return;
+		}
+
+		// project the voxels into the image, y and z are the same for the whole row
+		__m256 pt_model_x = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_set1_epi32(rowPos.x), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7))),
+			_mm256_set1_ps(voxelSize));
+		float pt_model_y = (float)rowPos.y * voxelSize, pt_model_z = (float)rowPos.z * voxelSize;
+
+		__m256 pt_camera[3];
+		for (int c = 0; c < 3; c++)
+		{
+			pt_camera[c] = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(M_d.m[c]), pt_model_x), _mm256_set1_ps(M_d.m[4 + c] * pt_model_y));
+			pt_camera[c] = _mm256_add_ps(pt_camera[c], _mm256_set1_ps(M_d.m[8 + c] * pt_model_z));
+			pt_camera[c] = _mm256_add_ps(pt_camera[c], _mm256_set1_ps(M_d.m[12 + c]));
+		}
+		updateMask = _mm256_and_ps(updateMask, _mm256_cmp_ps(pt_camera[2], _mm256_setzero_ps(), _CMP_GT_OQ));
+
+		__m256 pt_image_x = _mm256_add_ps(_mm256_div_ps(_mm256_mul_ps(_mm256_set1_ps(projParams_d.x), pt_camera[0]), pt_camera[2]), _mm256_set1_ps(projParams_d.z));
+		__m256 pt_image_y = _mm256_add_ps(_mm256_div_ps(_mm256_mul_ps(_mm256_set1_ps(projParams_d.y), pt_camera[1]), pt_camera[2]), _mm256_set1_ps(projParams_d.w));
+
+		updateMask = _mm256_and_ps(updateMask, _mm256_cmp_ps(pt_image_x, _mm256_set1_ps(1.0f), _CMP_GE_OQ));
+		updateMask = _mm256_and_ps(updateMask, _mm256_cmp_ps(pt_image_x, _mm256_set1_ps((float)(imgSize.x - 2)), _CMP_LE_OQ));
+		updateMask = _mm256_and_ps(updateMask, _mm256_cmp_ps(pt_image_y, _mm256_set1_ps(1.0f), _CMP_GE_OQ));
+		updateMask = _mm256_and_ps(updateMask, _mm256_cmp_ps(pt_image_y, _mm256_set1_ps((float)(imgSize.y - 2)), _CMP_LE_OQ));
+		if (_mm256_movemask_ps(updateMask) == 0) return;
+
+		// get measured depth from image, lanes outside of it are not read
+		__m256i pixelIds = _mm256_add_epi32(_mm256_cvttps_epi32(_mm256_add_ps(pt_image_x, _mm256_set1_ps(0.5f))),
+			_mm256_mullo_epi32(_mm256_cvttps_epi32(_mm256_add_ps(pt_image_y, _mm256_set1_ps(0.5f))), _mm256_set1_epi32(imgSize.x)));
+		__m256 depth_measure = _mm256_mask_i32gather_ps(_mm256_setzero_ps(), depth, pixelIds, updateMask, 4);
+		updateMask = _mm256_and_ps(updateMask, _mm256_cmp_ps(depth_measure, _mm256_setzero_ps(), _CMP_GT_OQ));
+
+		// check whether voxel needs updating
+		__m256 eta = _mm256_sub_ps(depth_measure, pt_camera[2]);
+		updateMask = _mm256_and_ps(updateMask, _mm256_cmp_ps(eta, _mm256_set1_ps(-mu), _CMP_GE_OQ));
+		if (_mm256_movemask_ps(updateMask) == 0) return;
+
+		// compute updated SDF value and reliability
+		__m256 newF = _mm256_min_ps(_mm256_set1_ps(1.0f), _mm256_div_ps(eta, _mm256_set1_ps(mu)));
+		newF = _mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(w_depth), sdf), newF);
+
+		__m256i newW = _mm256_add_epi32(w_depth, _mm256_set1_epi32(1));
+		newF = _mm256_div_ps(newF, _mm256_cvtepi32_ps(newW));
+		newW = _mm256_min_epi32(newW, _mm256_set1_epi32(maxW));
+
+		ITMVoxelRow_AVX2<TVoxel>::Store(voxelRow, newF, newW, updateMask);
+	}
+
+	template<>
+	struct ITMVoxelRowIntegrator<ITMVoxel_s>
+	{
+		static const bool isVectorised = SDF_BLOCK_SIZE == 8 && sizeof(ITMVoxel_s) == 4;
+
+		static void Integrate(ITMVoxel_s *voxelRow, const Vector3i &rowPos, float voxelSize, const Matrix4f &M_d, const Vector4f &projParams_d,
+			float mu, int maxW, bool stopIntegratingAtMaxW, const float *depth, const Vector2i &imgSize)
+		{
+			integrateVoxelRow_AVX2(voxelRow, rowPos, voxelSize, M_d, projParams_d, mu, maxW, stopIntegratingAtMaxW, depth, imgSize);
+		}
+	};
+
+	template<>
+	struct ITMVoxelRowIntegrator<ITMVoxel_f>
+	{
+		static const bool isVectorised = SDF_BLOCK_SIZE == 8 && sizeof(ITMVoxel_f) == 8;
+
+		static void Integrate(ITMVoxel_f *voxelRow, const Vector3i &rowPos, float voxelSize, const Matrix4f &M_d, const Vector4f &projParams_d,
+			float mu, int maxW, bool stopIntegratingAtMaxW, const float *depth, const Vector2i &imgSize)
+		{
+			integrateVoxelRow_AVX2(voxelRow, rowPos, voxelSize, M_d, projParams_d, mu, maxW, stopIntegratingAtMaxW, depth, imgSize);
+		}
+	};
+
+	template<>
+	struct ITMVoxelRowIntegrator<ITMVoxel_u8>
+	{
+		static const bool isVectorised = SDF_BLOCK_SIZE == 8 && sizeof(ITMVoxel_u8) == 2;
+
+		static void Integrate(ITMVoxel_u8 *voxelRow, const Vector3i &rowPos, float voxelSize, const Matrix4f &M_d, const Vector4f &projParams_d,
+			float mu, int maxW, bool stopIntegratingAtMaxW, const float *depth, const Vector2i &imgSize)
+		{
+			integrateVoxelRow_AVX2(voxelRow, rowPos, voxelSize, M_d, projParams_d, mu, maxW, stopIntegratingAtMaxW, depth, imgSize);
+		}
+	};
+
+#ifdef ITM_HALF_F16C
+	template<>
+	struct ITMVoxelRowIntegrator<ITMVoxel_h>
+	{
+		static const bool isVectorised = SDF_BLOCK_SIZE == 8 && sizeof(ITMVoxel_h) == 4;
+
+		static void Integrate(ITMVoxel_h *voxelRow, const Vector3i &rowPos, float voxelSize, const Matrix4f &M_d, const Vector4f &projParams_d,
+			float mu, int maxW, bool stopIntegratingAtMaxW, const float *depth, const Vector2i &imgSize)
+		{
+			integrateVoxelRow_AVX2(voxelRow, rowPos, voxelSize, M_d, projParams_d, mu, maxW, stopIntegratingAtMaxW, depth, imgSize);
+		}
+	};
+#endif
+
+#elif defined(ITM_INTEGRATE_NEON)
+
+	/** Loads and stores the sdf and w_depth fields of four consecutive voxels in vector registers. */
+	template<class TVoxel> struct ITMVoxelRow_NEON;
+
+	template<>
+	struct ITMVoxelRow_NEON<ITMVoxel_s>
+	{
+		static inline void Load(const ITMVoxel_s *voxelRow, float32x4_t &sdf, int32x4_t &w_depth)
+		{
+			// one voxel per 32 bit lane: sdf in the low half, w_depth in the third byte
+			int32x4_t voxels = vld1q_s32((const int32_t*)voxelRow);
+			sdf = vdivq_f32(vcvtq_f32_s32(vshrq_n_s32(vshlq_n_s32(voxels, 16), 16)), vdupq_n_f32(32767.0f));
+			w_depth = vandq_s32(vshrq_n_s32(voxels, 16), vdupq_n_s32(0xff));
+		}
+
+		static inline void Store(ITMVoxel_s *voxelRow, float32x4_t sdf, int32x4_t w_depth, uint32x4_t updateMask)
+		{
+			int32x4_t voxels = vld1q_s32((const int32_t*)voxelRow);
+			int32x4_t sdf_short = vcvtq_s32_f32(vmulq_f32(sdf, vdupq_n_f32(32767.0f)));
+
+			int32x4_t newVoxels = vandq_s32(sdf_short, vdupq_n_s32(0xffff));
+			newVoxels = vorrq_s32(newVoxels, vshlq_n_s32(vandq_s32(w_depth, vdupq_n_s32(0xff)), 16));
+			newVoxels = vorrq_s32(newVoxels, vandq_s32(voxels, vdupq_n_s32((int)0xff000000)));
+
+			vst1q_s32((int32_t*)voxelRow, vbslq_s32(updateMask, newVoxels, voxels));
+		}
+	};
+
+	template<>
+	struct ITMVoxelRow_NEON<ITMVoxel_f>
+	{
+		static inline void Load(const ITMVoxel_f *voxelRow, float32x4_t &sdf, int32x4_t &w_depth)
+		{
+			// two 32 bit words per voxel: sdf, then w_depth in the low byte
+			int32x4x2_t voxels = vld2q_s32((const int32_t*)voxelRow);
+			sdf = vreinterpretq_f32_s32(voxels.val[0]);
+			w_depth = vandq_s32(voxels.val[1], vdupq_n_s32(0xff));
+		}
+
+		static inline void Store(ITMVoxel_f *voxelRow, float32x4_t sdf, int32x4_t w_depth, uint32x4_t updateMask)
+		{
+			int32x4x2_t voxels = vld2q_s32((const int32_t*)voxelRow);
+			int32x4_t newWords = vorrq_s32(vandq_s32(voxels.val[1], vdupq_n_s32(~0xff)), vandq_s32(w_depth, vdupq_n_s32(0xff)));
+
+			voxels.val[0] = vbslq_s32(updateMask, vreinterpretq_s32_f32(sdf), voxels.val[0]);
+			voxels.val[1] = vbslq_s32(updateMask, newWords, voxels.val[1]);
+			vst2q_s32((int32_t*)voxelRow, voxels);
+		}
+	};
+
+	template<>
+	struct ITMVoxelRow_NEON<ITMVoxel_u8>
+	{
+		static inline void Load(const ITMVoxel_u8 *voxelRow, float32x4_t &sdf, int32x4_t &w_depth)
+		{
+			// the 16 bit voxels are widened to one per 32 bit lane: sdf in the low byte, w_depth in the second
+			int32x4_t voxels = vreinterpretq_s32_u32(vmovl_u16(vld1_u16((const uint16_t*)voxelRow)));
+			sdf = vdivq_f32(vcvtq_f32_s32(vshrq_n_s32(vshlq_n_s32(voxels, 24), 24)), vdupq_n_f32(127.0f));
+			w_depth = vshrq_n_s32(voxels, 8);
+		}
+
+		static inline void Store(ITMVoxel_u8 *voxelRow, float32x4_t sdf, int32x4_t w_depth, uint32x4_t updateMask)
+		{
+			uint16x4_t voxels = vld1_u16((const uint16_t*)voxelRow);
+
+			// rounded like ITMVoxel_u8::floatToValue
+			float32x4_t rounding = vbslq_f32(vcgeq_f32(sdf, vdupq_n_f32(0.0f)), vdupq_n_f32(0.5f), vdupq_n_f32(-0.5f));
+			int32x4_t sdf_char = vcvtq_s32_f32(vaddq_f32(vmulq_f32(sdf, vdupq_n_f32(127.0f)), rounding));
+
+			int32x4_t newVoxels = vandq_s32(sdf_char, vdupq_n_s32(0xff));
+			newVoxels = vorrq_s32(newVoxels, vshlq_n_s32(vandq_s32(w_depth, vdupq_n_s32(0xff)), 8));
+
+			vst1_u16((uint16_t*)voxelRow, vbsl_u16(vmovn_u32(updateMask), vmovn_u32(vreinterpretq_u32_s32(newVoxels)), voxels));
+		}
+	};
+
+	template<>
+	struct ITMVoxelRow_NEON<ITMVoxel_h>
+	{
+		static inline void Load(const ITMVoxel_h *voxelRow, float32x4_t &sdf, int32x4_t &w_depth)
+		{
+			// one voxel per 32 bit lane: sdf in the low half, w_depth in the third byte
+			int32x4_t voxels = vld1q_s32((const int32_t*)voxelRow);
+			sdf = vcvt_f32_f16(vreinterpret_f16_u16(vmovn_u32(vreinterpretq_u32_s32(voxels))));
+			w_depth = vandq_s32(vshrq_n_s32(voxels, 16), vdupq_n_s32(0xff));
+		}
+
+		static inline void Store(ITMVoxel_h *voxelRow, float32x4_t sdf, int32x4_t w_depth, uint32x4_t updateMask)
+		{
+			int32x4_t voxels = vld1q_s32((const int32_t*)voxelRow);
+			int32x4_t sdf_half = vreinterpretq_s32_u32(vmovl_u16(vreinterpret_u16_f16(vcvt_f16_f32(sdf))));
+
+			int32x4_t newVoxels = vorrq_s32(sdf_half, vshlq_n_s32(vandq_s32(w_depth, vdupq_n_s32(0xff)), 16));
+			newVoxels = vorrq_s32(newVoxels, vandq_s32(voxels, vdupq_n_s32((int)0xff000000)));
+
+			vst1q_s32((int32_t*)voxelRow, vbslq_s32(updateMask, newVoxels, voxels));
+		}
+	};
+
+	/** NEON version of computeUpdatedVoxelDepthInfo for a row of four voxels. */
+	template<class TVoxel>
+	inline void integrateVoxelRow_NEON(TVoxel *voxelRow, const Vector3i &rowPos, float voxelSize, const Matrix4f &M_d, const Vector4f &projParams_d,
+		float mu, int maxW, bool stopIntegratingAtMaxW, const float *depth, const Vector2i &imgSize)
+	{
+		float32x4_t sdf; int32x4_t w_depth;
+		ITMVoxelRow_NEON<TVoxel>::Load(voxelRow, sdf, w_depth);
+
+		uint32x4_t updateMask = vdupq_n_u32(0xffffffff);
+		if (stopIntegratingAtMaxW) updateMask = vmvnq_u32(vceqq_s32(w_depth, vdupq_n_s32(maxW)));
+
+		// project the voxels into the image, y and z are the same for the whole row
+		const int32_t laneOffsets[4] = { 0, 1, 2, 3 };
+		float32x4_t pt_model_x = vmulq_f32(vcvtq_f32_s32(vaddq_s32(vdupq_n_s32(rowPos.x), vld1q_s32(laneOffsets))), vdupq_n_f32(voxelSize));
+		float pt_model_y = (float)rowPos.y * voxelSize, pt_model_z = (float)rowPos.z * voxelSize;
+
+		float32x4_t pt_camera[3];
+		for (int c = 0; c < 3; c++)
+		{
+			pt_camera[c] = vaddq_f32(vmulq_f32(vdupq_n_f32(M_d.m[c]), pt_model_x), vdupq_n_f32(M_d.m[4 + c] * pt_model_y));
+			pt_camera[c] = vaddq_f32(pt_camera[c], vdupq_n_f32(M_d.m[8 + c] * pt_model_z));
+			pt_camera[c] = vaddq_f32(pt_camera[c], vdupq_n_f32(M_d.m[12 + c]));
+		}
+		updateMask = vandq_u32(updateMask, vcgtq_f32(pt_camera[2], vdupq_n_f32(0.0f)));
+
+		float32x4_t pt_image_x = vaddq_f32(vdivq_f32(vmulq_f32(vdupq_n_f32(projParams_d.x), pt_camera[0]), pt_camera[2]), vdupq_n_f32(projParams_d.z));
+		float32x4_t pt_image_y = vaddq_f32(vdivq_f32(vmulq_f32(vdupq_n_f32(projParams_d.y), pt_camera[1]), pt_camera[2]), vdupq_n_f32(projParams_d.w));
+
+		updateMask = vandq_u32(updateMask, vcgeq_f32(pt_image_x, vdupq_n_f32(1.0f)));
+		updateMask = vandq_u32(updateMask, vcleq_f32(pt_image_x, vdupq_n_f32((float)(imgSize.x - 2))));
+		updateMask = vandq_u32(updateMask, vcgeq_f32(pt_image_y, vdupq_n_f32(1.0f)));
+		updateMask = vandq_u32(updateMask, vcleq_f32(pt_image_y, vdupq_n_f32((float)(imgSize.y - 2))));
+		if (vmaxvq_u32(updateMask) == 0) return;
+
+		// get measured depth from image, there is no gather so the lanes are read one by one
+		int32x4_t pixelIds = vaddq_s32(vcvtq_s32_f32(vaddq_f32(pt_image_x, vdupq_n_f32(0.5f))),
+			vmulq_s32(vcvtq_s32_f32(vaddq_f32(pt_image_y, vdupq_n_f32(0.5f))), vdupq_n_s32(imgSize.x)));
+
+		int32_t pixelId_lanes[4]; uint32_t mask_lanes[4]; float depth_lanes[4];
+		vst1q_s32(pixelId_lanes, pixelIds);
+		vst1q_u32(mask_lanes, updateMask);
+		for (int x = 0; x < 4; x++) depth_lanes[x] = mask_lanes[x] != 0 ? depth[pixelId_lanes[x]] : 0.0f;
+
+		float32x4_t depth_measure = vld1q_f32(depth_lanes);
+		updateMask = vandq_u32(updateMask, vcgtq_f32(depth_measure, vdupq_n_f32(0.0f)));
+
+		// check whether voxel needs updating
+		float32x4_t eta = vsubq_f32(depth_measure, pt_camera[2]);
+		updateMask = vandq_u32(updateMask, vcgeq_f32(eta, vdupq_n_f32(-mu)));
+		if (vmaxvq_u32(updateMask) == 0) return;
+
+		// compute updated SDF value and reliability, the comparison keeps the operand order of MIN
+		float32x4_t newF = vdivq_f32(eta, vdupq_n_f32(mu));
+		newF = vbslq_f32(vcltq_f32(vdupq_n_f32(1.0f), newF), vdupq_n_f32(1.0f), newF);
+		newF = vaddq_f32(vmulq_f32(vcvtq_f32_s32(w_depth), sdf), newF);
+
+		int32x4_t newW = vaddq_s32(w_depth, vdupq_n_s32(1));
+		newF = vdivq_f32(newF, vcvtq_f32_s32(newW));
+		newW = vminq_s32(newW, vdupq_n_s32(maxW));
+
+		ITMVoxelRow_NEON<TVoxel>::Store(voxelRow, newF, newW, updateMask);
+	}
+
+	template<>
+	struct ITMVoxelRowIntegrator<ITMVoxel_s>
+	{
+		static const bool isVectorised = SDF_BLOCK_SIZE == 8 && sizeof(ITMVoxel_s) == 4;
+
+		static void Integrate(ITMVoxel_s *voxelRow, const Vector3i &rowPos, float voxelSize, const Matrix4f &M_d, const Vector4f &projParams_d,
+			float mu, int maxW, bool stopIntegratingAtMaxW, const float *depth, const Vector2i &imgSize)
+		{
+			integrateVoxelRow_NEON(voxelRow, rowPos, voxelSize, M_d, projParams_d, mu, maxW, stopIntegratingAtMaxW, depth, imgSize);
+			integrateVoxelRow_NEON(voxelRow + 4, Vector3i(rowPos.x + 4, rowPos.y, rowPos.z), voxelSize, M_d, projParams_d, mu, maxW, stopIntegratingAtMaxW, depth, imgSize);
+		}
+	};
+
+	template<>
+	struct ITMVoxelRowIntegrator<ITMVoxel_f>
+	{
+		static const bool isVectorised = SDF_BLOCK_SIZE == 8 && sizeof(ITMVoxel_f) == 8;
+
+		static void Integrate(ITMVoxel_f *voxelRow, const Vector3i &rowPos, float voxelSize, const Matrix4f &M_d, const Vector4f &projParams_d,
+			float mu, int maxW, bool stopIntegratingAtMaxW, const float *depth, const Vector2i &imgSize)
+		{
+			integrateVoxelRow_NEON(voxelRow, rowPos, voxelSize, M_d, projParams_d, mu, maxW, stopIntegratingAtMaxW, depth, imgSize);
+			integrateVoxelRow_NEON(voxelRow + 4, Vector3i(rowPos.x + 4, rowPos.y, rowPos.z), voxelSize, M_d, projParams_d, mu, maxW, stopIntegratingAtMaxW, depth, imgSize);
+		}
+	};
+
+	template<>
+	struct ITMVoxelRowIntegrator<ITMVoxel_u8>
+	{
+		static const bool isVectorised = SDF_BLOCK_SIZE == 8 && sizeof(ITMVoxel_u8) == 2;
+
+		static void Integrate(ITMVoxel_u8 *voxelRow, const Vector3i &rowPos, float voxelSize, const Matrix4f &M_d, const Vector4f &projParams_d,
+			float mu, int maxW, bool stopIntegratingAtMaxW, const float *depth, const Vector2i &imgSize)
+		{
+			integrateVoxelRow_NEON(voxelRow, rowPos, voxelSize, M_d, projParams_d, mu, maxW, stopIntegratingAtMaxW, depth, imgSize);
+			integrateVoxelRow_NEON(voxelRow + 4, Vector3i(rowPos.x + 4, rowPos.y, rowPos.z), voxelSize, M_d, projParams_d, mu, maxW, stopIntegratingAtMaxW, depth, imgSize);
+		}
+	};
+
+	template<>
+	struct ITMVoxelRowIntegrator<ITMVoxel_h>
+	{
+		static const bool isVectorised = SDF_BLOCK_SIZE == 8 && sizeof(ITMVoxel_h) == 4;
+
+		static void Integrate(ITMVoxel_h *voxelRow, const Vector3i &rowPos, float voxelSize, const Matrix4f &M_d, const Vector4f &projParams_d,
+			float mu, int maxW, bool stopIntegratingAtMaxW, const float *depth, const Vector2i &imgSize)
+		{
+			integrateVoxelRow_NEON(voxelRow, rowPos, voxelSize, M_d, projParams_d, mu, maxW, stopIntegratingAtMaxW, depth, imgSize);
+			integrateVoxelRow_NEON(voxelRow + 4, Vector3i(rowPos.x + 4, rowPos.y, rowPos.z), voxelSize, M_d, projParams_d, mu, maxW, stopIntegratingAtMaxW, depth, imgSize);
+		}
+	};
+
+#endif
+}
@@ -29,7 +29,7 @@ namespace ITMLib
 		void IntegrateIntoScene(ITMScene<TVoxel, ITMVoxelBlockHash> *scene, const ITMView *view, const ITMTrackingState *trackingState,
 			const ITMRenderState *renderState);
 
-		ITMSceneReconstructionEngine_CUDA(void);
+		explicit ITMSceneReconstructionEngine_CUDA(const ITMSceneParams *sceneParams);
 		~ITMSceneReconstructionEngine_CUDA(void);
 	};
 
@@ -37,6 +37,8 @@ namespace ITMLib
 	class ITMSceneReconstructionEngine_CUDA<TVoxel, ITMPlainVoxelArray> : public ITMSceneReconstructionEngine < TVoxel, ITMPlainVoxelArray >
 	{
 	public:
+		explicit ITMSceneReconstructionEngine_CUDA(const ITMSceneParams *sceneParams) {}
+
 		void ResetScene(ITMScene<TVoxel, ITMPlainVoxelArray> *scene);
 
 		void AllocateSceneFromDepth(ITMScene<TVoxel, ITMPlainVoxelArray> *scene, const ITMView *view, const ITMTrackingState *trackingState,
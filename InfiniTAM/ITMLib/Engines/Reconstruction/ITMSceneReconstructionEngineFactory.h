@@ -24,25 +24,26 @@ struct ITMSceneReconstructionEngineFactory
    * \brief Makes a scene reconstruction engine.
    *
    * \param deviceType  The device on which the scene reconstruction engine should operate.
+   * \param sceneParams The scene parameters, used to size the buffers for the voxel block hash.
    */
   template <typename TVoxel, typename TIndex>
-  static ITMSceneReconstructionEngine<TVoxel,TIndex> *MakeSceneReconstructionEngine(ITMLibSettings::DeviceType deviceType)
+  static ITMSceneReconstructionEngine<TVoxel,TIndex> *MakeSceneReconstructionEngine(ITMLibSettings::DeviceType deviceType, const ITMSceneParams *sceneParams)
   {
     ITMSceneReconstructionEngine<TVoxel,TIndex> *sceneRecoEngine = NULL;
 
     switch(deviceType)
     {
       case ITMLibSettings::DEVICE_CPU:
-        sceneRecoEngine = new ITMSceneReconstructionEngine_CPU<TVoxel,TIndex>;
+        sceneRecoEngine = new ITMSceneReconstructionEngine_CPU<TVoxel,TIndex>(sceneParams);
         break;
       case ITMLibSettings::DEVICE_CUDA:
 #ifndef COMPILE_WITHOUT_CUDA
-        sceneRecoEngine = new ITMSceneReconstructionEngine_CUDA<TVoxel,TIndex>;
+        sceneRecoEngine = new ITMSceneReconstructionEngine_CUDA<TVoxel,TIndex>(sceneParams);
 #endif
         break;
       case ITMLibSettings::DEVICE_METAL:
 #ifdef COMPILE_WITH_METAL
-        sceneRecoEngine = new ITMSceneReconstructionEngine_Metal<TVoxel,TIndex>;
+        sceneRecoEngine = new ITMSceneReconstructionEngine_Metal<TVoxel,TIndex>(sceneParams);
 #endif
         break;
     }
@@ -41,6 +41,16 @@ namespace ITMLib
 		virtual void IntegrateIntoScene(ITMScene<TVoxel,TIndex> *scene, const ITMView *view, const ITMTrackingState *trackingState,
 			const ITMRenderState *renderState) = 0;
 
+		/** Return the voxel blocks that hold no surface to the
+		    free lists, so that their memory can be reused. Only
+		    blocks that are not visible in @p renderState are
+		    considered, as the visible ones would be allocated
+		    again right away. Returns the number of freed blocks.
+		    Engines that do not support this leave the scene
+		    unchanged.
+		*/
+		virtual int FreeEmptyBlocks(ITMScene<TVoxel,TIndex> *scene, const ITMRenderState *renderState) { return 0; }
+
 		ITMSceneReconstructionEngine(void) { }
 		virtual ~ITMSceneReconstructionEngine(void) { }
 	};
@@ -33,7 +33,7 @@ kernel void integrateIntoScene_vh_device(DEVICEPTR(ITMVoxel) *localVBA
 
     Vector4f pt_model; int locId;
 
-    locId = x + y * SDF_BLOCK_SIZE + z * SDF_BLOCK_SIZE * SDF_BLOCK_SIZE;
+    locId = voxelIdInBlock(x, y, z);
     
     pt_model.x = (float)(globalPos.x + x) * params->others.x;
     pt_model.y = (float)(globalPos.y + y) * params->others.x;
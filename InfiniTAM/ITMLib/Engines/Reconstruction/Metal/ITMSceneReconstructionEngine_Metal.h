@@ -25,12 +25,16 @@ namespace ITMLib
                                     const ITMTrackingState *trackingState, const ITMRenderState *renderState,
                                     bool onlyUpdateVisibleList = false, bool resetVisibleList = false);
         
-        ITMSceneReconstructionEngine_Metal(void);
+        explicit ITMSceneReconstructionEngine_Metal(const ITMSceneParams *sceneParams);
     };
     
     template<class TVoxel>
     class ITMSceneReconstructionEngine_Metal<TVoxel,ITMPlainVoxelArray> : public ITMSceneReconstructionEngine_CPU<TVoxel,ITMPlainVoxelArray>
-    { };
+    {
+    public:
+        explicit ITMSceneReconstructionEngine_Metal(const ITMSceneParams *sceneParams)
+         : ITMSceneReconstructionEngine_CPU<TVoxel,ITMPlainVoxelArray>(sceneParams) {}
+    };
 }
 
 #endif
@@ -25,8 +25,8 @@ struct SceneReconstructionEngine_MetalBits
 static SceneReconstructionEngine_MetalBits sr_metalBits;
 
 template<class TVoxel>
-ITMSceneReconstructionEngine_Metal<TVoxel,ITMVoxelBlockHash>::ITMSceneReconstructionEngine_Metal(void)
- : ITMSceneReconstructionEngine_CPU<TVoxel,ITMVoxelBlockHash>()
+ITMSceneReconstructionEngine_Metal<TVoxel,ITMVoxelBlockHash>::ITMSceneReconstructionEngine_Metal(const ITMSceneParams *sceneParams)
+ : ITMSceneReconstructionEngine_CPU<TVoxel,ITMVoxelBlockHash>(sceneParams)
 {
     NSError *errors;
 
@@ -63,7 +63,7 @@ void ITMSceneReconstructionEngine_Metal<TVoxel,ITMVoxelBlockHash>::IntegrateInto
 
     [commandEncoder setComputePipelineState:sr_metalBits.p_integrateIntoScene_vh_device];
     [commandEncoder setBuffer:(__bridge id<MTLBuffer>) scene->localVBA.GetVoxelBlocks_MB()      offset:0 atIndex:0];
-    [commandEncoder setBuffer:(__bridge id<MTLBuffer>) scene->index.GetEntries_MB()             offset:0 atIndex:1];
+    [commandEncoder setBuffer:(__bridge id<MTLBuffer>) scene->index.GetEntries_MB()             offset:sizeof(ITMHashEntry) atIndex:1];
     [commandEncoder setBuffer:(__bridge id<MTLBuffer>) renderState_vh->GetVisibleEntryIDs_MB()  offset:0 atIndex:2];
     [commandEncoder setBuffer:(__bridge id<MTLBuffer>) view->rgb->GetMetalBuffer()              offset:0 atIndex:3];
     [commandEncoder setBuffer:(__bridge id<MTLBuffer>) view->depth->GetMetalBuffer()            offset:0 atIndex:4];
@@ -78,6 +78,12 @@ void ITMSceneReconstructionEngine_Metal<TVoxel,ITMVoxelBlockHash>::IntegrateInto
     [commandBuffer commit];
 
 //    [commandBuffer waitUntilCompleted];
+
+    // stamp the integrated blocks, see ITMVoxelBlockHash::GetChangedBlocks()
+    const ITMHashEntry *hashTable = scene->index.GetEntries();
+    const int *visibleEntryIds = renderState_vh->GetVisibleEntryIDs();
+    for (int entryId = 0; entryId < renderState_vh->noVisibleEntries; entryId++)
+        if (hashTable[visibleEntryIds[entryId]].ptr >= 0) scene->index.StampEntry(visibleEntryIds[entryId]);
 }
 
 template<class TVoxel>
@@ -118,7 +124,7 @@ void ITMSceneReconstructionEngine_Metal<TVoxel,ITMVoxelBlockHash>::BuildAllocAnd
     [commandEncoder setBuffer:(__bridge id<MTLBuffer>) this->entriesAllocType->GetMetalBuffer()     offset:0 atIndex:0];
     [commandEncoder setBuffer:(__bridge id<MTLBuffer>) renderState_vh->GetEntriesVisibleType_MB()   offset:0 atIndex:1];
     [commandEncoder setBuffer:(__bridge id<MTLBuffer>) this->blockCoords->GetMetalBuffer()          offset:0 atIndex:2];
-    [commandEncoder setBuffer:(__bridge id<MTLBuffer>) scene->index.GetEntries_MB()                 offset:0 atIndex:3];
+    [commandEncoder setBuffer:(__bridge id<MTLBuffer>) scene->index.GetEntries_MB()                 offset:sizeof(ITMHashEntry) atIndex:3];
     [commandEncoder setBuffer:(__bridge id<MTLBuffer>) view->depth->GetMetalBuffer()                offset:0 atIndex:4];
     [commandEncoder setBuffer:sr_metalBits.paramsBuffer                                             offset:0 atIndex:5];
 
@@ -167,6 +173,7 @@ void ITMSceneReconstructionEngine_Metal<TVoxel, ITMVoxelBlockHash>::AllocateScen
     uchar *entriesAllocType = this->entriesAllocType->GetData(MEMORYDEVICE_CPU);
     Vector4s *blockCoords = this->blockCoords->GetData(MEMORYDEVICE_CPU);
     int noTotalEntries = scene->index.noTotalEntries;
+    int noBuckets = scene->index.getNumBuckets();
 
     bool useSwapping = scene->useSwapping;
 
@@ -207,8 +214,10 @@ void ITMSceneReconstructionEngine_Metal<TVoxel, ITMVoxelBlockHash>::AllocateScen
                         hashEntry.pos.x = pt_block_all.x; hashEntry.pos.y = pt_block_all.y; hashEntry.pos.z = pt_block_all.z;
                         hashEntry.ptr = voxelAllocationList[vbaIdx];
                         hashEntry.offset = 0;
+                        scene->localVBA.InitialiseBlock(hashEntry.ptr);
 
                         hashTable[targetIdx] = hashEntry;
+                        scene->index.AddLiveEntry(targetIdx, hashEntry.ptr);
                     }
 
                     break;
@@ -224,14 +233,17 @@ void ITMSceneReconstructionEngine_Metal<TVoxel, ITMVoxelBlockHash>::AllocateScen
                         hashEntry.pos.x = pt_block_all.x; hashEntry.pos.y = pt_block_all.y; hashEntry.pos.z = pt_block_all.z;
                         hashEntry.ptr = voxelAllocationList[vbaIdx];
                         hashEntry.offset = 0;
+                        scene->localVBA.InitialiseBlock(hashEntry.ptr);
 
                         int exlOffset = excessAllocationList[exlIdx];
 
                         hashTable[targetIdx].offset = exlOffset + 1; //connect to child
 
-                        hashTable[SDF_BUCKET_NUM + exlOffset] = hashEntry; //add child to the excess list
+                        hashTable[noBuckets + exlOffset] = hashEntry; //add child to the excess list
+
+                        entriesVisibleType[noBuckets + exlOffset] = 1; //make child visible and in memory
 
-                        entriesVisibleType[SDF_BUCKET_NUM + exlOffset] = 1; //make child visible and in memory
+                        scene->index.AddLiveEntry(noBuckets + exlOffset, hashEntry.ptr);
                     }
 
                     break;
@@ -292,7 +304,12 @@ void ITMSceneReconstructionEngine_Metal<TVoxel, ITMVoxelBlockHash>::AllocateScen
             if (entriesVisibleType[targetIdx] > 0 && hashEntry.ptr == -1)
             {
                 vbaIdx = lastFreeVoxelBlockId; lastFreeVoxelBlockId--;
-                if (vbaIdx >= 0) hashTable[targetIdx].ptr = voxelAllocationList[vbaIdx];
+                if (vbaIdx >= 0)
+                {
+                    hashTable[targetIdx].ptr = voxelAllocationList[vbaIdx];
+                    scene->localVBA.InitialiseBlock(hashTable[targetIdx].ptr);
+                    scene->index.AddLiveEntry(targetIdx, hashTable[targetIdx].ptr);
+                }
             }
         }
     }
@@ -181,6 +181,160 @@ struct ComputeUpdatedVoxelInfo<true, true, TVoxel> {
 	}
 };
 
+/** \brief
+    Updates a voxel together with its colour stream, see
+    ITMLocalVBA::GetColourBlocks(). For ordinary voxel types
+    @p colourVoxel is @p voxel itself and ComputeUpdatedVoxelInfo
+    does all the work, for types with hasSeparateColourInformation
+    the colour is fused into @p colourVoxel under the same
+    conditions as it would be into an interleaved voxel.
+*/
+template<bool hasSeparateColour, class TVoxel, class TColourVoxel> struct ComputeUpdatedVoxelStreams;
+
+template<class TVoxel, class TColourVoxel>
+struct ComputeUpdatedVoxelStreams<false, TVoxel, TColourVoxel> {
+	_CPU_AND_GPU_CODE_ static void compute(DEVICEPTR(TVoxel) & voxel, DEVICEPTR(TColourVoxel) & colourVoxel, const THREADPTR(Vector4f) & pt_model,
+		const THREADPTR(Matrix4f) & M_d, const THREADPTR(Vector4f) & projParams_d,
+		const THREADPTR(Matrix4f) & M_rgb, const THREADPTR(Vector4f) & projParams_rgb,
+		float mu, int maxW,
+		const CONSTPTR(float) *depth, const CONSTPTR(float) *confidence, const CONSTPTR(Vector2i) & imgSize_d,
+		const CONSTPTR(Vector4u) *rgb, const THREADPTR(Vector2i) & imgSize_rgb)
+	{
+		ComputeUpdatedVoxelInfo<TVoxel::hasColorInformation, TVoxel::hasConfidenceInformation, TVoxel>::compute(voxel, pt_model, M_d,
+			projParams_d, M_rgb, projParams_rgb, mu, maxW, depth, confidence, imgSize_d, rgb, imgSize_rgb);
+	}
+};
+
+template<class TVoxel, class TColourVoxel>
+struct ComputeUpdatedVoxelStreams<true, TVoxel, TColourVoxel> {
+	_CPU_AND_GPU_CODE_ static void compute(DEVICEPTR(TVoxel) & voxel, DEVICEPTR(TColourVoxel) & colourVoxel, const THREADPTR(Vector4f) & pt_model,
+		const THREADPTR(Matrix4f) & M_d, const THREADPTR(Vector4f) & projParams_d,
+		const THREADPTR(Matrix4f) & M_rgb, const THREADPTR(Vector4f) & projParams_rgb,
+		float mu, int maxW,
+		const CONSTPTR(float) *depth, const CONSTPTR(float) *confidence, const CONSTPTR(Vector2i) & imgSize_d,
+		const CONSTPTR(Vector4u) *rgb, const THREADPTR(Vector2i) & imgSize_rgb)
+	{
+		float eta = computeUpdatedVoxelDepthInfo(voxel, pt_model, M_d, projParams_d, mu, maxW, depth, imgSize_d);
+		if ((eta > mu) || (fabs(eta / mu) > 0.25f)) return;
+		computeUpdatedVoxelColorInfo(colourVoxel, pt_model, M_rgb, projParams_rgb, mu, maxW, eta, rgb, imgSize_rgb);
+	}
+};
+
+/** What integrating a depth image would do to the voxels of a block, see classifyVoxelBlockFootprint. */
+enum VoxelBlockFootprint
+{
+	/** The voxels have to be integrated one by one. */
+	BLOCK_FOOTPRINT_MIXED,
+	/** No voxel is updated: the block is outside the image, has no depth measurements or lies behind the surface beyond mu. */
+	BLOCK_FOOTPRINT_UNOBSERVED,
+	/** Every voxel receives a truncated measurement of 1: the block lies in front of the surface beyond mu. */
+	BLOCK_FOOTPRINT_FREE_SPACE
+};
+
+/** \brief
+    Tests a whole voxel block against the depth image before its
+    voxels are integrated. The corners of the cube spanned by the
+    voxel centres bound the camera depth and, once the block is in
+    front of the camera, the image footprint of all voxels. The
+    footprint is widened by a pixel and the depths by a fraction of a
+    voxel, so the rounding of the per voxel projection can never turn
+    an unobserved or free space block into anything else. Blocks with
+    a footprint larger than their number of voxels are not worth
+    testing and reported as mixed.
+*/
+_CPU_AND_GPU_CODE_ inline VoxelBlockFootprint classifyVoxelBlockFootprint(const THREADPTR(Vector3i) & blockPos, float voxelSize, const CONSTPTR(Matrix4f) & M_d,
+	const CONSTPTR(Vector4f) & projParams_d, float mu, const CONSTPTR(float) *depth, const CONSTPTR(Vector2i) & imgSize)
+{
+	float roundingSlack = 0.01f * voxelSize;
+
+	float minZ = 0.0f, maxZ = 0.0f;
+	Vector2f minImage(0.0f), maxImage(0.0f);
+	for (int cornerId = 0; cornerId < 8; cornerId++)
+	{
+		Vector4f pt_model, pt_camera; Vector2f pt_image;
+
+		pt_model.x = (float)(blockPos.x + (cornerId & 1) * (SDF_BLOCK_SIZE - 1)) * voxelSize;
+		pt_model.y = (float)(blockPos.y + ((cornerId >> 1) & 1) * (SDF_BLOCK_SIZE - 1)) * voxelSize;
+		pt_model.z = (float)(blockPos.z + (cornerId >> 2) * (SDF_BLOCK_SIZE - 1)) * voxelSize;
+		pt_model.w = 1.0f;
+
+		pt_camera = M_d * pt_model;
+		pt_image.x = projParams_d.x * pt_camera.x / pt_camera.z + projParams_d.z;
+		pt_image.y = projParams_d.y * pt_camera.y / pt_camera.z + projParams_d.w;
+
+		if (cornerId == 0) { minZ = maxZ = pt_camera.z; minImage = maxImage = pt_image; continue; }
+
+		minZ = MIN(minZ, pt_camera.z); maxZ = MAX(maxZ, pt_camera.z);
+		minImage.x = MIN(minImage.x, pt_image.x); maxImage.x = MAX(maxImage.x, pt_image.x);
+		minImage.y = MIN(minImage.y, pt_image.y); maxImage.y = MAX(maxImage.y, pt_image.y);
+	}
+
+	// the projection of voxels close to the image plane is unbounded
+	if (maxZ < -roundingSlack) return BLOCK_FOOTPRINT_UNOBSERVED;
+	if (minZ <= roundingSlack) return BLOCK_FOOTPRINT_MIXED;
+
+	// voxels are only integrated if they project to [1, imgSize - 2]
+	if (maxImage.x < 0.0f || maxImage.y < 0.0f || minImage.x > imgSize.x - 1 || minImage.y > imgSize.y - 1) return BLOCK_FOOTPRINT_UNOBSERVED;
+
+	bool isInsideImage = minImage.x >= 2.0f && minImage.y >= 2.0f && maxImage.x <= imgSize.x - 3 && maxImage.y <= imgSize.y - 3;
+
+	// clamped before the conversion, the footprint of blocks close to the camera can be arbitrarily large
+	int minX = MAX((int)(MAX(minImage.x, 0.0f) + 0.5f) - 1, 1), maxX = MIN((int)(MIN(maxImage.x, (float)imgSize.x) + 0.5f) + 1, imgSize.x - 2);
+	int minY = MAX((int)(MAX(minImage.y, 0.0f) + 0.5f) - 1, 1), maxY = MIN((int)(MIN(maxImage.y, (float)imgSize.y) + 0.5f) + 1, imgSize.y - 2);
+	if ((maxX - minX + 1) * (maxY - minY + 1) > SDF_BLOCK_SIZE3) return BLOCK_FOOTPRINT_MIXED;
+
+	// a single measurement within mu of the block means it has to be integrated voxel by voxel
+	bool hasMeasurementsBehind = false, hasMeasurementsInFront = false, hasMissingMeasurements = false;
+	for (int y = minY; y <= maxY; y++) for (int x = minX; x <= maxX; x++)
+	{
+		float depth_measure = depth[x + y * imgSize.x];
+		if (depth_measure <= 0.0f) { hasMissingMeasurements = true; continue; }
+
+		if (depth_measure - minZ < -mu - roundingSlack) hasMeasurementsBehind = true;
+		else if (depth_measure - maxZ >= mu + roundingSlack) hasMeasurementsInFront = true;
+		else return BLOCK_FOOTPRINT_MIXED;
+	}
+
+	if (!hasMeasurementsInFront) return BLOCK_FOOTPRINT_UNOBSERVED;
+	if (!hasMeasurementsBehind && !hasMissingMeasurements && isInsideImage) return BLOCK_FOOTPRINT_FREE_SPACE;
+
+	return BLOCK_FOOTPRINT_MIXED;
+}
+
+/** Depth update of computeUpdatedVoxelDepthInfo for a voxel in a free space block, which always receives a measurement of 1. */
+template<class TVoxel>
+_CPU_AND_GPU_CODE_ inline void updateVoxelDepthInfoFreeSpace(DEVICEPTR(TVoxel) &voxel, int maxW)
+{
+	float oldF, newF;
+	int oldW, newW;
+
+	oldF = TVoxel::valueToFloat(voxel.sdf); oldW = voxel.w_depth;
+
+	newF = 1.0f;
+	newW = 1;
+
+	newF = oldW * oldF + newW * newF;
+	newW = oldW + newW;
+	newF /= newW;
+	newW = MIN(newW, maxW);
+
+	voxel.sdf = TVoxel::floatToValue(newF);
+	voxel.w_depth = newW;
+}
+
+/** A block holds no surface if each of its voxels is either unobserved or truncated in front of the surface. */
+template<class TVoxel>
+_CPU_AND_GPU_CODE_ inline bool isEmptyVoxelBlock(const CONSTPTR(TVoxel) *voxelBlock)
+{
+	for (int locId = 0; locId < SDF_BLOCK_SIZE3; locId++)
+	{
+		const TVoxel & voxel = voxelBlock[locId];
+		if (voxel.w_depth > 0 && TVoxel::valueToFloat(voxel.sdf) < 1.0f) return false;
+	}
+
+	return true;
+}
+
 _CPU_AND_GPU_CODE_ inline void buildHashAllocAndVisibleTypePP(DEVICEPTR(uchar) *entriesAllocType, DEVICEPTR(uchar) *entriesVisibleType, int x, int y,
 	DEVICEPTR(Vector4s) *blockCoords, const CONSTPTR(float) *depth, Matrix4f invM_d, Vector4f projParams_d, float mu, Vector2i imgSize,
 	float oneOverVoxelSize, const CONSTPTR(ITMHashEntry) *hashTable, float viewFrustum_min, float viewFrustum_max)
@@ -211,13 +365,15 @@ _CPU_AND_GPU_CODE_ inline void buildHashAllocAndVisibleTypePP(DEVICEPTR(uchar) *
 
 	direction /= (float)(noSteps - 1);
 
+	int hashMask = getHashMask(hashTable), noBuckets = getNumHashBuckets(hashTable);
+
 	//add neighbouring blocks
 	for (int i = 0; i < noSteps; i++)
 	{
 		blockPos = TO_SHORT_FLOOR3(point);
 
 		//compute index in hash table
-		hashIdx = hashIndex(blockPos);
+		hashIdx = hashIndex(blockPos, hashMask);
 
 		//check if hash table contains entry
 		bool isFound = false;
@@ -239,7 +395,7 @@ _CPU_AND_GPU_CODE_ inline void buildHashAllocAndVisibleTypePP(DEVICEPTR(uchar) *
 			{
 				while (hashEntry.offset >= 1)
 				{
-					hashIdx = SDF_BUCKET_NUM + hashEntry.offset - 1;
+					hashIdx = noBuckets + hashEntry.offset - 1;
 					hashEntry = hashTable[hashIdx];
 
 					if (IS_EQUAL3(hashEntry.pos, blockPos) && hashEntry.ptr >= -1)
@@ -268,6 +424,77 @@ _CPU_AND_GPU_CODE_ inline void buildHashAllocAndVisibleTypePP(DEVICEPTR(uchar) *
 	}
 }
 
+#ifndef __METALC__
+_CPU_AND_GPU_CODE_ inline void buildProbingHashAllocAndVisibleTypePP(DEVICEPTR(uchar) *entriesAllocType, DEVICEPTR(uchar) *entriesVisibleType, int x, int y,
+	DEVICEPTR(Vector4s) *blockCoords, const CONSTPTR(float) *depth, Matrix4f invM_d, Vector4f projParams_d, float mu, Vector2i imgSize,
+	float oneOverVoxelSize, const CONSTPTR(ITMProbingHashEntry) *hashTable, float viewFrustum_min, float viewFrustum_max)
+{
+	float depth_measure; int noSteps;
+	Vector4f pt_camera_f; Vector3f point_e, point, direction; Vector3s blockPos;
+
+	depth_measure = depth[x + y * imgSize.x];
+	if (depth_measure <= 0 || (depth_measure - mu) < 0 || (depth_measure - mu) < viewFrustum_min || (depth_measure + mu) > viewFrustum_max) return;
+
+	pt_camera_f.z = depth_measure;
+	pt_camera_f.x = pt_camera_f.z * ((float(x) - projParams_d.z) * projParams_d.x);
+	pt_camera_f.y = pt_camera_f.z * ((float(y) - projParams_d.w) * projParams_d.y);
+
+	float norm = sqrt(pt_camera_f.x * pt_camera_f.x + pt_camera_f.y * pt_camera_f.y + pt_camera_f.z * pt_camera_f.z);
+
+	Vector4f pt_buff;
+
+	pt_buff = pt_camera_f * (1.0f - mu / norm); pt_buff.w = 1.0f;
+	point = TO_VECTOR3(invM_d * pt_buff) * oneOverVoxelSize;
+
+	pt_buff = pt_camera_f * (1.0f + mu / norm); pt_buff.w = 1.0f;
+	point_e = TO_VECTOR3(invM_d * pt_buff) * oneOverVoxelSize;
+
+	direction = point_e - point;
+	norm = sqrt(direction.x * direction.x + direction.y * direction.y + direction.z * direction.z);
+	noSteps = (int)ceil(2.0f*norm);
+
+	direction /= (float)(noSteps - 1);
+
+	int hashMask = getHashMask(hashTable);
+
+	//add neighbouring blocks
+	for (int i = 0; i < noSteps; i++)
+	{
+		blockPos = TO_SHORT_FLOOR3(point);
+
+		//probe from the home slot until the block or a free slot is found
+		unsigned long long key = packBlockKey(blockPos);
+		int hashIdx = hashIndex(blockPos, hashMask);
+
+		for (int probe = 0; probe <= hashMask; probe++)
+		{
+			const ITMProbingHashEntry &hashEntry = hashTable[hashIdx];
+
+			if (hashEntry.key == key)
+			{
+				//entry has been streamed out but is visible or in memory and visible
+				entriesVisibleType[hashIdx] = (hashEntry.ptr == -1) ? 2 : 1;
+				break;
+			}
+
+			if (hashEntry.key == PROBING_HASH_EMPTY_KEY)
+			{
+				//needs allocation in the first free slot, blocks probing into the same slot are allocated in later frames
+				entriesAllocType[hashIdx] = 1;
+				entriesVisibleType[hashIdx] = 1;
+
+				blockCoords[hashIdx] = Vector4s(blockPos.x, blockPos.y, blockPos.z, 1);
+				break;
+			}
+
+			hashIdx = (hashIdx + 1) & hashMask;
+		}
+
+		point += direction;
+	}
+}
+#endif
+
 template<bool useSwapping>
 _CPU_AND_GPU_CODE_ inline void checkPointVisibility(THREADPTR(bool) &isVisible, THREADPTR(bool) &isVisibleEnlarged,
 	const THREADPTR(Vector4f) &pt_image, const CONSTPTR(Matrix4f) & M_d, const CONSTPTR(Vector4f) &projParams_d,
@@ -344,3 +571,18 @@ _CPU_AND_GPU_CODE_ inline void checkBlockVisibility(THREADPTR(bool) &isVisible,
 	checkPointVisibility<useSwapping>(isVisible, isVisibleEnlarged, pt_image, M_d, projParams_d, imgSize);
 	if (isVisible) return;
 }
+
+/** Checks whether a block lies in the enlarged frustum of the predicted pose @p M_predicted and at most @p maxDepth in front of it. */
+_CPU_AND_GPU_CODE_ inline bool checkBlockPredictedVisibility(const THREADPTR(Vector3s) &hashPos, const CONSTPTR(Matrix4f) & M_predicted,
+	const CONSTPTR(Vector4f) &projParams_d, const CONSTPTR(float) &voxelSize, const CONSTPTR(Vector2i) &imgSize, float maxDepth)
+{
+	float factor = (float)SDF_BLOCK_SIZE * voxelSize;
+
+	Vector4f pt_center((hashPos.x + 0.5f) * factor, (hashPos.y + 0.5f) * factor, (hashPos.z + 0.5f) * factor, 1.0f);
+	if ((M_predicted * pt_center).z > maxDepth + factor) return false;
+
+	bool isVisible, isVisibleEnlarged;
+	checkBlockVisibility<true>(isVisible, isVisibleEnlarged, hashPos, M_predicted, projParams_d, voxelSize, imgSize);
+
+	return isVisibleEnlarged;
+}
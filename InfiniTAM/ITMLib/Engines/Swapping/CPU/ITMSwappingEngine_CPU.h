@@ -12,24 +12,53 @@ namespace ITMLib
 	public:
 		void IntegrateGlobalIntoLocal(ITMScene<TVoxel, TIndex> *scene, ITMRenderState *renderState) {}
 		void SaveToGlobalMemory(ITMScene<TVoxel, TIndex> *scene, ITMRenderState *renderState) {}
-		void CleanLocalMemory(ITMScene<TVoxel, ITMVoxelBlockHash> *scene, ITMRenderState *renderState) {}
+		void CleanLocalMemory(ITMScene<TVoxel, TIndex> *scene, ITMRenderState *renderState) {}
 	};
 
+	/** \brief
+	Swaps voxel blocks between the local voxel block array and the
+	global cache on the CPU. The frame loop only moves blocks in and
+	out of the local voxel block array and hands the lists of blocks
+	to a background thread, which encodes them into the global cache
+	or decodes the requested blocks into a transfer buffer. Blocks
+	requested in one frame are combined with the local data in the
+	next one, and swapped out blocks alternate between two transfer
+	buffers, so the transfers overlap with tracking and raycasting.
+	Without C++11 support the transfers run synchronously.
+	*/
 	template<class TVoxel>
 	class ITMSwappingEngine_CPU<TVoxel, ITMVoxelBlockHash> : public ITMSwappingEngine < TVoxel, ITMVoxelBlockHash >
 	{
 	private:
-		int LoadFromGlobalMemory(ITMScene<TVoxel, ITMVoxelBlockHash> *scene);
+		struct PrivateData;
+		struct TransferJob;
 
-	public:
-		// This class is currently just for debugging purposes -- swaps CPU memory to CPU memory.
-		// Potentially this could stream into the host memory from somwhere else (disk, database, etc.).
+		/** Host transfer buffer set of the global cache used for swapping in, the sets after it are used for swapping out. */
+		static const int swapInBufferId = 0;
+
+		PrivateData *privateData;
+
+		/** Buffer for encoding a voxel block before it is stored in the global cache, only used by the background thread. */
+		uchar *encodedVoxelBlock;
+
+		void LoadFromGlobalMemory(ITMGlobalCache<TVoxel> *globalCache, int bufferId);
+		void StoreInGlobalMemory(ITMGlobalCache<TVoxel> *globalCache, int bufferId, int sdfBits);
 
+		void StartTransfer(const TransferJob & job);
+		void RunTransfer(const TransferJob & job);
+		void RethrowTransferError(void);
+		void transferThreadMain(void);
+
+	public:
 		void IntegrateGlobalIntoLocal(ITMScene<TVoxel, ITMVoxelBlockHash> *scene, ITMRenderState *renderState);
 		void SaveToGlobalMemory(ITMScene<TVoxel, ITMVoxelBlockHash> *scene, ITMRenderState *renderState);
 		void CleanLocalMemory(ITMScene<TVoxel, ITMVoxelBlockHash> *scene, ITMRenderState *renderState);
 
 		ITMSwappingEngine_CPU(void);
 		~ITMSwappingEngine_CPU(void);
+
+		// Suppress the default copy constructor and assignment operator
+		ITMSwappingEngine_CPU(const ITMSwappingEngine_CPU&);
+		ITMSwappingEngine_CPU& operator=(const ITMSwappingEngine_CPU&);
 	};
 }
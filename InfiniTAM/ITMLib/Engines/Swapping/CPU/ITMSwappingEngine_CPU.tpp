@@ -3,66 +3,177 @@
 #include "ITMSwappingEngine_CPU.h"
 
 #include "../Shared/ITMSwappingEngine_Shared.h"
+#include "../Shared/ITMVoxelBlockCodec.h"
 #include "../../../Objects/RenderStates/ITMRenderState_VH.h"
+
+#ifndef NO_CPP11
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#endif
+
 using namespace ITMLib;
 
+template<class TVoxel>
+struct ITMSwappingEngine_CPU<TVoxel, ITMVoxelBlockHash>::TransferJob
+{
+	ITMGlobalCache<TVoxel> *globalCache;
+	int bufferId;
+	int sdfBits;
+	bool swapIn;
+};
+
+template<class TVoxel>
+struct ITMSwappingEngine_CPU<TVoxel, ITMVoxelBlockHash>::PrivateData
+{
+#ifndef NO_CPP11
+	PrivateData(void) { stopThread = false; }
+	std::mutex queueMutex;
+	std::condition_variable queueCond;
+	std::deque<TransferJob> queue;
+	std::thread transferThread;
+	bool stopThread;
+
+	/** First exception thrown by the background thread, rethrown on the calling thread. */
+	std::exception_ptr transferError;
+#endif
+};
+
 template<class TVoxel>
 ITMSwappingEngine_CPU<TVoxel,ITMVoxelBlockHash>::ITMSwappingEngine_CPU(void)
 {
+	encodedVoxelBlock = (uchar*)malloc(getMaxEncodedVoxelBlockSize<TVoxel>());
+
+	privateData = new PrivateData();
+#ifndef NO_CPP11
+	privateData->transferThread = std::thread(&ITMSwappingEngine_CPU<TVoxel, ITMVoxelBlockHash>::transferThreadMain, this);
+#endif
 }
 
 template<class TVoxel>
 ITMSwappingEngine_CPU<TVoxel,ITMVoxelBlockHash>::~ITMSwappingEngine_CPU(void)
 {
+#ifndef NO_CPP11
+	// the thread finishes all queued transfers before it stops
+	{
+		std::unique_lock<std::mutex> lock(privateData->queueMutex);
+		privateData->stopThread = true;
+		privateData->queueCond.notify_all();
+	}
+	privateData->transferThread.join();
+#endif
+
+	delete privateData;
+	free(encodedVoxelBlock);
 }
 
 template<class TVoxel>
-int ITMSwappingEngine_CPU<TVoxel, ITMVoxelBlockHash>::LoadFromGlobalMemory(ITMScene<TVoxel, ITMVoxelBlockHash> *scene)
+void ITMSwappingEngine_CPU<TVoxel, ITMVoxelBlockHash>::StartTransfer(const TransferJob & job)
 {
-	ITMGlobalCache<TVoxel> *globalCache = scene->globalCache;
+	job.globalCache->BeginTransfer(job.bufferId);
+
+#ifndef NO_CPP11
+	std::unique_lock<std::mutex> lock(privateData->queueMutex);
+	privateData->queue.push_back(job);
+	privateData->queueCond.notify_one();
+#else
+	RunTransfer(job);
+#endif
+}
 
-	ITMHashSwapState *swapStates = globalCache->GetSwapStates(false);
+template<class TVoxel>
+void ITMSwappingEngine_CPU<TVoxel, ITMVoxelBlockHash>::RunTransfer(const TransferJob & job)
+{
+	if (job.swapIn) LoadFromGlobalMemory(job.globalCache, job.bufferId);
+	else StoreInGlobalMemory(job.globalCache, job.bufferId, job.sdfBits);
+}
 
-	int *neededEntryIDs_local = globalCache->GetNeededEntryIDs(false);
+template<class TVoxel>
+void ITMSwappingEngine_CPU<TVoxel, ITMVoxelBlockHash>::RethrowTransferError(void)
+{
+#ifndef NO_CPP11
+	std::exception_ptr transferError;
+	{
+		std::unique_lock<std::mutex> lock(privateData->queueMutex);
+		transferError = privateData->transferError;
+		privateData->transferError = std::exception_ptr();
+	}
+	if (transferError) std::rethrow_exception(transferError);
+#endif
+}
 
-	TVoxel *syncedVoxelBlocks_global = globalCache->GetSyncedVoxelBlocks(false);
-	bool *hasSyncedData_global = globalCache->GetHasSyncedData(false);
-	int *neededEntryIDs_global = globalCache->GetNeededEntryIDs(false);
+template<class TVoxel>
+void ITMSwappingEngine_CPU<TVoxel, ITMVoxelBlockHash>::transferThreadMain(void)
+{
+#ifndef NO_CPP11
+	while (true)
+	{
+		TransferJob job;
+		{
+			std::unique_lock<std::mutex> lock(privateData->queueMutex);
+			while (privateData->queue.empty() && !privateData->stopThread) privateData->queueCond.wait(lock);
+			if (privateData->queue.empty()) break;
 
-	int noTotalEntries = globalCache->noTotalEntries;
+			job = privateData->queue.front();
+			privateData->queue.pop_front();
+		}
 
-	int noNeededEntries = 0;
-	for (int entryId = 0; entryId < noTotalEntries; entryId++)
-	{
-		if (noNeededEntries >= SDF_TRANSFER_BLOCK_NUM) break;
-		if (swapStates[entryId].state == 1)
+		try
 		{
-			neededEntryIDs_local[noNeededEntries] = entryId;
-			noNeededEntries++;
+			RunTransfer(job);
+		}
+		catch (...)
+		{
+			std::unique_lock<std::mutex> lock(privateData->queueMutex);
+			if (!privateData->transferError) privateData->transferError = std::current_exception();
 		}
+
+		job.globalCache->EndTransfer(job.bufferId);
 	}
+#endif
+}
 
-	// would copy neededEntryIDs_local into neededEntryIDs_global here
+template<class TVoxel>
+void ITMSwappingEngine_CPU<TVoxel, ITMVoxelBlockHash>::LoadFromGlobalMemory(ITMGlobalCache<TVoxel> *globalCache, int bufferId)
+{
+	TVoxel *syncedVoxelBlocks_global = globalCache->GetSyncedVoxelBlocks(false, bufferId);
+	bool *hasSyncedData_global = globalCache->GetHasSyncedData(false, bufferId);
+	int *neededEntryIDs_global = globalCache->GetNeededEntryIDs(false, bufferId);
 
-	if (noNeededEntries > 0)
+	int noNeededEntries = globalCache->GetNoTransferEntries(bufferId);
+
+	memset(hasSyncedData_global, 0, noNeededEntries * sizeof(bool));
+	for (int i = 0; i < noNeededEntries; i++)
 	{
-		memset(syncedVoxelBlocks_global, 0, noNeededEntries * SDF_BLOCK_SIZE3 * sizeof(TVoxel));
-		memset(hasSyncedData_global, 0, noNeededEntries * sizeof(bool));
-		for (int i = 0; i < noNeededEntries; i++)
-		{
-			int entryId = neededEntryIDs_global[i];
+		int entryId = neededEntryIDs_global[i];
 
-			if (globalCache->HasStoredData(entryId))
-			{
-				hasSyncedData_global[i] = true;
-				memcpy(syncedVoxelBlocks_global + i * SDF_BLOCK_SIZE3, globalCache->GetStoredVoxelBlock(entryId), SDF_BLOCK_SIZE3 * sizeof(TVoxel));
-			}
+		if (globalCache->HasStoredData(entryId))
+		{
+			hasSyncedData_global[i] = true;
+			decodeVoxelBlock(globalCache->GetStoredData(entryId), syncedVoxelBlocks_global + i * SDF_BLOCK_SIZE3);
 		}
 	}
+}
 
-	// would copy syncedVoxelBlocks_global and hasSyncedData_global and syncedVoxelBlocks_local and hasSyncedData_local here
+template<class TVoxel>
+void ITMSwappingEngine_CPU<TVoxel, ITMVoxelBlockHash>::StoreInGlobalMemory(ITMGlobalCache<TVoxel> *globalCache, int bufferId, int sdfBits)
+{
+	TVoxel *syncedVoxelBlocks_global = globalCache->GetSyncedVoxelBlocks(false, bufferId);
+	bool *hasSyncedData_global = globalCache->GetHasSyncedData(false, bufferId);
+	int *neededEntryIDs_global = globalCache->GetNeededEntryIDs(false, bufferId);
 
-	return noNeededEntries;
+	int noNeededEntries = globalCache->GetNoTransferEntries(bufferId);
+
+	for (int entryId = 0; entryId < noNeededEntries; entryId++)
+	{
+		if (hasSyncedData_global[entryId])
+		{
+			int encodedSize = encodeVoxelBlock(syncedVoxelBlocks_global + entryId * SDF_BLOCK_SIZE3, encodedVoxelBlock, sdfBits);
+			globalCache->SetStoredData(neededEntryIDs_global[entryId], encodedVoxelBlock, encodedSize);
+		}
+	}
 }
 
 template<class TVoxel>
@@ -74,20 +185,27 @@ void ITMSwappingEngine_CPU<TVoxel, ITMVoxelBlockHash>::IntegrateGlobalIntoLocal(
 
 	ITMHashSwapState *swapStates = globalCache->GetSwapStates(false);
 
-	TVoxel *syncedVoxelBlocks_local = globalCache->GetSyncedVoxelBlocks(false);
-	bool *hasSyncedData_local = globalCache->GetHasSyncedData(false);
-	int *neededEntryIDs_local = globalCache->GetNeededEntryIDs(false);
+	TVoxel *syncedVoxelBlocks_local = globalCache->GetSyncedVoxelBlocks(false, swapInBufferId);
+	bool *hasSyncedData_local = globalCache->GetHasSyncedData(false, swapInBufferId);
+	int *neededEntryIDs_local = globalCache->GetNeededEntryIDs(false, swapInBufferId);
 
 	TVoxel *localVBA = scene->localVBA.GetVoxelBlocks();
 
-	int noNeededEntries = this->LoadFromGlobalMemory(scene);
-
 	int maxW = scene->sceneParams->maxW;
 
+	// combine the blocks requested by the previous call
+	globalCache->WaitForTransfer(swapInBufferId);
+	RethrowTransferError();
+
+	int noNeededEntries = globalCache->GetNoTransferEntries(swapInBufferId);
+
 	for (int i = 0; i < noNeededEntries; i++)
 	{
 		int entryDestId = neededEntryIDs_local[i];
 
+		// skip entries that have been reset in the meantime
+		if (swapStates[entryDestId].state != 1 || hashTable[entryDestId].ptr < 0) continue;
+
 		if (hasSyncedData_local[i])
 		{
 			TVoxel *srcVB = syncedVoxelBlocks_local + i * SDF_BLOCK_SIZE3;
@@ -97,10 +215,37 @@ void ITMSwappingEngine_CPU<TVoxel, ITMVoxelBlockHash>::IntegrateGlobalIntoLocal(
 			{
 				CombineVoxelInformation<TVoxel::hasColorInformation, TVoxel>::compute(srcVB[vIdx], dstVB[vIdx], maxW);
 			}
+
+			scene->index.StampEntry(entryDestId);
 		}
 
 		swapStates[entryDestId].state = 2;
 	}
+
+	// request the next blocks that have a local voxel block to be combined into, they are loaded in the background
+	const int *liveEntryIDs = scene->index.GetLiveEntryIDs();
+	int noLiveEntries = scene->index.GetNoLiveEntries();
+
+	noNeededEntries = 0;
+	for (int liveId = 0; liveId < noLiveEntries; liveId++)
+	{
+		if (noNeededEntries >= SDF_TRANSFER_BLOCK_NUM) break;
+
+		int entryId = liveEntryIDs[liveId];
+		if (swapStates[entryId].state == 1)
+		{
+			neededEntryIDs_local[noNeededEntries] = entryId;
+			noNeededEntries++;
+		}
+	}
+
+	globalCache->SetNoTransferEntries(swapInBufferId, noNeededEntries);
+
+	if (noNeededEntries > 0)
+	{
+		TransferJob job = { globalCache, swapInBufferId, scene->sceneParams->swapSdfBits, true };
+		StartTransfer(job);
+	}
 }
 
 template<class TVoxel>
@@ -113,26 +258,30 @@ void ITMSwappingEngine_CPU<TVoxel, ITMVoxelBlockHash>::SaveToGlobalMemory(ITMSce
 	ITMHashEntry *hashTable = scene->index.GetEntries();
 	uchar *entriesVisibleType = ((ITMRenderState_VH*)renderState)->GetEntriesVisibleType();
 
-	TVoxel *syncedVoxelBlocks_local = globalCache->GetSyncedVoxelBlocks(false);
-	bool *hasSyncedData_local = globalCache->GetHasSyncedData(false);
-	int *neededEntryIDs_local = globalCache->GetNeededEntryIDs(false);
+	// alternate between the two swap out buffers, waiting for the older transfer if both are busy
+	int bufferId = globalCache->IsTransferPending(swapInBufferId + 1) ? swapInBufferId + 2 : swapInBufferId + 1;
+	globalCache->WaitForTransfer(bufferId);
+	RethrowTransferError();
 
-	TVoxel *syncedVoxelBlocks_global = globalCache->GetSyncedVoxelBlocks(false);
-	bool *hasSyncedData_global = globalCache->GetHasSyncedData(false);
-	int *neededEntryIDs_global = globalCache->GetNeededEntryIDs(false);
+	TVoxel *syncedVoxelBlocks_local = globalCache->GetSyncedVoxelBlocks(false, bufferId);
+	bool *hasSyncedData_local = globalCache->GetHasSyncedData(false, bufferId);
+	int *neededEntryIDs_local = globalCache->GetNeededEntryIDs(false, bufferId);
 
 	TVoxel *localVBA = scene->localVBA.GetVoxelBlocks();
 	int *voxelAllocationList = scene->localVBA.GetAllocationList();
 
-	int noTotalEntries = globalCache->noTotalEntries;
-	
+	const int *liveEntryIDs = scene->index.GetLiveEntryIDs();
+
 	int noNeededEntries = 0;
 	int noAllocatedVoxelEntries = scene->localVBA.lastFreeBlockId;
+	int noLocalBlocks = scene->index.getNumAllocatedVoxelBlocks();
 
-	for (int entryDestId = 0; entryDestId < noTotalEntries; entryDestId++)
+	// backwards, so that the entries moved into the place of removed ones have already been visited
+	for (int liveId = scene->index.GetNoLiveEntries() - 1; liveId >= 0; liveId--)
 	{
 		if (noNeededEntries >= SDF_TRANSFER_BLOCK_NUM) break;
 
+		int entryDestId = liveEntryIDs[liveId];
 		int localPtr = hashTable[entryDestId].ptr;
 		ITMHashSwapState &swapState = swapStates[entryDestId];
 
@@ -148,13 +297,16 @@ void ITMSwappingEngine_CPU<TVoxel, ITMVoxelBlockHash>::SaveToGlobalMemory(ITMSce
 			swapStates[entryDestId].state = 0;
 
 			int vbaIdx = noAllocatedVoxelEntries;
-			if (vbaIdx < SDF_BUCKET_NUM - 1)
+			if (vbaIdx < noLocalBlocks - 1)
 			{
 				noAllocatedVoxelEntries++;
 				voxelAllocationList[vbaIdx + 1] = localPtr;
+				scene->index.RemoveLiveEntry(localPtr);
 				hashTable[entryDestId].ptr = -1;
+				scene->index.StampEntry(entryDestId);
 
-				for (int i = 0; i < SDF_BLOCK_SIZE3; i++) localVBALocation[i] = TVoxel();
+				// cleared when the block is handed out again
+				scene->localVBA.ReleaseBlock(localPtr);
 			}
 
 			noNeededEntries++;
@@ -163,15 +315,13 @@ void ITMSwappingEngine_CPU<TVoxel, ITMVoxelBlockHash>::SaveToGlobalMemory(ITMSce
 
 	scene->localVBA.lastFreeBlockId = noAllocatedVoxelEntries;
 
-	// would copy neededEntryIDs_local, hasSyncedData_local and syncedVoxelBlocks_local into *_global here
+	globalCache->SetNoTransferEntries(bufferId, noNeededEntries);
 
+	// the blocks are encoded and stored in the background
 	if (noNeededEntries > 0)
 	{
-		for (int entryId = 0; entryId < noNeededEntries; entryId++)
-		{
-			if (hasSyncedData_global[entryId])
-				globalCache->SetStoredData(neededEntryIDs_global[entryId], syncedVoxelBlocks_global + entryId * SDF_BLOCK_SIZE3);
-		}
+		TransferJob job = { globalCache, bufferId, scene->sceneParams->swapSdfBits, false };
+		StartTransfer(job);
 	}
 }
 
@@ -181,32 +331,35 @@ void ITMSwappingEngine_CPU<TVoxel, ITMVoxelBlockHash>::CleanLocalMemory(ITMScene
 	ITMHashEntry *hashTable = scene->index.GetEntries();
 	uchar *entriesVisibleType = ((ITMRenderState_VH*)renderState)->GetEntriesVisibleType();
 
-	TVoxel *localVBA = scene->localVBA.GetVoxelBlocks();
 	int *voxelAllocationList = scene->localVBA.GetAllocationList();
 
-	int noTotalEntries = scene->index.noTotalEntries;
+	const int *liveEntryIDs = scene->index.GetLiveEntryIDs();
 
 	int noNeededEntries = 0;
 	int noAllocatedVoxelEntries = scene->localVBA.lastFreeBlockId;
+	int noLocalBlocks = scene->index.getNumAllocatedVoxelBlocks();
 
-	for (int entryDestId = 0; entryDestId < noTotalEntries; entryDestId++)
+	// backwards, so that the entries moved into the place of removed ones have already been visited
+	for (int liveId = scene->index.GetNoLiveEntries() - 1; liveId >= 0; liveId--)
 	{
 		if (noNeededEntries >= SDF_TRANSFER_BLOCK_NUM) break;
 
+		int entryDestId = liveEntryIDs[liveId];
 		int localPtr = hashTable[entryDestId].ptr;
 
 		if (localPtr >= 0 && entriesVisibleType[entryDestId] == 0)
 		{
-			TVoxel *localVBALocation = localVBA + localPtr * SDF_BLOCK_SIZE3;
-
 			int vbaIdx = noAllocatedVoxelEntries;
-			if (vbaIdx < SDF_BUCKET_NUM - 1)
+			if (vbaIdx < noLocalBlocks - 1)
 			{
 				noAllocatedVoxelEntries++;
 				voxelAllocationList[vbaIdx + 1] = localPtr;
+				scene->index.RemoveLiveEntry(localPtr);
 				hashTable[entryDestId].ptr = -1;
+				scene->index.StampEntry(entryDestId);
 
-				for (int i = 0; i < SDF_BLOCK_SIZE3; i++) localVBALocation[i] = TVoxel();
+				// cleared when the block is handed out again
+				scene->localVBA.ReleaseBlock(localPtr);
 			}
 
 			noNeededEntries++;
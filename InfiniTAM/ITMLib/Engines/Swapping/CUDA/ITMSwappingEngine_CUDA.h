@@ -10,9 +10,11 @@ namespace ITMLib
 	class ITMSwappingEngine_CUDA : public ITMSwappingEngine < TVoxel, TIndex >
 	{
 	public:
+		explicit ITMSwappingEngine_CUDA(const ITMSceneParams *sceneParams) {}
+
 		void IntegrateGlobalIntoLocal(ITMScene<TVoxel, TIndex> *scene, ITMRenderState *renderState) {}
 		void SaveToGlobalMemory(ITMScene<TVoxel, TIndex> *scene, ITMRenderState *renderState) {}
-		void CleanLocalMemory(ITMScene<TVoxel, ITMVoxelBlockHash> *scene, ITMRenderState *renderState) {}
+		void CleanLocalMemory(ITMScene<TVoxel, TIndex> *scene, ITMRenderState *renderState) {}
 	};
 
 	template<class TVoxel>
@@ -22,6 +24,9 @@ namespace ITMLib
 		int *noNeededEntries_device, *noAllocatedVoxelEntries_device;
 		int *entriesToClean_device;
 
+		/** Buffer for encoding a voxel block before it is stored in the global cache. */
+		uchar *encodedVoxelBlock;
+
 		int LoadFromGlobalMemory(ITMScene<TVoxel, ITMVoxelBlockHash> *scene);
 
 	public:
@@ -29,7 +34,7 @@ namespace ITMLib
 		void SaveToGlobalMemory(ITMScene<TVoxel, ITMVoxelBlockHash> *scene, ITMRenderState *renderState);
 		void CleanLocalMemory(ITMScene<TVoxel, ITMVoxelBlockHash> *scene, ITMRenderState *renderState);
 
-		ITMSwappingEngine_CUDA(void);
+		explicit ITMSwappingEngine_CUDA(const ITMSceneParams *sceneParams);
 		~ITMSwappingEngine_CUDA(void);
 	};
 }
@@ -24,9 +24,10 @@ struct ITMSwappingEngineFactory
    * \brief Makes a swapping engine.
    *
    * \param deviceType  The device on which the swapping engine should operate.
+   * \param sceneParams The scene parameters, used to size the buffers for the voxel block hash.
    */
   template <typename TVoxel, typename TIndex>
-  static ITMSwappingEngine<TVoxel,TIndex> *MakeSwappingEngine(ITMLibSettings::DeviceType deviceType)
+  static ITMSwappingEngine<TVoxel,TIndex> *MakeSwappingEngine(ITMLibSettings::DeviceType deviceType, const ITMSceneParams *sceneParams)
   {
     ITMSwappingEngine<TVoxel,TIndex> *swappingEngine = NULL;
 
@@ -37,7 +38,7 @@ struct ITMSwappingEngineFactory
         break;
       case ITMLibSettings::DEVICE_CUDA:
 #ifndef COMPILE_WITHOUT_CUDA
-        swappingEngine = new ITMSwappingEngine_CUDA<TVoxel,TIndex>;
+        swappingEngine = new ITMSwappingEngine_CUDA<TVoxel,TIndex>(sceneParams);
 #endif
         break;
       case ITMLibSettings::DEVICE_METAL:
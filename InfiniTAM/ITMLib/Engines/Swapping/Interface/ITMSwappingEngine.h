@@ -19,7 +19,7 @@ namespace ITMLib
 	public:
 		virtual void IntegrateGlobalIntoLocal(ITMScene<TVoxel, TIndex> *scene, ITMRenderState *renderState) = 0;
 		virtual void SaveToGlobalMemory(ITMScene<TVoxel, TIndex> *scene, ITMRenderState *renderState) = 0;
-		virtual void CleanLocalMemory(ITMScene<TVoxel, ITMVoxelBlockHash> *scene, ITMRenderState *renderState) = 0;
+		virtual void CleanLocalMemory(ITMScene<TVoxel, TIndex> *scene, ITMRenderState *renderState) = 0;
 
 		virtual ~ITMSwappingEngine(void) { }
 	};
@@ -0,0 +1,264 @@
+// Copyright 2014-2017 Oxford University Innovation Limited and the authors of InfiniTAM
+
+#pragma once
+
+#include <string.h>
+
+#include "../../../Objects/Scene/ITMVoxelBlockHash.h"
+#include "../../../Objects/Scene/ITMVoxelTypes.h"
+
+/** \brief
+    Host side codec for voxel blocks held in the ITMGlobalCache.
+
+    A block is encoded as a two byte header (format, bytes per sdf
+    value) followed by runs of voxels in memory order. Each run
+    starts with a 16 bit code holding its type and length:
+    - untouched voxels (sdf at SDF_initialValue and no fused
+      observations) are not stored and decode to a default voxel,
+    - literal voxels are stored as one record each,
+    - repeated voxels equal the record of the voxel before them,
+      which covers the truncated parts of the band where the sdf
+      saturates.
+    Records hold the sdf quantised to 8 or 16 bits, w_depth and, if
+    the voxel type has them, colour and confidence. With 16 bits the
+    sdf of the short voxel types is stored exactly. Blocks for which
+    the runs would not save anything are stored as a plain copy.
+    The sdf of ITMVoxel_u8 is stored exactly with either setting.
+
+    Decoding touches every voxel of the block once, independent of
+    the contents.
+*/
+
+#define VOXEL_BLOCK_CODEC_RAW 0
+#define VOXEL_BLOCK_CODEC_RUNS 1
+
+#define VOXEL_RUN_UNTOUCHED 0
+#define VOXEL_RUN_LITERAL 1
+#define VOXEL_RUN_REPEATED 2
+
+namespace ITMLib
+{
+	inline int quantiseSdf(short sdf, int sdfBits)
+	{
+		if (sdfBits == 16) return sdf;
+		int q = (sdf * 127 + (sdf >= 0 ? 16383 : -16383)) / 32767;
+		return MAX(-127, MIN(127, q));
+	}
+
+	inline int quantiseSdf(signed char sdf, int sdfBits)
+	{
+		return sdfBits == 16 ? sdf * 32767 / 127 : sdf;
+	}
+
+	inline int quantiseSdf(float sdf, int sdfBits)
+	{
+		float scale = sdfBits == 16 ? 32767.0f : 127.0f;
+		int q = (int)(sdf * scale + (sdf >= 0.0f ? 0.5f : -0.5f));
+		return MAX(-(int)scale, MIN((int)scale, q));
+	}
+
+	inline void dequantiseSdf(int q, int sdfBits, short & sdf)
+	{
+		sdf = sdfBits == 16 ? (short)q : (short)(q * 32767 / 127);
+	}
+
+	inline void dequantiseSdf(int q, int sdfBits, float & sdf)
+	{
+		sdf = (float)q / (sdfBits == 16 ? 32767.0f : 127.0f);
+	}
+
+	inline void dequantiseSdf(int q, int sdfBits, signed char & sdf)
+	{
+		sdf = sdfBits == 16 ? (signed char)((q * 127 + (q >= 0 ? 16383 : -16383)) / 32767) : (signed char)q;
+	}
+
+	inline void dequantiseSdf(int q, int sdfBits, ITMHalf & sdf)
+	{
+		float value;
+		dequantiseSdf(q, sdfBits, value);
+		sdf = ITMHalf(value);
+	}
+
+	template<bool hasColor, class TVoxel> struct VoxelColorCodec;
+
+	template<class TVoxel>
+	struct VoxelColorCodec<false, TVoxel> {
+		static const int recordSize = 0;
+		static bool isUntouched(const TVoxel & voxel) { return true; }
+		static uchar *encode(const TVoxel & voxel, uchar *data) { return data; }
+		static const uchar *decode(const uchar *data, TVoxel & voxel) { return data; }
+	};
+
+	template<class TVoxel>
+	struct VoxelColorCodec<true, TVoxel> {
+		static const int recordSize = 4;
+		static bool isUntouched(const TVoxel & voxel) { return voxel.w_color == 0; }
+		static uchar *encode(const TVoxel & voxel, uchar *data)
+		{
+			data[0] = voxel.clr.x; data[1] = voxel.clr.y; data[2] = voxel.clr.z; data[3] = voxel.w_color;
+			return data + 4;
+		}
+		static const uchar *decode(const uchar *data, TVoxel & voxel)
+		{
+			voxel.clr = Vector3u(data[0], data[1], data[2]); voxel.w_color = data[3];
+			return data + 4;
+		}
+	};
+
+	template<bool hasConfidence, class TVoxel> struct VoxelConfidenceCodec;
+
+	template<class TVoxel>
+	struct VoxelConfidenceCodec<false, TVoxel> {
+		static const int recordSize = 0;
+		static uchar *encode(const TVoxel & voxel, uchar *data) { return data; }
+		static const uchar *decode(const uchar *data, TVoxel & voxel) { return data; }
+	};
+
+	template<class TVoxel>
+	struct VoxelConfidenceCodec<true, TVoxel> {
+		static const int recordSize = sizeof(float);
+		static uchar *encode(const TVoxel & voxel, uchar *data)
+		{
+			memcpy(data, &voxel.confidence, sizeof(float));
+			return data + sizeof(float);
+		}
+		static const uchar *decode(const uchar *data, TVoxel & voxel)
+		{
+			memcpy(&voxel.confidence, data, sizeof(float));
+			return data + sizeof(float);
+		}
+	};
+
+	template<class TVoxel>
+	inline bool isUntouchedVoxel(const TVoxel & voxel)
+	{
+		return voxel.w_depth == 0 && voxel.sdf == TVoxel::SDF_initialValue() &&
+			VoxelColorCodec<TVoxel::hasColorInformation, TVoxel>::isUntouched(voxel);
+	}
+
+	template<class TVoxel>
+	inline int getVoxelRecordSize(int sdfBytes)
+	{
+		return sdfBytes + 1 + VoxelColorCodec<TVoxel::hasColorInformation, TVoxel>::recordSize +
+			VoxelConfidenceCodec<TVoxel::hasConfidenceInformation, TVoxel>::recordSize;
+	}
+
+	/** Size of the buffer needed by encodeVoxelBlock for any block. */
+	template<class TVoxel>
+	inline int getMaxEncodedVoxelBlockSize(void)
+	{
+		return 2 + SDF_BLOCK_SIZE3 * (int)MAX(sizeof(TVoxel), sizeof(ushort) + getVoxelRecordSize<TVoxel>(2));
+	}
+
+	/** Encodes a block with the sdf quantised to @p sdfBits (8 or 16) bits and returns the number of bytes written to @p data. */
+	template<class TVoxel>
+	inline int encodeVoxelBlock(const TVoxel *voxelBlock, uchar *data, int sdfBits)
+	{
+		const int rawSize = 2 + SDF_BLOCK_SIZE3 * (int)sizeof(TVoxel);
+		int sdfBytes = sdfBits == 16 ? 2 : 1;
+		int recordSize = getVoxelRecordSize<TVoxel>(sdfBytes);
+
+		data[0] = VOXEL_BLOCK_CODEC_RUNS;
+		data[1] = (uchar)sdfBytes;
+		uchar *ptr = data + 2;
+
+		uchar record[16], lastRecord[16];
+		bool hasLastRecord = false;
+
+		uchar *runCode = NULL;
+		int runType = -1, runLength = 0;
+
+		for (int locId = 0; locId < SDF_BLOCK_SIZE3; locId++)
+		{
+			const TVoxel & voxel = voxelBlock[locId];
+
+			int voxelType = VOXEL_RUN_UNTOUCHED;
+			if (!isUntouchedVoxel(voxel))
+			{
+				short q = (short)quantiseSdf(voxel.sdf, sdfBits);
+				uchar *recordPtr = record;
+				if (sdfBytes == 2) { memcpy(recordPtr, &q, sizeof(short)); recordPtr += sizeof(short); }
+				else *recordPtr++ = (uchar)(signed char)q;
+				*recordPtr++ = voxel.w_depth;
+				recordPtr = VoxelColorCodec<TVoxel::hasColorInformation, TVoxel>::encode(voxel, recordPtr);
+				VoxelConfidenceCodec<TVoxel::hasConfidenceInformation, TVoxel>::encode(voxel, recordPtr);
+
+				voxelType = hasLastRecord && memcmp(record, lastRecord, recordSize) == 0 ? VOXEL_RUN_REPEATED : VOXEL_RUN_LITERAL;
+			}
+
+			if (voxelType != runType)
+			{
+				if (runCode != NULL) { ushort code = (ushort)((runType << 14) | runLength); memcpy(runCode, &code, sizeof(ushort)); }
+				runCode = ptr; ptr += sizeof(ushort);
+				runType = voxelType; runLength = 0;
+			}
+			runLength++;
+
+			if (voxelType == VOXEL_RUN_LITERAL) { memcpy(ptr, record, recordSize); ptr += recordSize; }
+
+			hasLastRecord = voxelType != VOXEL_RUN_UNTOUCHED;
+			if (voxelType == VOXEL_RUN_LITERAL) memcpy(lastRecord, record, recordSize);
+
+			if (ptr - data >= rawSize) break;
+		}
+
+		if (ptr - data < rawSize)
+		{
+			ushort code = (ushort)((runType << 14) | runLength);
+			memcpy(runCode, &code, sizeof(ushort));
+			return (int)(ptr - data);
+		}
+
+		data[0] = VOXEL_BLOCK_CODEC_RAW;
+		memcpy(data + 2, voxelBlock, SDF_BLOCK_SIZE3 * sizeof(TVoxel));
+		return rawSize;
+	}
+
+	/** Decodes a block written by encodeVoxelBlock. */
+	template<class TVoxel>
+	inline void decodeVoxelBlock(const uchar *data, TVoxel *voxelBlock)
+	{
+		if (data[0] == VOXEL_BLOCK_CODEC_RAW)
+		{
+			memcpy(voxelBlock, data + 2, SDF_BLOCK_SIZE3 * sizeof(TVoxel));
+			return;
+		}
+
+		int sdfBits = data[1] == 2 ? 16 : 8;
+		const uchar *ptr = data + 2;
+
+		int locId = 0;
+		while (locId < SDF_BLOCK_SIZE3)
+		{
+			ushort code;
+			memcpy(&code, ptr, sizeof(ushort)); ptr += sizeof(ushort);
+
+			int runType = code >> 14, runEnd = MIN(locId + (code & 0x3fff), SDF_BLOCK_SIZE3);
+
+			switch (runType)
+			{
+			case VOXEL_RUN_UNTOUCHED:
+				for (; locId < runEnd; locId++) voxelBlock[locId] = TVoxel();
+				break;
+			case VOXEL_RUN_REPEATED:
+				for (; locId < runEnd; locId++) voxelBlock[locId] = voxelBlock[locId - 1];
+				break;
+			default:
+				for (; locId < runEnd; locId++)
+				{
+					TVoxel & voxel = voxelBlock[locId];
+
+					int q;
+					if (sdfBits == 16) { short s; memcpy(&s, ptr, sizeof(short)); ptr += sizeof(short); q = s; }
+					else q = (signed char)*ptr++;
+					dequantiseSdf(q, sdfBits, voxel.sdf);
+					voxel.w_depth = *ptr++;
+
+					ptr = VoxelColorCodec<TVoxel::hasColorInformation, TVoxel>::decode(ptr, voxel);
+					ptr = VoxelConfidenceCodec<TVoxel::hasConfidenceInformation, TVoxel>::decode(ptr, voxel);
+				}
+				break;
+			}
+		}
+	}
+}
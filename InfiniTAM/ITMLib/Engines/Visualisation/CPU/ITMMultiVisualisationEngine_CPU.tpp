@@ -43,21 +43,21 @@ void ITMMultiVisualisationEngine_CPU<TVoxel, TIndex>::CreateExpectedDepths(const
 	for (int localMapId = 0; localMapId < renderState->indexData_host.numLocalMaps; ++localMapId) 
 	{
 		float voxelSize = renderState->sceneParams.voxelSize;
-		const ITMHashEntry *hash_entries = renderState->indexData_host.index[localMapId];
-		int noHashEntries = ITMVoxelBlockHash::noTotalEntries;
+		const typename TIndex::IndexData *hash_entries = renderState->indexData_host.index[localMapId];
+		int noHashEntries = TIndex::getNumEntries(&renderState->sceneParams);
 
 		std::vector<RenderingBlock> renderingBlocks(MAX_RENDERING_BLOCKS);
 		int numRenderingBlocks = 0;
 
 		Matrix4f localPose = pose->GetM() * renderState->indexData_host.posesInv[localMapId];
 		for (int blockNo = 0; blockNo < noHashEntries; ++blockNo) {
-			const ITMHashEntry & blockData(hash_entries[blockNo]);
+			const typename TIndex::IndexData & blockData(hash_entries[blockNo]);
 
 			Vector2i upperLeft, lowerRight;
 			Vector2f zRange;
 			bool validProjection = false;
 			if (blockData.ptr >= 0) {
-				validProjection = ProjectSingleBlock(blockData.pos, localPose, intrinsics->projectionParamsSimple.all, imgSize, voxelSize, upperLeft, lowerRight, zRange);
+				validProjection = ProjectSingleBlock(getBlockPos(blockData), localPose, intrinsics->projectionParamsSimple.all, imgSize, voxelSize, upperLeft, lowerRight, zRange);
 			}
 			if (!validProjection) continue;
 
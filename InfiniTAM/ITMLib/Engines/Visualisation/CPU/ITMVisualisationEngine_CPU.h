@@ -45,4 +45,24 @@ namespace ITMLib
 		void CreateICPMaps(const ITMScene<TVoxel,ITMVoxelBlockHash> *scene, const ITMView *view, ITMTrackingState *trackingState, ITMRenderState *renderState) const;
 		void ForwardRender(const ITMScene<TVoxel,ITMVoxelBlockHash> *scene, const ITMView *view, ITMTrackingState *trackingState, ITMRenderState *renderState) const;
 	};
+
+	template<class TVoxel>
+	class ITMVisualisationEngine_CPU<TVoxel, ITMVoxelBlockProbingHash> : public ITMVisualisationEngine < TVoxel, ITMVoxelBlockProbingHash >
+	{
+	public:
+		explicit ITMVisualisationEngine_CPU(void) { }
+		~ITMVisualisationEngine_CPU(void) { }
+
+		ITMRenderState_VH* CreateRenderState(const ITMScene<TVoxel, ITMVoxelBlockProbingHash> *scene, const Vector2i & imgSize) const;
+		void FindVisibleBlocks(const ITMScene<TVoxel,ITMVoxelBlockProbingHash> *scene, const ORUtils::SE3Pose *pose, const ITMIntrinsics *intrinsics, ITMRenderState *renderState) const;
+		int CountVisibleBlocks(const ITMScene<TVoxel,ITMVoxelBlockProbingHash> *scene, const ITMRenderState *renderState, int minBlockId, int maxBlockId) const;
+		void CreateExpectedDepths(const ITMScene<TVoxel,ITMVoxelBlockProbingHash> *scene, const ORUtils::SE3Pose *pose, const ITMIntrinsics *intrinsics, ITMRenderState *renderState) const;
+		void RenderImage(const ITMScene<TVoxel,ITMVoxelBlockProbingHash> *scene, const ORUtils::SE3Pose *pose, const ITMIntrinsics *intrinsics, const ITMRenderState *renderState,
+			ITMUChar4Image *outputImage, IITMVisualisationEngine::RenderImageType type = IITMVisualisationEngine::RENDER_SHADED_GREYSCALE,
+			IITMVisualisationEngine::RenderRaycastSelection raycastType = IITMVisualisationEngine::RENDER_FROM_NEW_RAYCAST) const;
+		void FindSurface(const ITMScene<TVoxel,ITMVoxelBlockProbingHash> *scene, const ORUtils::SE3Pose *pose, const ITMIntrinsics *intrinsics, const ITMRenderState *renderState) const;
+		void CreatePointCloud(const ITMScene<TVoxel,ITMVoxelBlockProbingHash> *scene, const ITMView *view, ITMTrackingState *trackingState, ITMRenderState *renderState, bool skipPoints) const;
+		void CreateICPMaps(const ITMScene<TVoxel,ITMVoxelBlockProbingHash> *scene, const ITMView *view, ITMTrackingState *trackingState, ITMRenderState *renderState) const;
+		void ForwardRender(const ITMScene<TVoxel,ITMVoxelBlockProbingHash> *scene, const ITMView *view, ITMTrackingState *trackingState, ITMRenderState *renderState) const;
+	};
 }
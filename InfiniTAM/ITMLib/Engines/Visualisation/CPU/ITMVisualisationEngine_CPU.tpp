@@ -26,7 +26,15 @@ template<class TVoxel>
 ITMRenderState_VH* ITMVisualisationEngine_CPU<TVoxel, ITMVoxelBlockHash>::CreateRenderState(const ITMScene<TVoxel, ITMVoxelBlockHash> *scene, const Vector2i & imgSize) const
 {
 	return new ITMRenderState_VH(
-		ITMVoxelBlockHash::noTotalEntries, imgSize, scene->sceneParams->viewFrustum_min, scene->sceneParams->viewFrustum_max, MEMORYDEVICE_CPU
+		scene->index.noTotalEntries, scene->index.getNumAllocatedVoxelBlocks(), imgSize, scene->sceneParams->viewFrustum_min, scene->sceneParams->viewFrustum_max, MEMORYDEVICE_CPU
+	);
+}
+
+template<class TVoxel>
+ITMRenderState_VH* ITMVisualisationEngine_CPU<TVoxel, ITMVoxelBlockProbingHash>::CreateRenderState(const ITMScene<TVoxel, ITMVoxelBlockProbingHash> *scene, const Vector2i & imgSize) const
+{
+	return new ITMRenderState_VH(
+		scene->index.noTotalEntries, scene->index.getNumAllocatedVoxelBlocks(), imgSize, scene->sceneParams->viewFrustum_min, scene->sceneParams->viewFrustum_max, MEMORYDEVICE_CPU
 	);
 }
 
@@ -40,6 +48,43 @@ void ITMVisualisationEngine_CPU<TVoxel,ITMVoxelBlockHash>::FindVisibleBlocks(con
 	ITMRenderState *renderState) const
 {
 	const ITMHashEntry *hashTable = scene->index.GetEntries();
+	const int *liveEntryIDs = scene->index.GetLiveEntryIDs();
+	int noLiveEntries = scene->index.GetNoLiveEntries();
+	float voxelSize = scene->sceneParams->voxelSize;
+	Vector2i imgSize = renderState->renderingRangeImage->noDims;
+
+	Matrix4f M = pose->GetM();
+	Vector4f projParams = intrinsics->projectionParamsSimple.all;
+
+	ITMRenderState_VH *renderState_vh = (ITMRenderState_VH*)renderState;
+
+	int noVisibleEntries = 0;
+	int *visibleEntryIDs = renderState_vh->GetVisibleEntryIDs();
+
+	//build visible list, only the entries that hold a voxel block can be visible
+	for (int liveId = 0; liveId < noLiveEntries; liveId++)
+	{
+		int targetIdx = liveEntryIDs[liveId];
+		const ITMHashEntry &hashEntry = hashTable[targetIdx];
+
+		bool isVisible, isVisibleEnlarged;
+		checkBlockVisibility<false>(isVisible, isVisibleEnlarged, hashEntry.pos, M, projParams, voxelSize, imgSize);
+
+		if (isVisible)
+		{
+			visibleEntryIDs[noVisibleEntries] = targetIdx;
+			noVisibleEntries++;
+		}
+	}
+
+	renderState_vh->noVisibleEntries = noVisibleEntries;
+}
+
+template<class TVoxel>
+void ITMVisualisationEngine_CPU<TVoxel,ITMVoxelBlockProbingHash>::FindVisibleBlocks(const ITMScene<TVoxel,ITMVoxelBlockProbingHash> *scene, const ORUtils::SE3Pose *pose, const ITMIntrinsics *intrinsics,
+	ITMRenderState *renderState) const
+{
+	const ITMProbingHashEntry *hashTable = scene->index.GetEntries();
 	int noTotalEntries = scene->index.noTotalEntries;
 	float voxelSize = scene->sceneParams->voxelSize;
 	Vector2i imgSize = renderState->renderingRangeImage->noDims;
@@ -56,12 +101,13 @@ void ITMVisualisationEngine_CPU<TVoxel,ITMVoxelBlockHash>::FindVisibleBlocks(con
 	for (int targetIdx = 0; targetIdx < noTotalEntries; targetIdx++)
 	{
 		unsigned char hashVisibleType = 0;// = entriesVisibleType[targetIdx];
-		const ITMHashEntry &hashEntry = hashTable[targetIdx];
+		const ITMProbingHashEntry &hashEntry = hashTable[targetIdx];
 
 		if (hashEntry.ptr >= 0)
 		{
 			bool isVisible, isVisibleEnlarged;
-			checkBlockVisibility<false>(isVisible, isVisibleEnlarged, hashEntry.pos, M, projParams, voxelSize, imgSize);
+			Vector3s blockPos = unpackBlockKey(hashEntry.key);
+			checkBlockVisibility<false>(isVisible, isVisibleEnlarged, blockPos, M, projParams, voxelSize, imgSize);
 			hashVisibleType = isVisible;
 		}
 
@@ -81,8 +127,8 @@ int ITMVisualisationEngine_CPU<TVoxel, TIndex>::CountVisibleBlocks(const ITMScen
 	return 1;
 }
 
-template<class TVoxel>
-int ITMVisualisationEngine_CPU<TVoxel, ITMVoxelBlockHash>::CountVisibleBlocks(const ITMScene<TVoxel,ITMVoxelBlockHash> *scene, const ITMRenderState *renderState, int minBlockId, int maxBlockId) const
+template<class TVoxel, class TIndex>
+static int CountVisibleBlocks_common(const ITMScene<TVoxel,TIndex> *scene, const ITMRenderState *renderState, int minBlockId, int maxBlockId)
 {
 	const ITMRenderState_VH *renderState_vh = (const ITMRenderState_VH*)renderState;
 
@@ -98,6 +144,18 @@ int ITMVisualisationEngine_CPU<TVoxel, ITMVoxelBlockHash>::CountVisibleBlocks(co
 	return ret;
 }
 
+template<class TVoxel>
+int ITMVisualisationEngine_CPU<TVoxel, ITMVoxelBlockHash>::CountVisibleBlocks(const ITMScene<TVoxel,ITMVoxelBlockHash> *scene, const ITMRenderState *renderState, int minBlockId, int maxBlockId) const
+{
+	return CountVisibleBlocks_common(scene, renderState, minBlockId, maxBlockId);
+}
+
+template<class TVoxel>
+int ITMVisualisationEngine_CPU<TVoxel, ITMVoxelBlockProbingHash>::CountVisibleBlocks(const ITMScene<TVoxel,ITMVoxelBlockProbingHash> *scene, const ITMRenderState *renderState, int minBlockId, int maxBlockId) const
+{
+	return CountVisibleBlocks_common(scene, renderState, minBlockId, maxBlockId);
+}
+
 template<class TVoxel, class TIndex>
 void ITMVisualisationEngine_CPU<TVoxel, TIndex>::CreateExpectedDepths(const ITMScene<TVoxel,TIndex> *scene, const ORUtils::SE3Pose *pose, const ITMIntrinsics *intrinsics, ITMRenderState *renderState) const
 {
@@ -112,9 +170,9 @@ void ITMVisualisationEngine_CPU<TVoxel, TIndex>::CreateExpectedDepths(const ITMS
 	}
 }
 
-template<class TVoxel>
-void ITMVisualisationEngine_CPU<TVoxel,ITMVoxelBlockHash>::CreateExpectedDepths(const ITMScene<TVoxel,ITMVoxelBlockHash> *scene, const ORUtils::SE3Pose *pose, const ITMIntrinsics *intrinsics,
-	ITMRenderState *renderState) const
+template<class TVoxel, class TIndex>
+static void CreateExpectedDepths_common(const ITMScene<TVoxel,TIndex> *scene, const ORUtils::SE3Pose *pose, const ITMIntrinsics *intrinsics,
+	ITMRenderState *renderState)
 {
 	Vector2i imgSize = renderState->renderingRangeImage->noDims;
 	Vector2f *minmaxData = renderState->renderingRangeImage->GetData(MEMORYDEVICE_CPU);
@@ -137,13 +195,13 @@ void ITMVisualisationEngine_CPU<TVoxel,ITMVoxelBlockHash>::CreateExpectedDepths(
 
 	//go through list of visible 8x8x8 blocks
 	for (int blockNo = 0; blockNo < noVisibleEntries; ++blockNo) {
-		const ITMHashEntry & blockData(scene->index.GetEntries()[visibleEntryIDs[blockNo]]);
+		const typename TIndex::IndexData & blockData(scene->index.GetEntries()[visibleEntryIDs[blockNo]]);
 
 		Vector2i upperLeft, lowerRight;
 		Vector2f zRange;
 		bool validProjection = false;
 		if (blockData.ptr>=0) {
-			validProjection = ProjectSingleBlock(blockData.pos, pose->GetM(), intrinsics->projectionParamsSimple.all, imgSize, voxelSize, upperLeft, lowerRight, zRange);
+			validProjection = ProjectSingleBlock(getBlockPos(blockData), pose->GetM(), intrinsics->projectionParamsSimple.all, imgSize, voxelSize, upperLeft, lowerRight, zRange);
 		}
 		if (!validProjection) continue;
 
@@ -173,6 +231,34 @@ void ITMVisualisationEngine_CPU<TVoxel,ITMVoxelBlockHash>::CreateExpectedDepths(
 	}
 }
 
+template<class TVoxel>
+void ITMVisualisationEngine_CPU<TVoxel,ITMVoxelBlockHash>::CreateExpectedDepths(const ITMScene<TVoxel,ITMVoxelBlockHash> *scene, const ORUtils::SE3Pose *pose, const ITMIntrinsics *intrinsics,
+	ITMRenderState *renderState) const
+{
+	CreateExpectedDepths_common(scene, pose, intrinsics, renderState);
+}
+
+template<class TVoxel>
+void ITMVisualisationEngine_CPU<TVoxel,ITMVoxelBlockProbingHash>::CreateExpectedDepths(const ITMScene<TVoxel,ITMVoxelBlockProbingHash> *scene, const ORUtils::SE3Pose *pose, const ITMIntrinsics *intrinsics,
+	ITMRenderState *renderState) const
+{
+	CreateExpectedDepths_common(scene, pose, intrinsics, renderState);
+}
+
+/** Cache to start the lookups of a raycast with, the one of a voxel block hash follows its neighbour links if it keeps them. */
+template<class TIndex>
+static typename TIndex::IndexCache PrepareRaycastCache(const TIndex &index)
+{
+	return typename TIndex::IndexCache();
+}
+
+static inline ITMVoxelBlockHash::IndexCache PrepareRaycastCache(const ITMVoxelBlockHash &index)
+{
+	ITMVoxelBlockHash::IndexCache cache;
+	cache.neighbourLinks = index.GetNeighbourLinks();
+	return cache;
+}
+
 template<class TVoxel, class TIndex>
 static void GenericRaycast(const ITMScene<TVoxel, TIndex> *scene, const Vector2i& imgSize, const Matrix4f& invM, const Vector4f& projParams, const ITMRenderState *renderState, bool updateVisibleList)
 {
@@ -181,12 +267,13 @@ static void GenericRaycast(const ITMScene<TVoxel, TIndex> *scene, const Vector2i
 	float oneOverVoxelSize = 1.0f / scene->sceneParams->voxelSize;
 	Vector4f *pointsRay = renderState->raycastResult->GetData(MEMORYDEVICE_CPU);
 	const TVoxel *voxelData = scene->localVBA.GetVoxelBlocks();
-	const typename ITMVoxelBlockHash::IndexData *voxelIndex = scene->index.getIndexData();
+	const typename TIndex::IndexData *voxelIndex = scene->index.getIndexData();
 	uchar *entriesVisibleType = NULL;
 	if (updateVisibleList&&(dynamic_cast<const ITMRenderState_VH*>(renderState)!=NULL))
 	{
 		entriesVisibleType = ((ITMRenderState_VH*)renderState)->GetEntriesVisibleType();
 	}
+	typename TIndex::IndexCache cache = PrepareRaycastCache(scene->index);
 
 #ifdef WITH_OPENMP
 	#pragma omp parallel for
@@ -207,7 +294,8 @@ static void GenericRaycast(const ITMScene<TVoxel, TIndex> *scene, const Vector2i
 				InvertProjectionParams(projParams),
 				oneOverVoxelSize,
 				mu,
-				minmaximg[locId2]
+				minmaximg[locId2],
+				cache
 			);
 		else castRay<TVoxel, TIndex, false>(
 				pointsRay[locId],
@@ -219,7 +307,8 @@ static void GenericRaycast(const ITMScene<TVoxel, TIndex> *scene, const Vector2i
 				InvertProjectionParams(projParams),
 				oneOverVoxelSize,
 				mu,
-				minmaximg[locId2]
+				minmaximg[locId2],
+				cache
 			);
 	}
 }
@@ -255,8 +344,12 @@ static void RenderImage_common(const ITMScene<TVoxel,TIndex> *scene, const ORUti
 	const TVoxel *voxelData = scene->localVBA.GetVoxelBlocks();
 	const typename TIndex::IndexData *voxelIndex = scene->index.getIndexData();
 
+	// the colour stream is only read here, see ITMLocalVBA::GetColourBlocks()
+	typedef typename ITMColourVoxel<TVoxel>::Type TColourVoxel;
+	const TColourVoxel *colourData = scene->localVBA.GetColourBlocks();
+
 	if ((type == IITMVisualisationEngine::RENDER_COLOUR_FROM_VOLUME)&&
-	    (!TVoxel::hasColorInformation)) type = IITMVisualisationEngine::RENDER_SHADED_GREYSCALE;
+	    (!TColourVoxel::hasColorInformation)) type = IITMVisualisationEngine::RENDER_SHADED_GREYSCALE;
 
 	switch (type) {
 	case IITMVisualisationEngine::RENDER_COLOUR_FROM_VOLUME:
@@ -266,7 +359,7 @@ static void RenderImage_common(const ITMScene<TVoxel,TIndex> *scene, const ORUti
 		for (int locId = 0; locId < imgSize.x * imgSize.y; locId++)
 		{
 			Vector4f ptRay = pointsRay[locId];
-			processPixelColour<TVoxel, TIndex>(outRendering[locId], ptRay.toVector3(), ptRay.w > 0, voxelData, voxelIndex);
+			processPixelColour<TColourVoxel, TIndex>(outRendering[locId], ptRay.toVector3(), ptRay.w > 0, colourData, voxelIndex);
 		}
 		break;
 	case IITMVisualisationEngine::RENDER_COLOUR_FROM_NORMAL:
@@ -338,6 +431,7 @@ static void CreatePointCloud_common(const ITMScene<TVoxel,TIndex> *scene, const
 		trackingState->pointCloud->colours->GetData(MEMORYDEVICE_CPU),
 		renderState->raycastResult->GetData(MEMORYDEVICE_CPU),
 		scene->localVBA.GetVoxelBlocks(),
+		scene->localVBA.GetColourBlocks(),
 		scene->index.getIndexData(),
 		skipPoints,
 		scene->sceneParams->voxelSize,
@@ -428,6 +522,7 @@ static void ForwardRender_common(const ITMScene<TVoxel, TIndex> *scene, const IT
 
 	renderState->noFwdProjMissingPoints = noMissingPoints;
 	const Vector4f invProjParams = InvertProjectionParams(projParams);
+	typename TIndex::IndexCache cache = PrepareRaycastCache(scene->index);
     
 	for (int pointId = 0; pointId < noMissingPoints; pointId++)
 	{
@@ -436,7 +531,7 @@ static void ForwardRender_common(const ITMScene<TVoxel, TIndex> *scene, const IT
 		int locId2 = (int)floor((float)x / minmaximg_subsample) + (int)floor((float)y / minmaximg_subsample) * imgSize.x;
 
 		castRay<TVoxel, TIndex, false>(forwardProjection[locId], NULL, x, y, voxelData, voxelIndex, invM, invProjParams,
-			1.0f / scene->sceneParams->voxelSize, scene->sceneParams->mu, minmaximg[locId2]);
+			1.0f / scene->sceneParams->voxelSize, scene->sceneParams->mu, minmaximg[locId2], cache);
 	}
 }
 
@@ -456,6 +551,14 @@ void ITMVisualisationEngine_CPU<TVoxel,ITMVoxelBlockHash>::RenderImage(const ITM
 	RenderImage_common(scene, pose, intrinsics, renderState, outputImage, type, raycastType);
 }
 
+template<class TVoxel>
+void ITMVisualisationEngine_CPU<TVoxel,ITMVoxelBlockProbingHash>::RenderImage(const ITMScene<TVoxel,ITMVoxelBlockProbingHash> *scene, const ORUtils::SE3Pose *pose,  const ITMIntrinsics *intrinsics,
+	const ITMRenderState *renderState, ITMUChar4Image *outputImage, IITMVisualisationEngine::RenderImageType type,
+	IITMVisualisationEngine::RenderRaycastSelection raycastType) const
+{
+	RenderImage_common(scene, pose, intrinsics, renderState, outputImage, type, raycastType);
+}
+
 template<class TVoxel, class TIndex>
 void ITMVisualisationEngine_CPU<TVoxel, TIndex>::FindSurface(const ITMScene<TVoxel,TIndex> *scene, const ORUtils::SE3Pose *pose, const ITMIntrinsics *intrinsics, const ITMRenderState *renderState) const
 {
@@ -473,6 +576,15 @@ void ITMVisualisationEngine_CPU<TVoxel,ITMVoxelBlockHash>::FindSurface(const ITM
 	GenericRaycast(scene, renderState->raycastResult->noDims, pose->GetInvM(), intrinsics->projectionParamsSimple.all, renderState, false);
 }
 
+template<class TVoxel>
+void ITMVisualisationEngine_CPU<TVoxel,ITMVoxelBlockProbingHash>::FindSurface(const ITMScene<TVoxel,ITMVoxelBlockProbingHash> *scene, const ORUtils::SE3Pose *pose, const ITMIntrinsics *intrinsics,
+	const ITMRenderState *renderState) const
+{
+	// this one is generally done for freeview visualisation, so no, do not
+	// update the list of visible blocks
+	GenericRaycast(scene, renderState->raycastResult->noDims, pose->GetInvM(), intrinsics->projectionParamsSimple.all, renderState, false);
+}
+
 template<class TVoxel, class TIndex>
 void ITMVisualisationEngine_CPU<TVoxel,TIndex>::CreatePointCloud(const ITMScene<TVoxel,TIndex> *scene, const ITMView *view, ITMTrackingState *trackingState, 
 	ITMRenderState *renderState, bool skipPoints) const
@@ -487,6 +599,13 @@ void ITMVisualisationEngine_CPU<TVoxel,ITMVoxelBlockHash>::CreatePointCloud(cons
 	CreatePointCloud_common(scene, view, trackingState, renderState, skipPoints);
 }
 
+template<class TVoxel>
+void ITMVisualisationEngine_CPU<TVoxel,ITMVoxelBlockProbingHash>::CreatePointCloud(const ITMScene<TVoxel,ITMVoxelBlockProbingHash> *scene,const ITMView *view, ITMTrackingState *trackingState,
+	ITMRenderState *renderState, bool skipPoints) const
+{
+	CreatePointCloud_common(scene, view, trackingState, renderState, skipPoints);
+}
+
 template<class TVoxel, class TIndex>
 void ITMVisualisationEngine_CPU<TVoxel,TIndex>::CreateICPMaps(const ITMScene<TVoxel,TIndex> *scene, const ITMView *view, ITMTrackingState *trackingState, ITMRenderState *renderState) const
 {
@@ -500,6 +619,13 @@ void ITMVisualisationEngine_CPU<TVoxel,ITMVoxelBlockHash>::CreateICPMaps(const I
 	CreateICPMaps_common(scene, view, trackingState, renderState);
 }
 
+template<class TVoxel>
+void ITMVisualisationEngine_CPU<TVoxel,ITMVoxelBlockProbingHash>::CreateICPMaps(const ITMScene<TVoxel,ITMVoxelBlockProbingHash> *scene, const ITMView *view, ITMTrackingState *trackingState, 
+	ITMRenderState *renderState) const
+{
+	CreateICPMaps_common(scene, view, trackingState, renderState);
+}
+
 template<class TVoxel, class TIndex>
 void ITMVisualisationEngine_CPU<TVoxel, TIndex>::ForwardRender(const ITMScene<TVoxel,TIndex> *scene, const ITMView *view, ITMTrackingState *trackingState, 
 	ITMRenderState *renderState) const
@@ -514,11 +640,20 @@ void ITMVisualisationEngine_CPU<TVoxel, ITMVoxelBlockHash>::ForwardRender(const
 	ForwardRender_common(scene, view, trackingState, renderState);
 }
 
+template<class TVoxel>
+void ITMVisualisationEngine_CPU<TVoxel, ITMVoxelBlockProbingHash>::ForwardRender(const ITMScene<TVoxel,ITMVoxelBlockProbingHash> *scene, const ITMView *view, ITMTrackingState *trackingState,
+	ITMRenderState *renderState) const
+{
+	ForwardRender_common(scene, view, trackingState, renderState);
+}
+
 template<class TVoxel, class TIndex>
 static int RenderPointCloud(Vector4f *locations, Vector4f *colours, const Vector4f *ptsRay, 
-	const TVoxel *voxelData, const typename TIndex::IndexData *voxelIndex, bool skipPoints, float voxelSize, 
-	Vector2i imgSize, Vector3f lightSource)
+	const TVoxel *voxelData, const typename ITMColourVoxel<TVoxel>::Type *colourData, const typename TIndex::IndexData *voxelIndex,
+	bool skipPoints, float voxelSize, Vector2i imgSize, Vector3f lightSource)
 {
+	typedef typename ITMColourVoxel<TVoxel>::Type TColourVoxel;
+
 	int noTotalPoints = 0;
 
 	for (int y = 0, locId = 0; y < imgSize.y; y++) for (int x = 0; x < imgSize.x; x++, locId++)
@@ -535,7 +670,7 @@ static int RenderPointCloud(Vector4f *locations, Vector4f *colours, const Vector
 		if (foundPoint)
 		{
 			Vector4f tmp;
-			tmp = VoxelColorReader<TVoxel::hasColorInformation, TVoxel, TIndex>::interpolate(voxelData, voxelIndex, point);
+			tmp = VoxelColorReader<TColourVoxel::hasColorInformation, TColourVoxel, TIndex>::interpolate(colourData, voxelIndex, point);
 			if (tmp.w > 0.0f) { tmp.x /= tmp.w; tmp.y /= tmp.w; tmp.z /= tmp.w; tmp.w = 1.0f; }
 			colours[noTotalPoints] = tmp;
 
@@ -4,6 +4,7 @@
 
 #include "../../../Objects/RenderStates/ITMRenderState_VH.h"
 #include "../../../Objects/Scene/ITMScene.h"
+#include "../../../Objects/Scene/ITMVoxelBlockProbingHash.h"
 #include "../../../Objects/Tracking/ITMTrackingState.h"
 #include "../../../Objects/Views/ITMView.h"
 
@@ -37,6 +38,7 @@ namespace ITMLib
 
 	template<class TIndex> struct IndexToRenderState { typedef ITMRenderState type; };
 	template<> struct IndexToRenderState<ITMVoxelBlockHash> { typedef ITMRenderState_VH type; };
+	template<> struct IndexToRenderState<ITMVoxelBlockProbingHash> { typedef ITMRenderState_VH type; };
 
 	/** \brief
 		Interface to engines helping with the visualisation of
@@ -70,7 +72,7 @@ namespace ITMLib
 		/** Given a render state, Count the number of visible blocks
 		with minBlockId <= blockID <= maxBlockId .
 		*/
-		virtual int CountVisibleBlocks(const ITMScene<TVoxel,TIndex> *scene, const ITMRenderState *renderState, int minBlockId = 0, int maxBlockId = SDF_LOCAL_BLOCK_NUM) const = 0;
+		virtual int CountVisibleBlocks(const ITMScene<TVoxel,TIndex> *scene, const ITMRenderState *renderState, int minBlockId = 0, int maxBlockId = 0x7fffffff) const = 0;
 
 		/** Given scene, pose and intrinsics, create an estimate
 		of the minimum and maximum depths at each pixel of
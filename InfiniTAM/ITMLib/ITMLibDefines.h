@@ -5,6 +5,7 @@
 #include "Objects/Scene/ITMPlainVoxelArray.h"
 #include "Objects/Scene/ITMSurfelTypes.h"
 #include "Objects/Scene/ITMVoxelBlockHash.h"
+#include "Objects/Scene/ITMVoxelBlockProbingHash.h"
 #include "Objects/Scene/ITMVoxelTypes.h"
 
 /** This chooses the information stored at each surfel. At the moment, valid
@@ -13,12 +14,18 @@
 typedef ITMLib::ITMSurfel_rgb ITMSurfelT;
 
 /** This chooses the information stored at each voxel. At the moment, valid
-    options are ITMVoxel_s, ITMVoxel_f, ITMVoxel_s_rgb and ITMVoxel_f_rgb.
+    options are ITMVoxel_s, ITMVoxel_f, ITMVoxel_s_rgb, ITMVoxel_f_rgb and,
+    for depth only scenes with less memory per voxel, ITMVoxel_u8 and
+    ITMVoxel_h. ITMVoxel_s_rgb_split and ITMVoxel_f_rgb_split keep the
+    colour in a separate array, so that tracking only reads geometry;
+    they are limited to CPU builds without swapping.
 */
 typedef ITMVoxel_s ITMVoxel;
 
 /** This chooses the way the voxels are addressed and indexed. At the moment,
-    valid options are ITMVoxelBlockHash and ITMPlainVoxelArray.
+    valid options are ITMVoxelBlockHash, ITMPlainVoxelArray and, for CPU only
+    builds, ITMVoxelBlockProbingHash.
 */
 typedef ITMLib::ITMVoxelBlockHash ITMVoxelIndex;
 //typedef ITMLib::ITMPlainVoxelArray ITMVoxelIndex;
+//typedef ITMLib::ITMVoxelBlockProbingHash ITMVoxelIndex;
@@ -17,12 +17,14 @@ namespace ITMLib
 		MemoryDeviceType memoryType;
 
 		uint noTotalTriangles;
-		static const uint noMaxTriangles_default = SDF_LOCAL_BLOCK_NUM * 32 * 16;
 		uint noMaxTriangles;
 
 		ORUtils::MemoryBlock<Triangle> *triangles;
 
-		explicit ITMMesh(MemoryDeviceType memoryType, uint maxTriangles = noMaxTriangles_default)
+		/** Default triangle budget for a scene holding @p noLocalBlocks voxel blocks. */
+		static uint GetDefaultMaxTriangles(int noLocalBlocks) { return (uint)noLocalBlocks * 32 * 16; }
+
+		ITMMesh(MemoryDeviceType memoryType, uint maxTriangles)
 		{
 			this->memoryType = memoryType;
 			this->noTotalTriangles = 0;
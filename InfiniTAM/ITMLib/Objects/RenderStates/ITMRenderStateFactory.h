@@ -3,6 +3,7 @@
 #pragma once
 
 #include "ITMRenderState_VH.h"
+#include "../Scene/ITMVoxelBlockProbingHash.h"
 #include "../../Utils/ITMSceneParams.h"
 
 namespace ITMLib
@@ -23,7 +24,17 @@ namespace ITMLib
     /** Creates a render state, containing rendering info for the scene. */
     static ITMRenderState *CreateRenderState(const Vector2i& imgSize, const ITMSceneParams *sceneParams, MemoryDeviceType memoryType)
     {
-      return new ITMRenderState_VH(ITMVoxelBlockHash::noTotalEntries, imgSize, sceneParams->viewFrustum_min, sceneParams->viewFrustum_max, memoryType);
+      return new ITMRenderState_VH(sceneParams->hashBucketNum + sceneParams->excessListSize, sceneParams->localBlockNum, imgSize, sceneParams->viewFrustum_min, sceneParams->viewFrustum_max, memoryType);
+    }
+  };
+
+  template <>
+  struct ITMRenderStateFactory<ITMVoxelBlockProbingHash>
+  {
+    /** Creates a render state, containing rendering info for the scene. */
+    static ITMRenderState *CreateRenderState(const Vector2i& imgSize, const ITMSceneParams *sceneParams, MemoryDeviceType memoryType)
+    {
+      return new ITMRenderState_VH(ITMVoxelBlockProbingHash::getNumEntries(sceneParams), sceneParams->localBlockNum, imgSize, sceneParams->viewFrustum_min, sceneParams->viewFrustum_max, memoryType);
     }
   };
 }
@@ -34,12 +34,12 @@ namespace ITMLib
 		/** Number of entries in the live list. */
 		int noVisibleEntries;
            
-		ITMRenderState_VH(int noTotalEntries, const Vector2i & imgSize, float vf_min, float vf_max, MemoryDeviceType memoryType = MEMORYDEVICE_CPU)
+		ITMRenderState_VH(int noTotalEntries, int noLocalBlocks, const Vector2i & imgSize, float vf_min, float vf_max, MemoryDeviceType memoryType = MEMORYDEVICE_CPU)
 			: ITMRenderState(imgSize, vf_min, vf_max, memoryType)
 		{
 			this->memoryType = memoryType;
 
-			visibleEntryIDs = new ORUtils::MemoryBlock<int>(SDF_LOCAL_BLOCK_NUM, memoryType);
+			visibleEntryIDs = new ORUtils::MemoryBlock<int>(noLocalBlocks, memoryType);
 			entriesVisibleType = new ORUtils::MemoryBlock<uchar>(noTotalEntries, memoryType);
 
 			noVisibleEntries = 0;
@@ -57,6 +57,9 @@ namespace ITMLib
 
 		/** Get the list of "visible entries", that are
 		currently processed by integration and tracker.
+		With swapping, entries of type 4 are predicted to
+		become visible soon. They are kept in or swapped into
+		the local memory, but not added to the visible list.
 		*/
 		uchar *GetEntriesVisibleType(void) { return entriesVisibleType->GetData(memoryType); }
 
@@ -4,9 +4,18 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 #include "ITMVoxelBlockHash.h"
 #include "../../../ORUtils/CUDADefines.h"
+#include "../../../ORUtils/MappedFile.h"
+
+#ifndef NO_CPP11
+#include <condition_variable>
+#include <mutex>
+#endif
 
 namespace ITMLib
 {
@@ -21,48 +30,254 @@ namespace ITMLib
 		uchar state;
 	};
 
+	/** \brief
+	Host side store of the voxel blocks that have been swapped out
+	of the local voxel block array. The swapping engines store each
+	block in an encoded form of varying size (see
+	ITMVoxelBlockCodec.h), so the store only deals in bytes. Only
+	blocks that were actually swapped out take up memory: the data
+	is kept in slots whose size is the next power of two of the
+	encoded size, and slots of the same size are carved out of pages
+	of @ref storedPageSize bytes. The pages are allocated from main
+	memory, or mapped from a temporary file if a directory is given.
+	A block that is swapped out again overwrites its previous copy.
+
+	The host side transfer buffers come in @ref noTransferBuffers
+	sets, so that a swapping engine can fill one set while another
+	one is still being processed in the background. Such an engine
+	marks a set with BeginTransfer/EndTransfer and has to wait for
+	it with WaitForTransfer before reusing it. The store itself is
+	only accessed by one thread at a time.
+	*/
 	template<class TVoxel>
 	class ITMGlobalCache
 	{
+	public:
+		/** Size in bytes of the pages that the slots are taken from. */
+		static const int storedPageSize = 0x40000;
+		/** Size in bytes of the smallest slot. */
+		static const int minStoredSlotSize = 16;
+		/** Number of sets of host side transfer buffers, the device has a single set. */
+		static const int noTransferBuffers = 3;
+
 	private:
-		bool *hasStoredData;
-		TVoxel *storedVoxelBlocks;
+		/** Slot and size of the data of a hash entry, the slot is -1 if nothing has been stored. */
+		struct StoredBlock { int slot; int size; };
+
+		struct SlotClass
+		{
+			std::vector<uchar*> pages;
+			std::vector<int> freeSlots;
+			int noSlots;
+
+			SlotClass(void) : noSlots(0) {}
+		};
+
+		StoredBlock *storedBlocks;
+		std::vector<SlotClass> slotClasses;
+		int noStoredBlocks;
+		size_t noStoredBytes;
+
+		/** Backing file of the pages, NULL if they live in main memory. */
+		ORUtils::MappedFile *storedBlockFile;
+
 		ITMHashSwapState *swapStates_host, *swapStates_device;
 
 		bool *hasSyncedData_host, *hasSyncedData_device;
 		TVoxel *syncedVoxelBlocks_host, *syncedVoxelBlocks_device;
 
 		int *neededEntryIDs_host, *neededEntryIDs_device;
+
+		bool transferPending[noTransferBuffers];
+		int noTransferEntries[noTransferBuffers];
+#ifndef NO_CPP11
+		mutable std::mutex transferMutex;
+		mutable std::condition_variable transferDone;
+#endif
+
+		static int GetSlotClass(int size)
+		{
+			int slotClass = 0;
+			while ((minStoredSlotSize << slotClass) < size) slotClass++;
+			return slotClass;
+		}
+
+		uchar *GetSlot(int slotClass, int slot) const
+		{
+			int slotSize = minStoredSlotSize << slotClass, noSlotsPerPage = storedPageSize / slotSize;
+			return slotClasses[slotClass].pages[slot / noSlotsPerPage] + (slot % noSlotsPerPage) * slotSize;
+		}
+
+		int AllocateSlot(int slotClass)
+		{
+			if (slotClasses.size() <= (size_t)slotClass) slotClasses.resize(slotClass + 1);
+			SlotClass &slots = slotClasses[slotClass];
+
+			if (!slots.freeSlots.empty())
+			{
+				int slot = slots.freeSlots.back();
+				slots.freeSlots.pop_back();
+				return slot;
+			}
+
+			int noSlotsPerPage = storedPageSize / (minStoredSlotSize << slotClass);
+			if (slots.noSlots == (int)slots.pages.size() * noSlotsPerPage)
+			{
+				uchar *page;
+				if (storedBlockFile != NULL) page = (uchar*)storedBlockFile->Map(storedBlockFile->GetFileSize(), storedPageSize);
+				else
+				{
+					page = (uchar*)malloc(storedPageSize);
+					if (page == NULL) throw std::runtime_error("Could not allocate memory for swapped out voxel blocks");
+				}
+				slots.pages.push_back(page);
+			}
+
+			return slots.noSlots++;
+		}
+
 	public:
-		inline void SetStoredData(int address, TVoxel *data) 
-		{ 
-			hasStoredData[address] = true; 
-			memcpy(storedVoxelBlocks + address * SDF_BLOCK_SIZE3, data, sizeof(TVoxel) * SDF_BLOCK_SIZE3);
+		/** Stores @p size bytes of encoded data for hash entry @p address. */
+		inline void SetStoredData(int address, const uchar *data, int size)
+		{
+			if (size > storedPageSize) throw std::runtime_error("Voxel block data too large for the global cache");
+
+			StoredBlock &storedBlock = storedBlocks[address];
+			int slotClass = GetSlotClass(size);
+
+			if (storedBlock.slot >= 0)
+			{
+				noStoredBytes -= storedBlock.size;
+
+				int oldSlotClass = GetSlotClass(storedBlock.size);
+				if (oldSlotClass != slotClass)
+				{
+					slotClasses[oldSlotClass].freeSlots.push_back(storedBlock.slot);
+					storedBlock.slot = AllocateSlot(slotClass);
+				}
+			}
+			else
+			{
+				storedBlock.slot = AllocateSlot(slotClass);
+				noStoredBlocks++;
+			}
+
+			memcpy(GetSlot(slotClass, storedBlock.slot), data, size);
+			storedBlock.size = size;
+			noStoredBytes += size;
+		}
+		/** Drops the data of hash entry @p address, whose block has been freed. Pending transfers must have finished. */
+		inline void ClearStoredData(int address)
+		{
+			StoredBlock &storedBlock = storedBlocks[address];
+			if (storedBlock.slot < 0) return;
+
+			slotClasses[GetSlotClass(storedBlock.size)].freeSlots.push_back(storedBlock.slot);
+			noStoredBlocks--;
+			noStoredBytes -= storedBlock.size;
+
+			storedBlock.slot = -1; storedBlock.size = 0;
+		}
+		inline bool HasStoredData(int address) const { return storedBlocks[address].slot >= 0; }
+		/** Encoded data of hash entry @p address, NULL if HasStoredData(address) is false. */
+		inline const uchar *GetStoredData(int address) const
+		{
+			const StoredBlock &storedBlock = storedBlocks[address];
+			return storedBlock.slot >= 0 ? GetSlot(GetSlotClass(storedBlock.size), storedBlock.slot) : NULL;
 		}
-		inline bool HasStoredData(int address) const { return hasStoredData[address]; }
-		inline TVoxel *GetStoredVoxelBlock(int address) { return storedVoxelBlocks + address * SDF_BLOCK_SIZE3; }
+		inline int GetStoredDataSize(int address) const { return storedBlocks[address].slot >= 0 ? storedBlocks[address].size : 0; }
+
+		/** Number of voxel blocks currently held on the host. */
+		int GetNumStoredBlocks(void) const { return noStoredBlocks; }
+		/** Total size of their encoded data in bytes. */
+		size_t GetNumStoredBytes(void) const { return noStoredBytes; }
 
-		bool *GetHasSyncedData(bool useGPU) const { return useGPU ? hasSyncedData_device : hasSyncedData_host; }
-		TVoxel *GetSyncedVoxelBlocks(bool useGPU) const { return useGPU ? syncedVoxelBlocks_device : syncedVoxelBlocks_host; }
+		bool *GetHasSyncedData(bool useGPU, int bufferId = 0) const
+		{
+			return useGPU ? hasSyncedData_device : hasSyncedData_host + bufferId * SDF_TRANSFER_BLOCK_NUM;
+		}
+		TVoxel *GetSyncedVoxelBlocks(bool useGPU, int bufferId = 0) const
+		{
+			return useGPU ? syncedVoxelBlocks_device : syncedVoxelBlocks_host + (size_t)bufferId * SDF_TRANSFER_BLOCK_NUM * SDF_BLOCK_SIZE3;
+		}
 
 		ITMHashSwapState *GetSwapStates(bool useGPU) { return useGPU ? swapStates_device : swapStates_host; }
-		int *GetNeededEntryIDs(bool useGPU) { return useGPU ? neededEntryIDs_device : neededEntryIDs_host; }
+		int *GetNeededEntryIDs(bool useGPU, int bufferId = 0)
+		{
+			return useGPU ? neededEntryIDs_device : neededEntryIDs_host + bufferId * SDF_TRANSFER_BLOCK_NUM;
+		}
+
+		/** Number of entries in the host transfer buffer set @p bufferId, maintained by the swapping engine. */
+		int GetNoTransferEntries(int bufferId) const { return noTransferEntries[bufferId]; }
+		void SetNoTransferEntries(int bufferId, int noEntries) { noTransferEntries[bufferId] = noEntries; }
+
+		/** Marks the host transfer buffer set @p bufferId as being processed in the background. */
+		void BeginTransfer(int bufferId)
+		{
+#ifndef NO_CPP11
+			std::unique_lock<std::mutex> lock(transferMutex);
+#endif
+			transferPending[bufferId] = true;
+		}
+
+		void EndTransfer(int bufferId)
+		{
+#ifndef NO_CPP11
+			std::unique_lock<std::mutex> lock(transferMutex);
+			transferPending[bufferId] = false;
+			transferDone.notify_all();
+#else
+			transferPending[bufferId] = false;
+#endif
+		}
+
+		bool IsTransferPending(int bufferId) const
+		{
+#ifndef NO_CPP11
+			std::unique_lock<std::mutex> lock(transferMutex);
+#endif
+			return transferPending[bufferId];
+		}
+
+		void WaitForTransfer(int bufferId) const
+		{
+#ifndef NO_CPP11
+			std::unique_lock<std::mutex> lock(transferMutex);
+			while (transferPending[bufferId]) transferDone.wait(lock);
+#endif
+		}
+
+		void WaitForAllTransfers(void) const
+		{
+			for (int bufferId = 0; bufferId < noTransferBuffers; bufferId++) WaitForTransfer(bufferId);
+		}
 
 		int noTotalEntries; 
 
-		ITMGlobalCache() : noTotalEntries(SDF_BUCKET_NUM + SDF_EXCESS_LIST_SIZE)
+		/** Swapped out blocks are kept in a temporary file in
+		@p storageDirectory, or in main memory if it is empty.
+		*/
+		explicit ITMGlobalCache(int noTotalEntries, const std::string &storageDirectory = std::string()) : noTotalEntries(noTotalEntries)
 		{	
-			hasStoredData = (bool*)malloc(noTotalEntries * sizeof(bool));
-			storedVoxelBlocks = (TVoxel*)malloc(noTotalEntries * sizeof(TVoxel) * SDF_BLOCK_SIZE3);
-			memset(hasStoredData, 0, noTotalEntries);
+			storedBlocks = (StoredBlock*)malloc(noTotalEntries * sizeof(StoredBlock));
+			for (int i = 0; i < noTotalEntries; i++) { storedBlocks[i].slot = -1; storedBlocks[i].size = 0; }
+			noStoredBlocks = 0; noStoredBytes = 0;
+
+			storedBlockFile = storageDirectory.empty() ? NULL : new ORUtils::MappedFile(storageDirectory);
 
 			swapStates_host = (ITMHashSwapState *)malloc(noTotalEntries * sizeof(ITMHashSwapState));
 			memset(swapStates_host, 0, sizeof(ITMHashSwapState) * noTotalEntries);
 
+			for (int bufferId = 0; bufferId < noTransferBuffers; bufferId++)
+			{
+				transferPending[bufferId] = false;
+				noTransferEntries[bufferId] = 0;
+			}
+
 #ifndef COMPILE_WITHOUT_CUDA
-			ORcudaSafeCall(cudaMallocHost((void**)&syncedVoxelBlocks_host, SDF_TRANSFER_BLOCK_NUM * sizeof(TVoxel) * SDF_BLOCK_SIZE3));
-			ORcudaSafeCall(cudaMallocHost((void**)&hasSyncedData_host, SDF_TRANSFER_BLOCK_NUM * sizeof(bool)));
-			ORcudaSafeCall(cudaMallocHost((void**)&neededEntryIDs_host, SDF_TRANSFER_BLOCK_NUM * sizeof(int)));
+			ORcudaSafeCall(cudaMallocHost((void**)&syncedVoxelBlocks_host, noTransferBuffers * SDF_TRANSFER_BLOCK_NUM * sizeof(TVoxel) * SDF_BLOCK_SIZE3));
+			ORcudaSafeCall(cudaMallocHost((void**)&hasSyncedData_host, noTransferBuffers * SDF_TRANSFER_BLOCK_NUM * sizeof(bool)));
+			ORcudaSafeCall(cudaMallocHost((void**)&neededEntryIDs_host, noTransferBuffers * SDF_TRANSFER_BLOCK_NUM * sizeof(int)));
 
 			ORcudaSafeCall(cudaMalloc((void**)&swapStates_device, noTotalEntries * sizeof(ITMHashSwapState)));
 			ORcudaSafeCall(cudaMemset(swapStates_device, 0, noTotalEntries * sizeof(ITMHashSwapState)));
@@ -72,23 +287,32 @@ namespace ITMLib
 
 			ORcudaSafeCall(cudaMalloc((void**)&neededEntryIDs_device, SDF_TRANSFER_BLOCK_NUM * sizeof(int)));
 #else
-			syncedVoxelBlocks_host = (TVoxel *)malloc(SDF_TRANSFER_BLOCK_NUM * sizeof(TVoxel) * SDF_BLOCK_SIZE3);
-			hasSyncedData_host = (bool*)malloc(SDF_TRANSFER_BLOCK_NUM * sizeof(bool));
-			neededEntryIDs_host = (int*)malloc(SDF_TRANSFER_BLOCK_NUM * sizeof(int));
+			syncedVoxelBlocks_host = (TVoxel *)malloc(noTransferBuffers * SDF_TRANSFER_BLOCK_NUM * sizeof(TVoxel) * SDF_BLOCK_SIZE3);
+			hasSyncedData_host = (bool*)malloc(noTransferBuffers * SDF_TRANSFER_BLOCK_NUM * sizeof(bool));
+			neededEntryIDs_host = (int*)malloc(noTransferBuffers * SDF_TRANSFER_BLOCK_NUM * sizeof(int));
 #endif
 		}
 
+		/** Writes one flag per hash entry, followed by the size and data of the stored blocks in the order of their entries. */
 		void SaveToFile(char *fileName) const
 		{
-			TVoxel *storedData = storedVoxelBlocks;
+			WaitForAllTransfers();
 
 			FILE *f = fopen(fileName, "wb");
+			if (f == NULL) throw std::runtime_error("Could not open " + std::string(fileName) + " for writing");
 
-			fwrite(hasStoredData, sizeof(bool), noTotalEntries, f);
 			for (int i = 0; i < noTotalEntries; i++)
 			{
-				fwrite(storedData, sizeof(TVoxel) * SDF_BLOCK_SIZE3, 1, f);
-				storedData += SDF_BLOCK_SIZE3;
+				bool hasStoredData = HasStoredData(i);
+				fwrite(&hasStoredData, sizeof(bool), 1, f);
+			}
+
+			for (int i = 0; i < noTotalEntries; i++)
+			{
+				if (!HasStoredData(i)) continue;
+
+				fwrite(&storedBlocks[i].size, sizeof(int), 1, f);
+				fwrite(GetStoredData(i), storedBlocks[i].size, 1, f);
 			}
 
 			fclose(f);
@@ -96,25 +320,54 @@ namespace ITMLib
 
 		void ReadFromFile(char *fileName)
 		{
-			TVoxel *storedData = storedVoxelBlocks;
+			WaitForAllTransfers();
+
 			FILE *f = fopen(fileName, "rb");
+			if (f == NULL) throw std::runtime_error("Could not open " + std::string(fileName) + " for reading");
 
-			size_t tmp = fread(hasStoredData, sizeof(bool), noTotalEntries, f);
-			if (tmp == (size_t)noTotalEntries) {
-				for (int i = 0; i < noTotalEntries; i++)
-				{
-					fread(storedData, sizeof(TVoxel) * SDF_BLOCK_SIZE3, 1, f);
-					storedData += SDF_BLOCK_SIZE3;
-				}
+			std::vector<bool> hasStoredData(noTotalEntries);
+			std::vector<uchar> data;
+			bool readOk = true;
+
+			for (int i = 0; i < noTotalEntries && readOk; i++)
+			{
+				bool flag;
+				readOk = fread(&flag, sizeof(bool), 1, f) == 1;
+				hasStoredData[i] = flag;
+			}
+
+			for (int i = 0; i < noTotalEntries && readOk; i++)
+			{
+				if (!hasStoredData[i]) continue;
+
+				int size;
+				readOk = fread(&size, sizeof(int), 1, f) == 1 && size > 0 && size <= storedPageSize;
+				if (!readOk) break;
+
+				data.resize(size);
+				readOk = fread(&data[0], size, 1, f) == 1;
+				if (readOk) SetStoredData(i, &data[0], size);
 			}
 
 			fclose(f);
+			if (!readOk) throw std::runtime_error("Could not read the global cache from " + std::string(fileName));
 		}
 
 		~ITMGlobalCache(void) 
 		{
-			free(hasStoredData);
-			free(storedVoxelBlocks);
+			WaitForAllTransfers();
+
+			for (size_t slotClass = 0; slotClass < slotClasses.size(); slotClass++)
+			{
+				const std::vector<uchar*> &pages = slotClasses[slotClass].pages;
+				for (size_t pageId = 0; pageId < pages.size(); pageId++)
+				{
+					if (storedBlockFile != NULL) ORUtils::MappedFile::Unmap(pages[pageId], storedPageSize);
+					else free(pages[pageId]);
+				}
+			}
+			delete storedBlockFile;
+			free(storedBlocks);
 
 			free(swapStates_host);
 
@@ -133,5 +386,9 @@ namespace ITMLib
 			free(neededEntryIDs_host);
 #endif
 		}
+
+		// Suppress the default copy constructor and assignment operator
+		ITMGlobalCache(const ITMGlobalCache&);
+		ITMGlobalCache& operator=(const ITMGlobalCache&);
 	};
 }
@@ -2,36 +2,294 @@
 
 #pragma once
 
+#include <vector>
+
+#include "../../../ORUtils/MathUtils.h"
 #include "../../../ORUtils/MemoryBlock.h"
 #include "../../../ORUtils/MemoryBlockPersister.h"
+#include "../../../ORUtils/VirtualMemory.h"
+#include "ITMVoxelTypes.h"
 
 namespace ITMLib
 {
 	/** \brief
 	Stores the actual voxel content that is referred to by a
 	ITMLib::ITMHashTable.
+
+	On the CPU the array can be paged: address space for all
+	voxel blocks is reserved up front, but memory is only
+	committed one page of blocks at a time, from the highest
+	block id downwards, as the allocation list runs dry. Block
+	pointers stay valid while the array grows.
+
+	On the CPU, blocks are also reset lazily: each block carries
+	the generation in which its voxels were last reset, and
+	InvalidateBlocks() simply starts a new generation. The
+	allocating engines call InitialiseBlock() on every block they
+	take from the allocation list, which resets the voxels of
+	stale blocks. Free blocks may therefore hold old data.
+
+	A paged array can also take its blocks straight from a file,
+	see MapBlocks(), in which case memory is only copied for the
+	blocks that are modified afterwards.
+
+	Voxel types with hasSeparateColourInformation keep their
+	colour in a second, parallel array of ITMVoxelColour, see
+	GetColourBlocks(), which is paged and reset together with the
+	voxel blocks. Such types are only supported in host memory
+	and cannot be mapped from a file.
 	*/
 	template<class TVoxel>
 	class ITMLocalVBA
 	{
+	public:
+		typedef typename ITMColourVoxel<TVoxel>::Type TColourVoxel;
+
 	private:
 		ORUtils::MemoryBlock<TVoxel> *voxelBlocks;
 		ORUtils::MemoryBlock<int> *allocationList;
 
+		/** Reserved address space for all voxel blocks if the array is paged, NULL otherwise. */
+		TVoxel *pagedVoxelBlocks;
+		size_t reservedBytes;
+
+		/** Colour of the voxels if TVoxel keeps it separately, NULL otherwise. Paged like the voxel blocks. */
+		ORUtils::MemoryBlock<TColourVoxel> *colourBlocks;
+		TColourVoxel *pagedColourBlocks;
+
+		/** Range of the paged array that is mapped from a file, if any. */
+		int mappedBlockId;
+		size_t mappedBytes;
+
 		MemoryDeviceType memoryType;
 
+		int noBlocks, blockSize, pageSize, noCommittedBlocks;
+
+		/** Generation in which each block was last reset, only kept in host memory. */
+		ORUtils::MemoryBlock<unsigned int> *blockGenerations;
+		unsigned int generation;
+
+		/** Commits the blocks [@p firstBlockId, noBlocks - noCommittedBlocks), they are reset when handed out. */
+		void CommitBlocks(int firstBlockId)
+		{
+			int lastBlockId = noBlocks - noCommittedBlocks;
+			if (firstBlockId >= lastBlockId) return;
+
+			TVoxel *voxelBlocks_ptr = pagedVoxelBlocks + (size_t)firstBlockId * blockSize;
+			size_t noVoxels = (size_t)(lastBlockId - firstBlockId) * blockSize;
+
+			ORUtils::VirtualMemory::Commit(voxelBlocks_ptr, noVoxels * sizeof(TVoxel));
+			if (pagedColourBlocks != NULL) ORUtils::VirtualMemory::Commit(pagedColourBlocks + (size_t)firstBlockId * blockSize, noVoxels * sizeof(TColourVoxel));
+			for (int blockId = firstBlockId; blockId < lastBlockId; ++blockId) ReleaseBlock(blockId);
+
+			noCommittedBlocks = noBlocks - firstBlockId;
+			allocatedSize = noCommittedBlocks * blockSize;
+		}
+
+		template<class T>
+		void SavePagedBlocks(const std::string &filename, const T *pagedBlocks) const
+		{
+			std::ofstream fs(filename.c_str(), std::ios::binary);
+			if (!fs) throw std::runtime_error("Could not open " + filename + " for writing");
+
+			// Keep the layout of a full memory block, so that the file can also be loaded into an unpaged array.
+			size_t dataSize = (size_t)noBlocks * blockSize;
+			fs.write(reinterpret_cast<const char*>(&dataSize), sizeof(size_t));
+
+			int firstBlockId = noBlocks - noCommittedBlocks;
+			std::vector<T> emptyBlock(blockSize);
+			for (int blockId = 0; blockId < firstBlockId; ++blockId)
+				fs.write(reinterpret_cast<const char*>(&emptyBlock[0]), blockSize * sizeof(T));
+
+			fs.write(reinterpret_cast<const char*>(pagedBlocks + (size_t)firstBlockId * blockSize), (size_t)noCommittedBlocks * blockSize * sizeof(T));
+			if (!fs) throw std::runtime_error("Could not write memory block data");
+		}
+
+		/** Reads the committed blocks of a file written by SavePagedBlocks(), the array has to have been grown to hold them. */
+		template<class T>
+		void LoadPagedBlocks(const std::string &filename, T *pagedBlocks)
+		{
+			if (ORUtils::MemoryBlockPersister::ReadBlockSize(filename) != (size_t)noBlocks * blockSize)
+				throw std::runtime_error("Could not read data into a memory block of the wrong size");
+
+			std::ifstream fs(filename.c_str(), std::ios::binary);
+			if (!fs) throw std::runtime_error("Could not open " + filename + " for reading");
+
+			int firstBlockId = noBlocks - noCommittedBlocks;
+			if (!fs.seekg(sizeof(size_t) + (size_t)firstBlockId * blockSize * sizeof(T))) throw std::runtime_error("Could not skip memory block data");
+			if (!fs.read(reinterpret_cast<char*>(pagedBlocks + (size_t)firstBlockId * blockSize), (size_t)noCommittedBlocks * blockSize * sizeof(T)))
+				throw std::runtime_error("Could not read memory block data");
+		}
+
 	public:
-		inline TVoxel *GetVoxelBlocks(void) { return voxelBlocks->GetData(memoryType); }
-		inline const TVoxel *GetVoxelBlocks(void) const { return voxelBlocks->GetData(memoryType); }
+		inline TVoxel *GetVoxelBlocks(void) { return pagedVoxelBlocks != NULL ? pagedVoxelBlocks : voxelBlocks->GetData(memoryType); }
+		inline const TVoxel *GetVoxelBlocks(void) const { return pagedVoxelBlocks != NULL ? pagedVoxelBlocks : voxelBlocks->GetData(memoryType); }
 		int *GetAllocationList(void) { return allocationList->GetData(memoryType); }
 
+		/** \brief
+		    Returns the colour stream of the voxels, indexed like
+		    GetVoxelBlocks(): the voxel blocks themselves, or the
+		    separate ITMVoxelColour array if TVoxel has
+		    hasSeparateColourInformation.
+		*/
+		inline TColourVoxel *GetColourBlocks(void)
+		{
+			TColourVoxel *colourBlocks_ptr = pagedColourBlocks != NULL ? pagedColourBlocks : colourBlocks != NULL ? colourBlocks->GetData(memoryType) : NULL;
+			return ITMColourVoxel<TVoxel>::Select(GetVoxelBlocks(), colourBlocks_ptr);
+		}
+		inline const TColourVoxel *GetColourBlocks(void) const
+		{
+			const TColourVoxel *colourBlocks_ptr = pagedColourBlocks != NULL ? pagedColourBlocks : colourBlocks != NULL ? colourBlocks->GetData(memoryType) : NULL;
+			return ITMColourVoxel<TVoxel>::Select(GetVoxelBlocks(), colourBlocks_ptr);
+		}
+
 #ifdef COMPILE_WITH_METAL
 		const void* GetVoxelBlocks_MB() const { return voxelBlocks->GetMetalBuffer(); }
 		const void* GetAllocationList_MB(void) const { return allocationList->GetMetalBuffer(); }
 #endif
 		int lastFreeBlockId;
 
+		/** Number of voxels currently backed by memory. */
 		int allocatedSize;
+
+		/** Number of voxel blocks currently backed by memory, always the ids [getNumAllocatedVoxelBlocks() - GetNumCommittedBlocks(), getNumAllocatedVoxelBlocks()). */
+		int GetNumCommittedBlocks(void) const { return noCommittedBlocks; }
+
+		MemoryDeviceType GetMemoryType(void) const { return memoryType; }
+
+		/** \brief
+		    Commits the next page of voxel blocks, if the limit
+		    has not been reached yet, and inserts the new block ids
+		    at the bottom of the allocation list. Blocks that are
+		    already free are therefore still handed out first, no
+		    matter whether the list is grown early or on demand.
+
+		    \param lastFreeBlockId current top of the allocation list
+		    \return the new top of the allocation list
+		*/
+		int Grow(int lastFreeBlockId)
+		{
+			if (pagedVoxelBlocks == NULL || noCommittedBlocks >= noBlocks) return lastFreeBlockId;
+
+			int lastBlockId = noBlocks - noCommittedBlocks;
+			int firstBlockId = MAX(lastBlockId - pageSize, 0);
+			int noNewBlocks = lastBlockId - firstBlockId;
+			CommitBlocks(firstBlockId);
+
+			int *allocationList_ptr = allocationList->GetData(memoryType);
+			if (lastFreeBlockId >= 0) memmove(allocationList_ptr + noNewBlocks, allocationList_ptr, (lastFreeBlockId + 1) * sizeof(int));
+			for (int i = 0; i < noNewBlocks; ++i) allocationList_ptr[i] = firstBlockId + i;
+
+			return lastFreeBlockId + noNewBlocks;
+		}
+
+		/** Marks all voxel blocks as stale in constant time. */
+		void InvalidateBlocks(void) { generation++; }
+
+		/** Marks block @p blockId as stale, e.g. when it is returned to the allocation list. */
+		void ReleaseBlock(int blockId)
+		{
+			if (blockGenerations != NULL) blockGenerations->GetData(MEMORYDEVICE_CPU)[blockId] = generation - 1;
+		}
+
+		/** Resets the voxels of block @p blockId if it is stale, called for every block taken from the allocation list. */
+		void InitialiseBlock(int blockId)
+		{
+			unsigned int &blockGeneration = blockGenerations->GetData(MEMORYDEVICE_CPU)[blockId];
+			if (blockGeneration == generation) return;
+
+			TVoxel *voxelBlock = GetVoxelBlocks() + (size_t)blockId * blockSize;
+			for (int i = 0; i < blockSize; ++i) voxelBlock[i] = TVoxel();
+
+			if (TVoxel::hasSeparateColourInformation)
+			{
+				TColourVoxel *colourBlock = GetColourBlocks() + (size_t)blockId * blockSize;
+				for (int i = 0; i < blockSize; ++i) colourBlock[i] = TColourVoxel();
+			}
+
+			blockGeneration = generation;
+		}
+
+		/** \brief
+		    Maps @p noMappedBlocks voxel blocks, stored one after the
+		    other at @p offset in @p fileName, copy-on-write into the
+		    committed part of the array and rebuilds the allocation
+		    list from the remaining blocks. All blocks have to be
+		    free, i.e. the scene has to have been reset before.
+
+		    \return the id of the first mapped block, the others
+		    follow it, or -1 if the blocks could not be mapped and
+		    have to be read instead
+		*/
+		int MapBlocks(const std::string &fileName, size_t offset, int noMappedBlocks)
+		{
+			if (pagedVoxelBlocks == NULL || noMappedBlocks <= 0 || noMappedBlocks > noBlocks || mappedBytes > 0) return -1;
+			// the colour of the blocks is not part of the file
+			if (TVoxel::hasSeparateColourInformation) return -1;
+
+			// the mapping has to start on a page, so the blocks are placed as high as alignment allows
+			size_t blockBytes = (size_t)blockSize * sizeof(TVoxel), pageBytes = ORUtils::VirtualMemory::GetPageSize();
+			int firstBlockId = noBlocks - noMappedBlocks;
+			while (firstBlockId >= 0 && (size_t)firstBlockId * blockBytes % pageBytes != 0) firstBlockId--;
+			if (firstBlockId < 0) return -1;
+
+			size_t noMappedBytes = ((size_t)noMappedBlocks * blockBytes + pageBytes - 1) / pageBytes * pageBytes;
+			if (!ORUtils::VirtualMemory::MapFile(pagedVoxelBlocks + (size_t)firstBlockId * blockSize, noMappedBytes, fileName, offset)) return -1;
+
+			mappedBlockId = firstBlockId;
+			mappedBytes = noMappedBytes;
+
+			int lastMappedBlockId = firstBlockId + noMappedBlocks;
+			ORUtils::VirtualMemory::Commit(pagedVoxelBlocks + (size_t)lastMappedBlockId * blockSize, (size_t)(noBlocks - lastMappedBlockId) * blockBytes);
+			noCommittedBlocks = MAX(noCommittedBlocks, noBlocks - firstBlockId);
+			allocatedSize = noCommittedBlocks * blockSize;
+
+			unsigned int *blockGenerations_ptr = blockGenerations->GetData(MEMORYDEVICE_CPU);
+			int *allocationList_ptr = allocationList->GetData(memoryType);
+			int noFreeBlocks = 0;
+			for (int blockId = noBlocks - noCommittedBlocks; blockId < noBlocks; ++blockId)
+			{
+				if (blockId >= firstBlockId && blockId < lastMappedBlockId) blockGenerations_ptr[blockId] = generation;
+				else
+				{
+					ReleaseBlock(blockId);
+					allocationList_ptr[noFreeBlocks++] = blockId;
+				}
+			}
+			lastFreeBlockId = noFreeBlocks - 1;
+
+			return firstBlockId;
+		}
+
+		/** Returns all but the first page of voxel blocks to the system. The caller is expected to reset the allocation list afterwards. */
+		void Shrink(void)
+		{
+			if (pagedVoxelBlocks == NULL) return;
+
+			if (mappedBytes > 0)
+			{
+				// drop the mapped file together with all committed blocks and start over from the first page
+				ORUtils::VirtualMemory::Decommit(pagedVoxelBlocks + (size_t)mappedBlockId * blockSize, mappedBytes);
+				ORUtils::VirtualMemory::Decommit(pagedVoxelBlocks + (size_t)(noBlocks - noCommittedBlocks) * blockSize, (size_t)noCommittedBlocks * blockSize * sizeof(TVoxel));
+				mappedBytes = 0;
+
+				noCommittedBlocks = 0;
+				CommitBlocks(noBlocks - MIN(pageSize, noBlocks));
+				return;
+			}
+
+			int firstBlockId = noBlocks - MIN(pageSize, noBlocks);
+			int lastBlockId = noBlocks - noCommittedBlocks;
+			if (lastBlockId >= firstBlockId) return;
+
+			ORUtils::VirtualMemory::Decommit(pagedVoxelBlocks + (size_t)lastBlockId * blockSize, (size_t)(firstBlockId - lastBlockId) * blockSize * sizeof(TVoxel));
+			if (pagedColourBlocks != NULL)
+				ORUtils::VirtualMemory::Decommit(pagedColourBlocks + (size_t)lastBlockId * blockSize, (size_t)(firstBlockId - lastBlockId) * blockSize * sizeof(TColourVoxel));
+
+			noCommittedBlocks = noBlocks - firstBlockId;
+			allocatedSize = noCommittedBlocks * blockSize;
+		}
+
 		/**
 		 * @brief 在k键后调用，保存体素
 		 * @param {type} 
@@ -41,9 +299,13 @@ namespace ITMLib
 		{
 			std::string VBFileName = outputDirectory + "voxel.dat";
 			std::string ALFileName = outputDirectory + "alloc.dat";
+			std::string CBFileName = outputDirectory + "colour.dat";
 			std::string AllocSizeFileName = outputDirectory + "vba.txt";
 
-			ORUtils::MemoryBlockPersister::SaveMemoryBlock(VBFileName, *voxelBlocks, memoryType);
+			if (pagedVoxelBlocks != NULL) SavePagedBlocks(VBFileName, pagedVoxelBlocks);
+			else ORUtils::MemoryBlockPersister::SaveMemoryBlock(VBFileName, *voxelBlocks, memoryType);
+			if (pagedColourBlocks != NULL) SavePagedBlocks(CBFileName, pagedColourBlocks);
+			else if (colourBlocks != NULL) ORUtils::MemoryBlockPersister::SaveMemoryBlock(CBFileName, *colourBlocks, memoryType);
 			ORUtils::MemoryBlockPersister::SaveMemoryBlock(ALFileName, *allocationList, memoryType);
 
 			std::ofstream ofs(AllocSizeFileName.c_str());
@@ -56,31 +318,99 @@ namespace ITMLib
 		{
 			std::string VBFileName = inputDirectory + "voxel.dat";
 			std::string ALFileName = inputDirectory + "alloc.dat";
+			std::string CBFileName = inputDirectory + "colour.dat";
 			std::string AllocSizeFileName = inputDirectory + "vba.txt";
 
-			ORUtils::MemoryBlockPersister::LoadMemoryBlock(VBFileName, *voxelBlocks, memoryType);
-			ORUtils::MemoryBlockPersister::LoadMemoryBlock(ALFileName, *allocationList, memoryType);
-
 			std::ifstream ifs(AllocSizeFileName.c_str());
 			if (!ifs) throw std::runtime_error("Could not open " + AllocSizeFileName + " for reading");
 
-			ifs >> lastFreeBlockId >> allocatedSize;
+			int savedSize;
+			ifs >> lastFreeBlockId >> savedSize;
+
+			if (pagedVoxelBlocks != NULL)
+			{
+				Shrink();
+				CommitBlocks(MAX(noBlocks - savedSize / blockSize, 0));
+
+				LoadPagedBlocks(VBFileName, pagedVoxelBlocks);
+				if (pagedColourBlocks != NULL) LoadPagedBlocks(CBFileName, pagedColourBlocks);
+			}
+			else
+			{
+				ORUtils::MemoryBlockPersister::LoadMemoryBlock(VBFileName, *voxelBlocks, memoryType);
+				if (colourBlocks != NULL) ORUtils::MemoryBlockPersister::LoadMemoryBlock(CBFileName, *colourBlocks, memoryType);
+			}
+			ORUtils::MemoryBlockPersister::LoadMemoryBlock(ALFileName, *allocationList, memoryType);
+
+			// the free blocks in the file may hold old data, the blocks in use are never initialised again
+			InvalidateBlocks();
 		}
 
-		ITMLocalVBA(MemoryDeviceType memoryType, int noBlocks, int blockSize)
+		/** \brief
+		    \param noBlocks  maximum number of voxel blocks
+		    \param blockSize number of voxels per block
+		    \param pageSize  number of voxel blocks committed at a time, or 0 to commit all blocks up front
+		*/
+		ITMLocalVBA(MemoryDeviceType memoryType, int noBlocks, int blockSize, int pageSize = 0)
 		{
 			this->memoryType = memoryType;
+			this->noBlocks = noBlocks;
+			this->blockSize = blockSize;
+			this->pageSize = pageSize;
+
+			voxelBlocks = NULL;
+			pagedVoxelBlocks = NULL;
+			reservedBytes = 0;
+			colourBlocks = NULL;
+			pagedColourBlocks = NULL;
+			mappedBlockId = 0;
+			mappedBytes = 0;
+
+			if (TVoxel::hasSeparateColourInformation && memoryType != MEMORYDEVICE_CPU)
+				throw std::runtime_error("Voxels with separate colour are only supported in host memory");
+
+			// all blocks start out stale
+			generation = 1;
+			blockGenerations = NULL;
+			if (memoryType == MEMORYDEVICE_CPU)
+			{
+				blockGenerations = new ORUtils::MemoryBlock<unsigned int>(noBlocks, MEMORYDEVICE_CPU);
+				memset(blockGenerations->GetData(MEMORYDEVICE_CPU), 0, noBlocks * sizeof(unsigned int));
+			}
+
+#ifndef COMPILE_WITH_METAL
+			// Paging relies on reserving host address space, so device memory is always committed up front.
+			if (memoryType == MEMORYDEVICE_CPU && pageSize > 0 && pageSize < noBlocks)
+			{
+				reservedBytes = (size_t)noBlocks * blockSize * sizeof(TVoxel);
+				pagedVoxelBlocks = (TVoxel*)ORUtils::VirtualMemory::Reserve(reservedBytes);
+				if (TVoxel::hasSeparateColourInformation)
+					pagedColourBlocks = (TColourVoxel*)ORUtils::VirtualMemory::Reserve((size_t)noBlocks * blockSize * sizeof(TColourVoxel));
+
+				noCommittedBlocks = 0;
+				CommitBlocks(noBlocks - pageSize);
+			}
+#endif
 
-			allocatedSize = noBlocks * blockSize;
+			if (pagedVoxelBlocks == NULL)
+			{
+				noCommittedBlocks = noBlocks;
+				allocatedSize = noBlocks * blockSize;
+				voxelBlocks = new ORUtils::MemoryBlock<TVoxel>(allocatedSize, memoryType);
+				if (TVoxel::hasSeparateColourInformation) colourBlocks = new ORUtils::MemoryBlock<TColourVoxel>(allocatedSize, memoryType);
+			}
 
-			voxelBlocks = new ORUtils::MemoryBlock<TVoxel>(allocatedSize, memoryType);
 			allocationList = new ORUtils::MemoryBlock<int>(noBlocks, memoryType);
 		}
 
 		~ITMLocalVBA(void)
 		{
+			if (pagedVoxelBlocks != NULL) ORUtils::VirtualMemory::Release(pagedVoxelBlocks, reservedBytes);
+			if (pagedColourBlocks != NULL) ORUtils::VirtualMemory::Release(pagedColourBlocks, (size_t)noBlocks * blockSize * sizeof(TColourVoxel));
 			delete voxelBlocks;
+			delete colourBlocks;
 			delete allocationList;
+			delete blockGenerations;
 		}
 
 		// Suppress the default copy constructor and assignment operator
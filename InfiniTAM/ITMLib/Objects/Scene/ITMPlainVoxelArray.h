@@ -6,6 +6,7 @@
 
 #include "../../Utils/ITMMath.h"
 #include "../../../ORUtils/MemoryBlock.h"
+#include "../../Utils/ITMSceneParams.h"
 
 namespace ITMLib
 {
@@ -41,7 +42,7 @@ namespace ITMLib
 		MemoryDeviceType memoryType;
 
 	public:
-		ITMPlainVoxelArray(MemoryDeviceType memoryType)
+		ITMPlainVoxelArray(const ITMSceneParams *sceneParams, MemoryDeviceType memoryType)
 		{
 			this->memoryType = memoryType;
 
@@ -58,8 +59,8 @@ namespace ITMLib
 		}
 
 		/** Maximum number of total entries. */
-		int getNumAllocatedVoxelBlocks(void) { return 1; }
-		int getVoxelBlockSize(void) 
+		int getNumAllocatedVoxelBlocks(void) const { return 1; }
+		int getVoxelBlockSize(void) const
 		{ 
 			return indexData->GetData(MEMORYDEVICE_CPU)->size.x * 
 				indexData->GetData(MEMORYDEVICE_CPU)->size.y * 
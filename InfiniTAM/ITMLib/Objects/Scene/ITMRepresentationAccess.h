@@ -3,9 +3,82 @@
 #pragma once
 
 #include "ITMVoxelBlockHash.h"
+#ifndef __METALC__
+#include "ITMVoxelBlockProbingHash.h"
+#endif
+
+/** Bucket mask of a hash table, stored in the header entry just before the first bucket. */
+_CPU_AND_GPU_CODE_ inline int getHashMask(const CONSTPTR(ITMHashEntry) *hashTable) { return hashTable[-1].offset; }
+
+/** Number of buckets of a hash table, i.e. the index at which the excess list starts. */
+_CPU_AND_GPU_CODE_ inline int getNumHashBuckets(const CONSTPTR(ITMHashEntry) *hashTable) { return hashTable[-1].ptr; }
+
+#ifndef __METALC__
+/** Slot mask of a probing hash table, stored in the header entry just before the first slot. */
+_CPU_AND_GPU_CODE_ inline int getHashMask(const CONSTPTR(ITMProbingHashEntry) *hashTable) { return (int)hashTable[-1].key; }
 
-template<typename T> _CPU_AND_GPU_CODE_ inline int hashIndex(const THREADPTR(T) & blockPos) {
-	return (((uint)blockPos.x * 73856093u) ^ ((uint)blockPos.y * 19349669u) ^ ((uint)blockPos.z * 83492791u)) & (uint)SDF_HASH_MASK;
+/** Packs a block position into the key of a probing hash table slot, 16 bits per coordinate. */
+template<typename T> _CPU_AND_GPU_CODE_ inline unsigned long long packBlockKey(const THREADPTR(T) & blockPos) {
+	return (unsigned long long)(ushort)blockPos.x | ((unsigned long long)(ushort)blockPos.y << 16) | ((unsigned long long)(ushort)blockPos.z << 32);
+}
+
+_CPU_AND_GPU_CODE_ inline Vector3s unpackBlockKey(unsigned long long key) {
+	return Vector3s((short)(ushort)key, (short)(ushort)(key >> 16), (short)(ushort)(key >> 32));
+}
+
+/** Slot holding @p blockPos in a probing hash table, or -1 if the block is not in the table. */
+template<typename T> _CPU_AND_GPU_CODE_ inline int findProbingHashSlot(const CONSTPTR(ITMProbingHashEntry) *hashTable, const THREADPTR(T) & blockPos)
+{
+	int hashMask = getHashMask(hashTable);
+	unsigned long long key = packBlockKey(blockPos);
+	int hashIdx = hashIndex(blockPos, hashMask);
+
+	for (int probe = 0; probe <= hashMask; probe++)
+	{
+		unsigned long long slotKey = hashTable[hashIdx].key;
+
+		if (slotKey == key) return hashIdx;
+		if (slotKey == PROBING_HASH_EMPTY_KEY) break;
+
+		hashIdx = (hashIdx + 1) & hashMask;
+	}
+
+	return -1;
+}
+#endif
+
+/** Position of the voxel block referenced by a hash table entry. */
+_CPU_AND_GPU_CODE_ inline Vector3s getBlockPos(const THREADPTR(ITMHashEntry) & hashEntry) { return hashEntry.pos; }
+#ifndef __METALC__
+_CPU_AND_GPU_CODE_ inline Vector3s getBlockPos(const THREADPTR(ITMProbingHashEntry) & hashEntry) { return unpackBlockKey(hashEntry.key); }
+#endif
+
+#ifdef USE_MORTON_VOXEL_ORDER
+#if SDF_BLOCK_SIZE != 8
+#error USE_MORTON_VOXEL_ORDER requires a SDF_BLOCK_SIZE of 8
+#endif
+
+/** Spreads the three low bits of @p v two bits apart, for the Z-order index. */
+_CPU_AND_GPU_CODE_ inline int spreadVoxelIdBits(int v) { v &= 7; return (v | (v << 2) | (v << 4)) & 0x49; }
+#endif
+
+/** \brief
+    Index of the voxel at @p x, @p y, @p z, all in [0, SDF_BLOCK_SIZE),
+    within its voxel block. Voxels are stored x fastest by default.
+    With USE_MORTON_VOXEL_ORDER they are stored in Z-order, so that
+    each 2x2x2 cube of voxels, e.g. the corners of a trilinear
+    interpolation or a marching cubes cell, shares a cache line far
+    more often. Code that walks the voxels of a block in space has to
+    go through this function, code that visits all voxels of a block
+    regardless of their position may use any order.
+*/
+_CPU_AND_GPU_CODE_ inline int voxelIdInBlock(int x, int y, int z)
+{
+#ifdef USE_MORTON_VOXEL_ORDER
+	return spreadVoxelIdBits(x) | (spreadVoxelIdBits(y) << 1) | (spreadVoxelIdBits(z) << 2);
+#else
+	return x + y * SDF_BLOCK_SIZE + z * SDF_BLOCK_SIZE * SDF_BLOCK_SIZE;
+#endif
 }
 
 _CPU_AND_GPU_CODE_ inline int pointToVoxelBlockPos(const THREADPTR(Vector3i) & point, THREADPTR(Vector3i) &blockPos) {
@@ -13,10 +86,39 @@ _CPU_AND_GPU_CODE_ inline int pointToVoxelBlockPos(const THREADPTR(Vector3i) & p
 	blockPos.y = ((point.y < 0) ? point.y - SDF_BLOCK_SIZE + 1 : point.y) / SDF_BLOCK_SIZE;
 	blockPos.z = ((point.z < 0) ? point.z - SDF_BLOCK_SIZE + 1 : point.z) / SDF_BLOCK_SIZE;
 
+#ifdef USE_MORTON_VOXEL_ORDER
+	// the low bits of point are its position in the block, also for negative coordinates
+	return voxelIdInBlock(point.x, point.y, point.z);
+#else
 	//Vector3i locPos = point - blockPos * SDF_BLOCK_SIZE;
 	//return locPos.x + locPos.y * SDF_BLOCK_SIZE + locPos.z * SDF_BLOCK_SIZE * SDF_BLOCK_SIZE;
 	return point.x + (point.y - blockPos.x) * SDF_BLOCK_SIZE + (point.z - blockPos.y) * SDF_BLOCK_SIZE * SDF_BLOCK_SIZE - blockPos.z * SDF_BLOCK_SIZE3;
+#endif
+}
+
+#ifndef __METALC__
+/** \brief
+    Finds the entry of the block at @p blockPos through the neighbour
+    links of the block in @p cache, see
+    ITMVoxelBlockHash::GetNeighbourLinks(). Returns false if the cache
+    does not follow links or the block is not next to the cached one,
+    the hash table has to be searched then. Otherwise @p entryId is the
+    entry of the block, or -1 if it is not in the local voxel block
+    array.
+*/
+_CPU_AND_GPU_CODE_ inline bool findLinkedEntry(const THREADPTR(Vector3i) & blockPos, const THREADPTR(ITMLib::ITMVoxelBlockHash::IndexCache) & cache,
+	THREADPTR(int) &entryId)
+{
+	if (cache.neighbourLinks == NULL || cache.blockPtr < 0) return false;
+
+	Vector3i offset = blockPos - cache.blockPos + Vector3i(1, 1, 1);
+	if ((uint)offset.x > 2 || (uint)offset.y > 2 || (uint)offset.z > 2) return false;
+
+	const int *blockLinks = cache.neighbourLinks + (cache.blockPtr / SDF_BLOCK_SIZE3) * ITMLib::ITMVoxelBlockHash::noNeighbourLinks;
+	entryId = blockLinks[offset.x + offset.y * 3 + offset.z * 9];
+	return true;
 }
+#endif
 
 _CPU_AND_GPU_CODE_ inline int findVoxel(const CONSTPTR(ITMLib::ITMVoxelBlockHash::IndexData) *voxelIndex, const THREADPTR(Vector3i) & point,
 	THREADPTR(int) &vmIndex, THREADPTR(ITMLib::ITMVoxelBlockHash::IndexCache) & cache)
@@ -30,7 +132,23 @@ _CPU_AND_GPU_CODE_ inline int findVoxel(const CONSTPTR(ITMLib::ITMVoxelBlockHash
 		return cache.blockPtr + linearIdx;
 	}
 
-	int hashIdx = hashIndex(blockPos);
+#ifndef __METALC__
+	int linkedEntryId;
+	if (findLinkedEntry(blockPos, cache, linkedEntryId))
+	{
+		if (linkedEntryId < 0)
+		{
+			vmIndex = false;
+			return -1;
+		}
+
+		vmIndex = true;
+		cache.blockPos = blockPos; cache.blockPtr = voxelIndex[linkedEntryId].ptr * SDF_BLOCK_SIZE3;
+		return cache.blockPtr + linearIdx;
+	}
+#endif
+
+	int hashIdx = hashIndex(blockPos, getHashMask(voxelIndex));
 
 	while (true)
 	{
@@ -44,7 +162,7 @@ _CPU_AND_GPU_CODE_ inline int findVoxel(const CONSTPTR(ITMLib::ITMVoxelBlockHash
 		}
 
 		if (hashEntry.offset < 1) break;
-		hashIdx = SDF_BUCKET_NUM + hashEntry.offset - 1;
+		hashIdx = getNumHashBuckets(voxelIndex) + hashEntry.offset - 1;
 	}
 
 	vmIndex = false;
@@ -79,7 +197,23 @@ _CPU_AND_GPU_CODE_ inline TVoxel readVoxel(const CONSTPTR(TVoxel) *voxelData, co
 		return voxelData[cache.blockPtr + linearIdx];
 	}
 
-	int hashIdx = hashIndex(blockPos);
+#ifndef __METALC__
+	int linkedEntryId;
+	if (findLinkedEntry(blockPos, cache, linkedEntryId))
+	{
+		if (linkedEntryId < 0)
+		{
+			vmIndex = false;
+			return TVoxel();
+		}
+
+		cache.blockPos = blockPos; cache.blockPtr = voxelIndex[linkedEntryId].ptr * SDF_BLOCK_SIZE3;
+		vmIndex = linkedEntryId + 1;
+		return voxelData[cache.blockPtr + linearIdx];
+	}
+#endif
+
+	int hashIdx = hashIndex(blockPos, getHashMask(voxelIndex));
 
 	while (true)
 	{
@@ -94,7 +228,7 @@ _CPU_AND_GPU_CODE_ inline TVoxel readVoxel(const CONSTPTR(TVoxel) *voxelData, co
 		}
 
 		if (hashEntry.offset < 1) break;
-		hashIdx = SDF_BUCKET_NUM + hashEntry.offset - 1;
+		hashIdx = getNumHashBuckets(voxelIndex) + hashEntry.offset - 1;
 	}
 
 	vmIndex = false;
@@ -120,6 +254,179 @@ _CPU_AND_GPU_CODE_ inline TVoxel readVoxel(const CONSTPTR(TVoxel) *voxelData, co
 	return result;
 }
 
+#ifndef __METALC__
+_CPU_AND_GPU_CODE_ inline int findVoxel(const CONSTPTR(ITMLib::ITMVoxelBlockProbingHash::IndexData) *voxelIndex, const THREADPTR(Vector3i) & point,
+	THREADPTR(int) &vmIndex, THREADPTR(ITMLib::ITMVoxelBlockProbingHash::IndexCache) & cache)
+{
+	Vector3i blockPos;
+	short linearIdx = pointToVoxelBlockPos(point, blockPos);
+
+	if IS_EQUAL3(blockPos, cache.blockPos)
+	{
+		vmIndex = true;
+		return cache.blockPtr + linearIdx;
+	}
+
+	int hashIdx = findProbingHashSlot(voxelIndex, blockPos);
+
+	if (hashIdx >= 0 && voxelIndex[hashIdx].ptr >= 0)
+	{
+		vmIndex = true;
+		cache.blockPos = blockPos; cache.blockPtr = voxelIndex[hashIdx].ptr * SDF_BLOCK_SIZE3;
+		return cache.blockPtr + linearIdx;
+	}
+
+	vmIndex = false;
+	return -1;
+}
+
+_CPU_AND_GPU_CODE_ inline int findVoxel(const CONSTPTR(ITMLib::ITMVoxelBlockProbingHash::IndexData) *voxelIndex, Vector3i point, THREADPTR(int) &vmIndex)
+{
+	ITMLib::ITMVoxelBlockProbingHash::IndexCache cache;
+	return findVoxel(voxelIndex, point, vmIndex, cache);
+}
+
+_CPU_AND_GPU_CODE_ inline int findVoxel(const CONSTPTR(ITMLib::ITMVoxelBlockProbingHash::IndexData) *voxelIndex, Vector3i point, THREADPTR(bool) &foundPoint)
+{
+	int vmIndex;
+	ITMLib::ITMVoxelBlockProbingHash::IndexCache cache;
+	int result = findVoxel(voxelIndex, point, vmIndex, cache);
+	foundPoint = vmIndex != 0;
+	return result;
+}
+
+template<class TVoxel>
+_CPU_AND_GPU_CODE_ inline TVoxel readVoxel(const CONSTPTR(TVoxel) *voxelData, const CONSTPTR(ITMLib::ITMVoxelBlockProbingHash::IndexData) *voxelIndex,
+	const THREADPTR(Vector3i) & point, THREADPTR(int) &vmIndex, THREADPTR(ITMLib::ITMVoxelBlockProbingHash::IndexCache) & cache)
+{
+	Vector3i blockPos;
+	int linearIdx = pointToVoxelBlockPos(point, blockPos);
+
+	if IS_EQUAL3(blockPos, cache.blockPos)
+	{
+		vmIndex = true;
+		return voxelData[cache.blockPtr + linearIdx];
+	}
+
+	int hashIdx = findProbingHashSlot(voxelIndex, blockPos);
+
+	if (hashIdx >= 0 && voxelIndex[hashIdx].ptr >= 0)
+	{
+		cache.blockPos = blockPos; cache.blockPtr = voxelIndex[hashIdx].ptr * SDF_BLOCK_SIZE3;
+		vmIndex = hashIdx + 1; // add 1 to support legacy true / false operations for isFound
+
+		return voxelData[cache.blockPtr + linearIdx];
+	}
+
+	vmIndex = false;
+	return TVoxel();
+}
+
+template<class TVoxel>
+_CPU_AND_GPU_CODE_ inline TVoxel readVoxel(const CONSTPTR(TVoxel) *voxelData, const CONSTPTR(ITMLib::ITMVoxelBlockProbingHash::IndexData) *voxelIndex,
+	Vector3i point, THREADPTR(int) &vmIndex)
+{
+	ITMLib::ITMVoxelBlockProbingHash::IndexCache cache;
+	return readVoxel(voxelData, voxelIndex, point, vmIndex, cache);
+}
+
+template<class TVoxel>
+_CPU_AND_GPU_CODE_ inline TVoxel readVoxel(const CONSTPTR(TVoxel) *voxelData, const CONSTPTR(ITMLib::ITMVoxelBlockProbingHash::IndexData) *voxelIndex,
+	Vector3i point, THREADPTR(bool) &foundPoint)
+{
+	int vmIndex;
+	ITMLib::ITMVoxelBlockProbingHash::IndexCache cache;
+	TVoxel result = readVoxel(voxelData, voxelIndex, point, vmIndex, cache);
+	foundPoint = vmIndex != 0;
+	return result;
+}
+#endif
+
+/** Reads the eight voxels of a cell one by one, see readVoxelCell. */
+template<class TVoxel, class TIndex, class TCache>
+_CPU_AND_GPU_CODE_ inline void readVoxelCellByCorner(THREADPTR(TVoxel) *cell, const CONSTPTR(TVoxel) *voxelData, const CONSTPTR(TIndex) *voxelIndex,
+	const THREADPTR(Vector3i) & pos, THREADPTR(int) &vmIndex, THREADPTR(TCache) & cache)
+{
+	cell[0] = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, 0, 0), vmIndex, cache);
+	cell[1] = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, 0, 0), vmIndex, cache);
+	cell[2] = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, 1, 0), vmIndex, cache);
+	cell[3] = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, 1, 0), vmIndex, cache);
+	cell[4] = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, 0, 1), vmIndex, cache);
+	cell[5] = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, 0, 1), vmIndex, cache);
+	cell[6] = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, 1, 1), vmIndex, cache);
+	cell[7] = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, 1, 1), vmIndex, cache);
+}
+
+/** \brief
+    Reads the eight voxels of the cell from @p pos to @p pos + (1, 1, 1)
+    of a hashed scene into @p cell, cell[i] being the corner at
+    (i & 1, (i >> 1) & 1, i >> 2). About two thirds of all cells lie
+    within a single voxel block, for those the block is looked up once
+    and the corners are read from it directly. Only cells on a block
+    border go through readVoxel for each corner.
+*/
+template<class TVoxel, class TIndex, class TCache>
+_CPU_AND_GPU_CODE_ inline void readVoxelCellFromBlocks(THREADPTR(TVoxel) *cell, const CONSTPTR(TVoxel) *voxelData, const CONSTPTR(TIndex) *voxelIndex,
+	const THREADPTR(Vector3i) & pos, THREADPTR(int) &vmIndex, THREADPTR(TCache) & cache)
+{
+	const int lastInBlock = SDF_BLOCK_SIZE - 1;
+	int x = pos.x & lastInBlock, y = pos.y & lastInBlock, z = pos.z & lastInBlock;
+
+	if (x == lastInBlock || y == lastInBlock || z == lastInBlock)
+	{
+		readVoxelCellByCorner(cell, voxelData, voxelIndex, pos, vmIndex, cache);
+		return;
+	}
+
+	if (findVoxel(voxelIndex, pos, vmIndex, cache) < 0)
+	{
+		for (int i = 0; i < 8; i++) cell[i] = TVoxel();
+		return;
+	}
+
+	const CONSTPTR(TVoxel) *block = voxelData + cache.blockPtr;
+	cell[0] = block[voxelIdInBlock(x, y, z)];
+	cell[1] = block[voxelIdInBlock(x + 1, y, z)];
+	cell[2] = block[voxelIdInBlock(x, y + 1, z)];
+	cell[3] = block[voxelIdInBlock(x + 1, y + 1, z)];
+	cell[4] = block[voxelIdInBlock(x, y, z + 1)];
+	cell[5] = block[voxelIdInBlock(x + 1, y, z + 1)];
+	cell[6] = block[voxelIdInBlock(x, y + 1, z + 1)];
+	cell[7] = block[voxelIdInBlock(x + 1, y + 1, z + 1)];
+}
+
+template<class TVoxel>
+_CPU_AND_GPU_CODE_ inline void readVoxelCell(THREADPTR(TVoxel) *cell, const CONSTPTR(TVoxel) *voxelData, const CONSTPTR(ITMLib::ITMVoxelBlockHash::IndexData) *voxelIndex,
+	const THREADPTR(Vector3i) & pos, THREADPTR(int) &vmIndex, THREADPTR(ITMLib::ITMVoxelBlockHash::IndexCache) & cache)
+{
+	readVoxelCellFromBlocks(cell, voxelData, voxelIndex, pos, vmIndex, cache);
+}
+
+template<class TVoxel>
+_CPU_AND_GPU_CODE_ inline void readVoxelCell(THREADPTR(TVoxel) *cell, const CONSTPTR(TVoxel) *voxelData, const CONSTPTR(ITMLib::ITMVoxelBlockHash::IndexData) *voxelIndex,
+	const THREADPTR(Vector3i) & pos, THREADPTR(int) &vmIndex)
+{
+	ITMLib::ITMVoxelBlockHash::IndexCache cache;
+	readVoxelCellFromBlocks(cell, voxelData, voxelIndex, pos, vmIndex, cache);
+}
+
+#ifndef __METALC__
+template<class TVoxel>
+_CPU_AND_GPU_CODE_ inline void readVoxelCell(THREADPTR(TVoxel) *cell, const CONSTPTR(TVoxel) *voxelData, const CONSTPTR(ITMLib::ITMVoxelBlockProbingHash::IndexData) *voxelIndex,
+	const THREADPTR(Vector3i) & pos, THREADPTR(int) &vmIndex, THREADPTR(ITMLib::ITMVoxelBlockProbingHash::IndexCache) & cache)
+{
+	readVoxelCellFromBlocks(cell, voxelData, voxelIndex, pos, vmIndex, cache);
+}
+
+template<class TVoxel>
+_CPU_AND_GPU_CODE_ inline void readVoxelCell(THREADPTR(TVoxel) *cell, const CONSTPTR(TVoxel) *voxelData, const CONSTPTR(ITMLib::ITMVoxelBlockProbingHash::IndexData) *voxelIndex,
+	const THREADPTR(Vector3i) & pos, THREADPTR(int) &vmIndex)
+{
+	ITMLib::ITMVoxelBlockProbingHash::IndexCache cache;
+	readVoxelCellFromBlocks(cell, voxelData, voxelIndex, pos, vmIndex, cache);
+}
+#endif
+
 template<class TVoxel, class TIndex>
 _CPU_AND_GPU_CODE_ inline float readFromSDF_float_uninterpolated(const CONSTPTR(TVoxel) *voxelData,
 	const CONSTPTR(TIndex) *voxelIndex, Vector3f point, THREADPTR(int) &vmIndex)
@@ -142,21 +449,23 @@ _CPU_AND_GPU_CODE_ inline float readFromSDF_float_interpolated(const CONSTPTR(TV
 {
 	float res1, res2, v1, v2;
 	Vector3f coeff; Vector3i pos; TO_INT_FLOOR3(pos, coeff, point);
+	TVoxel cell[8];
+	readVoxelCell(cell, voxelData, voxelIndex, pos, vmIndex, cache);
 
-	v1 = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, 0, 0), vmIndex, cache).sdf;
-	v2 = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, 0, 0), vmIndex, cache).sdf;
+	v1 = cell[0].sdf;
+	v2 = cell[1].sdf;
 	res1 = (1.0f - coeff.x) * v1 + coeff.x * v2;
 
-	v1 = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, 1, 0), vmIndex, cache).sdf;
-	v2 = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, 1, 0), vmIndex, cache).sdf;
+	v1 = cell[2].sdf;
+	v2 = cell[3].sdf;
 	res1 = (1.0f - coeff.y) * res1 + coeff.y * ((1.0f - coeff.x) * v1 + coeff.x * v2);
 
-	v1 = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, 0, 1), vmIndex, cache).sdf;
-	v2 = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, 0, 1), vmIndex, cache).sdf;
+	v1 = cell[4].sdf;
+	v2 = cell[5].sdf;
 	res2 = (1.0f - coeff.x) * v1 + coeff.x * v2;
 
-	v1 = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, 1, 1), vmIndex, cache).sdf;
-	v2 = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, 1, 1), vmIndex, cache).sdf;
+	v1 = cell[6].sdf;
+	v2 = cell[7].sdf;
 	res2 = (1.0f - coeff.y) * res2 + coeff.y * ((1.0f - coeff.x) * v1 + coeff.x * v2);
 
 	vmIndex = true;
@@ -172,24 +481,26 @@ _CPU_AND_GPU_CODE_ inline float readWithConfidenceFromSDF_float_interpolated(THR
 	TVoxel voxel;
 
 	Vector3f coeff; Vector3i pos; TO_INT_FLOOR3(pos, coeff, point);
+	TVoxel cell[8];
+	readVoxelCell(cell, voxelData, voxelIndex, pos, vmIndex, cache);
 
-	voxel = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, 0, 0), vmIndex, cache); v1 = voxel.sdf; v1_c = voxel.w_depth;
-	voxel = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, 0, 0), vmIndex, cache); v2 = voxel.sdf; v2_c = voxel.w_depth;
+	voxel = cell[0]; v1 = voxel.sdf; v1_c = voxel.w_depth;
+	voxel = cell[1]; v2 = voxel.sdf; v2_c = voxel.w_depth;
 	res1 = (1.0f - coeff.x) * v1 + coeff.x * v2;
 	res1_c = (1.0f - coeff.x) * v1_c + coeff.x * v2_c;
 
-	voxel = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, 1, 0), vmIndex, cache); v1 = voxel.sdf; v1_c = voxel.w_depth;
-	voxel = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, 1, 0), vmIndex, cache); v2 = voxel.sdf; v2_c = voxel.w_depth;
+	voxel = cell[2]; v1 = voxel.sdf; v1_c = voxel.w_depth;
+	voxel = cell[3]; v2 = voxel.sdf; v2_c = voxel.w_depth;
 	res1 = (1.0f - coeff.y) * res1 + coeff.y * ((1.0f - coeff.x) * v1 + coeff.x * v2);
 	res1_c = (1.0f - coeff.y) * res1_c + coeff.y * ((1.0f - coeff.x) * v1_c + coeff.x * v2_c);
 
-	voxel = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, 0, 1), vmIndex, cache); v1 = voxel.sdf; v1_c = voxel.w_depth;
-	voxel = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, 0, 1), vmIndex, cache); v2 = voxel.sdf; v2_c = voxel.w_depth;
+	voxel = cell[4]; v1 = voxel.sdf; v1_c = voxel.w_depth;
+	voxel = cell[5]; v2 = voxel.sdf; v2_c = voxel.w_depth;
 	res2 = (1.0f - coeff.x) * v1 + coeff.x * v2;
 	res2_c = (1.0f - coeff.x) * v1_c + coeff.x * v2_c;
 
-	voxel = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, 1, 1), vmIndex, cache); v1 = voxel.sdf; v1_c = voxel.w_depth;
-	voxel = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, 1, 1), vmIndex, cache); v2 = voxel.sdf; v2_c = voxel.w_depth;
+	voxel = cell[6]; v1 = voxel.sdf; v1_c = voxel.w_depth;
+	voxel = cell[7]; v2 = voxel.sdf; v2_c = voxel.w_depth;
 	res2 = (1.0f - coeff.y) * res2 + coeff.y * ((1.0f - coeff.x) * v1 + coeff.x * v2);
 	res2_c = (1.0f - coeff.y) * res2_c + coeff.y * ((1.0f - coeff.x) * v1_c + coeff.x * v2_c);
 
@@ -206,50 +517,52 @@ _CPU_AND_GPU_CODE_ inline float readFromSDF_float_interpolated(const CONSTPTR(TV
 {
 	float res1, res2, v1, v2;
 	Vector3f coeff; Vector3i pos; TO_INT_FLOOR3(pos, coeff, point);
+	TVoxel cell[8];
+	readVoxelCell(cell, voxelData, voxelIndex, pos, vmIndex, cache);
 
 	{
-		const TVoxel & v = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, 0, 0), vmIndex, cache);
+		const TVoxel & v = cell[0];
 		v1 = v.sdf;
 		maxW = v.w_depth;
 	}
 	{
-		const TVoxel & v = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, 0, 0), vmIndex, cache);
+		const TVoxel & v = cell[1];
 		v2 = v.sdf;
 		if (v.w_depth > maxW) maxW = v.w_depth;
 	}
 	res1 = (1.0f - coeff.x) * v1 + coeff.x * v2;
 
 	{
-		const TVoxel & v = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, 1, 0), vmIndex, cache);
+		const TVoxel & v = cell[2];
 		v1 = v.sdf;
 		if (v.w_depth > maxW) maxW = v.w_depth;
 	}
 	{
-		const TVoxel & v = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, 1, 0), vmIndex, cache);
+		const TVoxel & v = cell[3];
 		v2 = v.sdf;
 		if (v.w_depth > maxW) maxW = v.w_depth;
 	}
 	res1 = (1.0f - coeff.y) * res1 + coeff.y * ((1.0f - coeff.x) * v1 + coeff.x * v2);
 
 	{
-		const TVoxel & v = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, 0, 1), vmIndex, cache);
+		const TVoxel & v = cell[4];
 		v1 = v.sdf;
 		if (v.w_depth > maxW) maxW = v.w_depth;
 	}
 	{
-		const TVoxel & v = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, 0, 1), vmIndex, cache);
+		const TVoxel & v = cell[5];
 		v2 = v.sdf;
 		if (v.w_depth > maxW) maxW = v.w_depth;
 	}
 	res2 = (1.0f - coeff.x) * v1 + coeff.x * v2;
 
 	{
-		const TVoxel & v = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, 1, 1), vmIndex, cache);
+		const TVoxel & v = cell[6];
 		v1 = v.sdf;
 		if (v.w_depth > maxW) maxW = v.w_depth;
 	}
 	{
-		const TVoxel & v = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, 1, 1), vmIndex, cache);
+		const TVoxel & v = cell[7];
 		v2 = v.sdf;
 		if (v.w_depth > maxW) maxW = v.w_depth;
 	}
@@ -265,29 +578,31 @@ _CPU_AND_GPU_CODE_ inline Vector4f readFromSDF_color4u_interpolated(const CONSTP
 {
 	TVoxel resn; Vector3f ret(0.0f); Vector4f ret4; int vmIndex;
 	Vector3f coeff; Vector3i pos; TO_INT_FLOOR3(pos, coeff, point);
+	TVoxel cell[8];
+	readVoxelCell(cell, voxelData, voxelIndex, pos, vmIndex, cache);
 
-	resn = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, 0, 0), vmIndex, cache);
+	resn = cell[0];
 	ret += (1.0f - coeff.x) * (1.0f - coeff.y) * (1.0f - coeff.z) * resn.clr.toFloat();
 
-	resn = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, 0, 0), vmIndex, cache);
+	resn = cell[1];
 	ret += (coeff.x) * (1.0f - coeff.y) * (1.0f - coeff.z) * resn.clr.toFloat();
 
-	resn = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, 1, 0), vmIndex, cache);
+	resn = cell[2];
 	ret += (1.0f - coeff.x) * (coeff.y) * (1.0f - coeff.z) * resn.clr.toFloat();
 
-	resn = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, 1, 0), vmIndex, cache);
+	resn = cell[3];
 	ret += (coeff.x) * (coeff.y) * (1.0f - coeff.z) * resn.clr.toFloat();
 
-	resn = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, 0, 1), vmIndex, cache);
+	resn = cell[4];
 	ret += (1.0f - coeff.x) * (1.0f - coeff.y) * coeff.z * resn.clr.toFloat();
 
-	resn = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, 0, 1), vmIndex, cache);
+	resn = cell[5];
 	ret += (coeff.x) * (1.0f - coeff.y) * coeff.z * resn.clr.toFloat();
 
-	resn = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, 1, 1), vmIndex, cache);
+	resn = cell[6];
 	ret += (1.0f - coeff.x) * (coeff.y) * coeff.z * resn.clr.toFloat();
 
-	resn = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, 1, 1), vmIndex, cache);
+	resn = cell[7];
 	ret += (coeff.x) * (coeff.y) * coeff.z * resn.clr.toFloat();
 
 	ret4.x = ret.x; ret4.y = ret.y; ret4.z = ret.z; ret4.w = 255.0f;
@@ -301,36 +616,38 @@ _CPU_AND_GPU_CODE_ inline Vector4f readFromSDF_color4u_interpolated(const CONSTP
 {
 	TVoxel resn; Vector3f ret(0.0f); Vector4f ret4; int vmIndex;
 	Vector3f coeff; Vector3i pos; TO_INT_FLOOR3(pos, coeff, point);
+	TVoxel cell[8];
+	readVoxelCell(cell, voxelData, voxelIndex, pos, vmIndex, cache);
 
-	resn = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, 0, 0), vmIndex, cache);
+	resn = cell[0];
 	maxW = resn.w_depth;
 	ret += (1.0f - coeff.x) * (1.0f - coeff.y) * (1.0f - coeff.z) * resn.clr.toFloat();
 
-	resn = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, 0, 0), vmIndex, cache);
+	resn = cell[1];
 	if (resn.w_depth > maxW) maxW = resn.w_depth;
 	ret += (coeff.x) * (1.0f - coeff.y) * (1.0f - coeff.z) * resn.clr.toFloat();
 
-	resn = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, 1, 0), vmIndex, cache);
+	resn = cell[2];
 	if (resn.w_depth > maxW) maxW = resn.w_depth;
 	ret += (1.0f - coeff.x) * (coeff.y) * (1.0f - coeff.z) * resn.clr.toFloat();
 
-	resn = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, 1, 0), vmIndex, cache);
+	resn = cell[3];
 	if (resn.w_depth > maxW) maxW = resn.w_depth;
 	ret += (coeff.x) * (coeff.y) * (1.0f - coeff.z) * resn.clr.toFloat();
 
-	resn = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, 0, 1), vmIndex, cache);
+	resn = cell[4];
 	if (resn.w_depth > maxW) maxW = resn.w_depth;
 	ret += (1.0f - coeff.x) * (1.0f - coeff.y) * coeff.z * resn.clr.toFloat();
 
-	resn = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, 0, 1), vmIndex, cache);
+	resn = cell[5];
 	if (resn.w_depth > maxW) maxW = resn.w_depth;
 	ret += (coeff.x) * (1.0f - coeff.y) * coeff.z * resn.clr.toFloat();
 
-	resn = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, 1, 1), vmIndex, cache);
+	resn = cell[6];
 	if (resn.w_depth > maxW) maxW = resn.w_depth;
 	ret += (1.0f - coeff.x) * (coeff.y) * coeff.z * resn.clr.toFloat();
 
-	resn = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, 1, 1), vmIndex, cache);
+	resn = cell[7];
 	if (resn.w_depth > maxW) maxW = resn.w_depth;
 	ret += (coeff.x) * (coeff.y) * coeff.z * resn.clr.toFloat();
 
@@ -348,16 +665,19 @@ _CPU_AND_GPU_CODE_ inline Vector3f computeSingleNormalFromSDF(const CONSTPTR(TVo
 	Vector3f coeff; Vector3i pos; TO_INT_FLOOR3(pos, coeff, point);
 	Vector3f ncoeff(1.0f - coeff.x, 1.0f - coeff.y, 1.0f - coeff.z);
 
+	TVoxel cell[8];
+	readVoxelCell(cell, voxelData, voxelIndex, pos, vmIndex);
+
 	// all 8 values are going to be reused several times
 	Vector4f front, back;
-	front.x = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, 0, 0), vmIndex).sdf;
-	front.y = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, 0, 0), vmIndex).sdf;
-	front.z = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, 1, 0), vmIndex).sdf;
-	front.w = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, 1, 0), vmIndex).sdf;
-	back.x = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, 0, 1), vmIndex).sdf;
-	back.y = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, 0, 1), vmIndex).sdf;
-	back.z = readVoxel(voxelData, voxelIndex, pos + Vector3i(0, 1, 1), vmIndex).sdf;
-	back.w = readVoxel(voxelData, voxelIndex, pos + Vector3i(1, 1, 1), vmIndex).sdf;
+	front.x = cell[0].sdf;
+	front.y = cell[1].sdf;
+	front.z = cell[2].sdf;
+	front.w = cell[3].sdf;
+	back.x = cell[4].sdf;
+	back.y = cell[5].sdf;
+	back.z = cell[6].sdf;
+	back.w = cell[7].sdf;
 
 	Vector4f tmp;
 	float p1, p2, v1;
@@ -454,6 +774,13 @@ _CPU_AND_GPU_CODE_ inline Vector3f computeSingleNormalFromSDF(const CONSTPTR(TVo
 	return ret;
 }
 
+/** \brief
+    Reads the colour at @p point. @p voxelData is the colour stream
+    of the scene, see ITMLocalVBA::GetColourBlocks(): the voxel
+    blocks themselves for interleaved voxel types, the separate
+    ITMVoxelColour array otherwise. Both are addressed through the
+    same index, so readVoxel() serves either stream.
+*/
 template<bool hasColor, class TVoxel, class TIndex> struct VoxelColorReader;
 
 template<class TVoxel, class TIndex>
@@ -519,6 +846,39 @@ _CPU_AND_GPU_CODE_ inline TVoxel readVoxel(const CONSTPTR(TVoxel) *voxelData, co
 	return readVoxel(voxelData, voxelIndex, point_orig, vmIndex);
 }
 
+/** Reads the eight voxels of a cell, see readVoxelCell. Cells inside the array are read directly. */
+template<class TVoxel>
+_CPU_AND_GPU_CODE_ inline void readVoxelCell(THREADPTR(TVoxel) *cell, const CONSTPTR(TVoxel) *voxelData, const CONSTPTR(ITMLib::ITMPlainVoxelArray::IndexData) *voxelIndex,
+	const THREADPTR(Vector3i) & pos, THREADPTR(int) &vmIndex)
+{
+	Vector3i point = pos - voxelIndex->offset;
+
+	if ((point.x < 0) || (point.x >= voxelIndex->size.x - 1) ||
+		(point.y < 0) || (point.y >= voxelIndex->size.y - 1) ||
+		(point.z < 0) || (point.z >= voxelIndex->size.z - 1)) {
+		ITMLib::ITMPlainVoxelArray::IndexCache cache;
+		readVoxelCellByCorner(cell, voxelData, voxelIndex, pos, vmIndex, cache);
+		return;
+	}
+
+	int stepY = voxelIndex->size.x, stepZ = voxelIndex->size.x * voxelIndex->size.y;
+	const CONSTPTR(TVoxel) *corner = voxelData + point.x + point.y * stepY + point.z * stepZ;
+
+	cell[0] = corner[0]; cell[1] = corner[1];
+	cell[2] = corner[stepY]; cell[3] = corner[stepY + 1];
+	cell[4] = corner[stepZ]; cell[5] = corner[stepZ + 1];
+	cell[6] = corner[stepZ + stepY]; cell[7] = corner[stepZ + stepY + 1];
+
+	vmIndex = true;
+}
+
+template<class TVoxel>
+_CPU_AND_GPU_CODE_ inline void readVoxelCell(THREADPTR(TVoxel) *cell, const CONSTPTR(TVoxel) *voxelData, const CONSTPTR(ITMLib::ITMPlainVoxelArray::IndexData) *voxelIndex,
+	const THREADPTR(Vector3i) & pos, THREADPTR(int) &vmIndex, THREADPTR(ITMLib::ITMPlainVoxelArray::IndexCache) & cache)
+{
+	readVoxelCell(cell, voxelData, voxelIndex, pos, vmIndex);
+}
+
 /**
 * \brief The specialisations of this struct template can be used to write/read colours to/from surfels.
 *
@@ -41,9 +41,13 @@ namespace ITMLib
 		}
 
 		ITMScene(const ITMSceneParams *_sceneParams, bool _useSwapping, MemoryDeviceType _memoryType)
-			: sceneParams(_sceneParams), index(_memoryType), localVBA(_memoryType, index.getNumAllocatedVoxelBlocks(), index.getVoxelBlockSize())
+			: sceneParams(_sceneParams), index(_sceneParams, _memoryType), localVBA(_memoryType, index.getNumAllocatedVoxelBlocks(), index.getVoxelBlockSize(), _sceneParams->localBlockPageSize)
 		{
-			if (_useSwapping) globalCache = new ITMGlobalCache<TVoxel>();
+			// the global cache only swaps the voxel blocks
+			if (_useSwapping && TVoxel::hasSeparateColourInformation)
+				throw std::runtime_error("Swapping is not supported for voxels with separate colour");
+
+			if (_useSwapping) globalCache = new ITMGlobalCache<TVoxel>(_sceneParams->hashBucketNum + _sceneParams->excessListSize, _sceneParams->swapDirectory);
 			else globalCache = NULL;
 		}
 
@@ -0,0 +1,514 @@
+// Copyright 2014-2017 Oxford University Innovation Limited and the authors of InfiniTAM
+
+#pragma once
+
+#include <stdio.h>
+#include <string.h>
+#include <fstream>
+#include <map>
+#include <vector>
+
+#include "ITMRepresentationAccess.h"
+#include "ITMScene.h"
+
+namespace ITMLib
+{
+	/** \brief
+	    Header of a scene snapshot file. It is followed by the
+	    positions of the @ref noBlocks voxel blocks and, starting at
+	    @ref blockDataOffset, by their voxels in the same order.
+
+	    Checkpoint logs start with the same header, with a different
+	    magic and no blocks, see ITMSceneSnapshot::AppendToLog().
+	*/
+	struct ITMSceneSnapshotHeader
+	{
+		static const int currentVersion = 3;
+		/** The voxel data starts at a multiple of this, so that it can be mapped from the file. */
+		static const int blockDataAlignment = 0x10000;
+
+		char magic[8];
+		int version;
+
+		/** @{ */
+		/** Identifies the voxel type, see ITMVoxelTypes.h. */
+		int voxelBytes, hasColorInformation, hasConfidenceInformation, blockSize;
+		/** @} */
+
+		/** Order of the voxels within a block, 1 for Z-order, see voxelIdInBlock(). */
+		int blockLayout;
+
+		/** @{ */
+		/** Scene parameters the snapshot was taken with. */
+		float voxelSize, mu;
+		int maxW, localBlockNum, hashBucketNum, excessListSize;
+		/** @} */
+
+		int noBlocks;
+		long long blockDataOffset;
+
+		static void GetMagic(char *magic, bool isLog) { memcpy(magic, isLog ? "ITMDELTA" : "ITMSCENE", 8); }
+
+		/** Sets the number of blocks and the aligned offset of their voxels behind the positions. */
+		void SetNoBlocks(int noBlocks)
+		{
+			long long positionsEnd = (long long)sizeof(ITMSceneSnapshotHeader) + (long long)noBlocks * sizeof(Vector3s);
+
+			this->noBlocks = noBlocks;
+			this->blockDataOffset = (positionsEnd + blockDataAlignment - 1) / blockDataAlignment * blockDataAlignment;
+		}
+	};
+
+	/** \brief
+	    Saves and loads scenes as a single snapshot file that only
+	    holds the allocated voxel blocks, so that the cost of both
+	    is proportional to the size of the scene rather than to the
+	    capacity of the scene.
+
+	    For checkpointing, the blocks modified or removed since the
+	    previous snapshot can instead be appended to a log next to
+	    it, see AppendToLog(), so that the cost of a checkpoint
+	    depends on the recent activity only. CompactFiles() merges
+	    the log back into the snapshot.
+
+	    Only scenes using ITMVoxelBlockHash in host memory are
+	    supported. Voxel blocks that have been swapped out to the
+	    global cache are not part of the snapshot.
+	*/
+	template<class TVoxel, class TIndex>
+	class ITMSceneSnapshot
+	{
+	public:
+		static void SaveToFile(ITMScene<TVoxel, TIndex> *scene, const std::string &fileName)
+		{
+			throw std::runtime_error("Scene snapshots are only supported for the voxel block hash");
+		}
+
+		static void LoadFromFile(ITMScene<TVoxel, TIndex> *scene, const std::string &fileName)
+		{
+			throw std::runtime_error("Scene snapshots are only supported for the voxel block hash");
+		}
+
+		static int AppendToLog(ITMScene<TVoxel, TIndex> *scene, const std::string &logFileName)
+		{
+			throw std::runtime_error("Scene snapshots are only supported for the voxel block hash");
+		}
+
+		static void CompactFiles(const std::string &fileName, const std::string &logFileName)
+		{
+			throw std::runtime_error("Scene snapshots are only supported for the voxel block hash");
+		}
+	};
+
+	template<class TVoxel>
+	class ITMSceneSnapshot<TVoxel, ITMVoxelBlockHash>
+	{
+	private:
+		static ITMSceneSnapshotHeader MakeHeader(const ITMSceneParams *sceneParams, int noBlocks, bool isLog = false)
+		{
+			ITMSceneSnapshotHeader header;
+			memset(&header, 0, sizeof(ITMSceneSnapshotHeader));
+
+			ITMSceneSnapshotHeader::GetMagic(header.magic, isLog);
+			header.version = ITMSceneSnapshotHeader::currentVersion;
+
+			header.voxelBytes = sizeof(TVoxel);
+			header.hasColorInformation = TVoxel::hasColorInformation;
+			header.hasConfidenceInformation = TVoxel::hasConfidenceInformation;
+			header.blockSize = SDF_BLOCK_SIZE;
+#ifdef USE_MORTON_VOXEL_ORDER
+			header.blockLayout = 1;
+#endif
+
+			header.voxelSize = sceneParams->voxelSize;
+			header.mu = sceneParams->mu;
+			header.maxW = sceneParams->maxW;
+			header.localBlockNum = sceneParams->localBlockNum;
+			header.hashBucketNum = sceneParams->hashBucketNum;
+			header.excessListSize = sceneParams->excessListSize;
+
+			header.SetNoBlocks(noBlocks);
+
+			return header;
+		}
+
+		/** Throws if @p header does not describe the same kind of file, voxel type and voxel size as @p expected. */
+		static void CheckHeader(const ITMSceneSnapshotHeader &header, const ITMSceneSnapshotHeader &expected, const std::string &fileName)
+		{
+			if (memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 || header.version != expected.version)
+				throw std::runtime_error(fileName + " is not a scene snapshot or checkpoint log");
+			if (header.voxelBytes != expected.voxelBytes || header.hasColorInformation != expected.hasColorInformation ||
+				header.hasConfidenceInformation != expected.hasConfidenceInformation || header.blockSize != expected.blockSize ||
+				header.blockLayout != expected.blockLayout)
+				throw std::runtime_error("The voxel type of " + fileName + " does not match");
+			if (header.voxelSize != expected.voxelSize || header.mu != expected.mu)
+				throw std::runtime_error("The voxel size or truncation band of " + fileName + " do not match");
+		}
+
+		static ITMSceneSnapshotHeader ReadHeader(std::istream &is, const std::string &fileName)
+		{
+			ITMSceneSnapshotHeader header;
+			if (!is.read((char*)&header, sizeof(ITMSceneSnapshotHeader))) throw std::runtime_error(fileName + " is not a scene snapshot or checkpoint log");
+			return header;
+		}
+
+		/** Writes a snapshot next to @p fileName first and then replaces it, so that a crash leaves either the old or the new one and mappings of the old one stay intact. */
+		static void WriteFile(const std::string &fileName, ITMSceneSnapshotHeader header, const std::vector<Vector3s> &blockPos,
+			const std::vector<const TVoxel*> &voxelBlocks)
+		{
+			std::string tempFileName = fileName + ".tmp";
+			std::ofstream ofs(tempFileName.c_str(), std::ios::binary);
+			if (!ofs) throw std::runtime_error("Could not open " + tempFileName + " for writing");
+
+			int noBlocks = (int)blockPos.size();
+			header.SetNoBlocks(noBlocks);
+			ofs.write((const char*)&header, sizeof(ITMSceneSnapshotHeader));
+
+			if (noBlocks > 0) ofs.write((const char*)&blockPos[0], noBlocks * sizeof(Vector3s));
+
+			std::vector<char> padding((size_t)(header.blockDataOffset - ofs.tellp()), 0);
+			if (!padding.empty()) ofs.write(&padding[0], padding.size());
+
+			for (int blockId = 0; blockId < noBlocks; blockId++)
+				ofs.write((const char*)voxelBlocks[blockId], SDF_BLOCK_SIZE3 * sizeof(TVoxel));
+
+			ofs.close();
+			if (!ofs) throw std::runtime_error("Could not write the scene snapshot " + tempFileName);
+
+			if (rename(tempFileName.c_str(), fileName.c_str()) != 0)
+			{
+				remove(fileName.c_str());
+				if (rename(tempFileName.c_str(), fileName.c_str()) != 0) throw std::runtime_error("Could not replace the scene snapshot " + fileName);
+			}
+		}
+
+		static long long PackBlockPos(const Vector3s &blockPos)
+		{
+			return ((long long)(unsigned short)blockPos.x << 32) | ((long long)(unsigned short)blockPos.y << 16) | (long long)(unsigned short)blockPos.z;
+		}
+
+		static void CheckScene(const ITMScene<TVoxel, ITMVoxelBlockHash> *scene)
+		{
+			if (scene->localVBA.GetMemoryType() != MEMORYDEVICE_CPU)
+				throw std::runtime_error("Scene snapshots are only supported for scenes in host memory");
+			// the files hold the voxel blocks only
+			if (TVoxel::hasSeparateColourInformation)
+				throw std::runtime_error("Scene snapshots are not supported for voxels with separate colour");
+		}
+
+	public:
+		/** Writes the voxel blocks held in the local voxel block array of @p scene to @p fileName, which becomes the base for later checkpoints. */
+		static void SaveToFile(ITMScene<TVoxel, ITMVoxelBlockHash> *scene, const std::string &fileName)
+		{
+			CheckScene(scene);
+
+			const ITMHashEntry *hashTable = scene->index.GetEntries();
+			const TVoxel *localVBA = scene->localVBA.GetVoxelBlocks();
+			const int *liveEntryIDs = scene->index.GetLiveEntryIDs();
+			int noBlocks = scene->index.GetNoLiveEntries();
+
+			std::vector<Vector3s> blockPos(noBlocks);
+			std::vector<const TVoxel*> voxelBlocks(noBlocks);
+			for (int blockId = 0; blockId < noBlocks; blockId++)
+			{
+				const ITMHashEntry &hashEntry = hashTable[liveEntryIDs[blockId]];
+				blockPos[blockId] = hashEntry.pos;
+				voxelBlocks[blockId] = localVBA + (size_t)hashEntry.ptr * SDF_BLOCK_SIZE3;
+			}
+
+			WriteFile(fileName, MakeHeader(scene->sceneParams, noBlocks), blockPos, voxelBlocks);
+
+			scene->index.SetCheckpointStamp(scene->index.TakeModificationStamp());
+		}
+
+		/** Adds an entry for the voxel block at @p blockPos, stored in block @p ptr, to the hash table of @p scene. Returns false if the table is full. */
+		static bool AddEntry(ITMScene<TVoxel, ITMVoxelBlockHash> *scene, const Vector3s &blockPos, int ptr)
+		{
+			ITMHashEntry *hashTable = scene->index.GetEntries();
+			int *excessAllocationList = scene->index.GetExcessAllocationList();
+			int noBuckets = scene->index.getNumBuckets();
+
+			int entryId = hashIndex(blockPos, getHashMask(hashTable));
+			if (hashTable[entryId].ptr >= -1)
+			{
+				//the bucket is taken, append an entry from the excess list to its chain
+				int lastFreeExcessListId = scene->index.GetLastFreeExcessListId();
+				if (lastFreeExcessListId < 0) return false;
+
+				while (hashTable[entryId].offset >= 1) entryId = noBuckets + hashTable[entryId].offset - 1;
+
+				int exlOffset = excessAllocationList[lastFreeExcessListId];
+				scene->index.SetLastFreeExcessListId(lastFreeExcessListId - 1);
+
+				hashTable[entryId].offset = exlOffset + 1;
+				entryId = noBuckets + exlOffset;
+			}
+
+			ITMHashEntry hashEntry;
+			hashEntry.pos = blockPos;
+			hashEntry.ptr = ptr;
+			hashEntry.offset = 0;
+
+			hashTable[entryId] = hashEntry;
+			scene->index.AddLiveEntry(entryId, ptr);
+
+			return true;
+		}
+
+		/** Adds the voxel block at @p blockPos to the hash table of @p scene and returns its voxels, or NULL if the table is full. */
+		static TVoxel *AllocateBlock(ITMScene<TVoxel, ITMVoxelBlockHash> *scene, const Vector3s &blockPos)
+		{
+			int *voxelAllocationList = scene->localVBA.GetAllocationList();
+
+			int lastFreeVoxelBlockId = scene->localVBA.lastFreeBlockId;
+			if (lastFreeVoxelBlockId < 0) lastFreeVoxelBlockId = scene->localVBA.Grow(lastFreeVoxelBlockId);
+			if (lastFreeVoxelBlockId < 0) return NULL;
+
+			int ptr = voxelAllocationList[lastFreeVoxelBlockId];
+			if (!AddEntry(scene, blockPos, ptr)) return NULL;
+			scene->localVBA.lastFreeBlockId = lastFreeVoxelBlockId - 1;
+
+			return scene->localVBA.GetVoxelBlocks() + (size_t)ptr * SDF_BLOCK_SIZE3;
+		}
+
+		/** \brief
+		    Adds the voxel blocks stored in @p fileName to @p scene,
+		    which has to have been reset before.
+
+		    If the local voxel block array is paged, the blocks are
+		    mapped from the file copy-on-write instead of being read,
+		    so that loading only costs the rebuild of the hash table
+		    and memory is copied for the blocks that are fused into
+		    later. The file may be replaced by a new snapshot while it
+		    is mapped, but must not be modified in place.
+		*/
+		static void LoadFromFile(ITMScene<TVoxel, ITMVoxelBlockHash> *scene, const std::string &fileName)
+		{
+			CheckScene(scene);
+
+			std::ifstream ifs(fileName.c_str(), std::ios::binary);
+			if (!ifs) throw std::runtime_error("Could not open " + fileName + " for reading");
+
+			ITMSceneSnapshotHeader header = ReadHeader(ifs, fileName);
+			CheckHeader(header, MakeHeader(scene->sceneParams, 0), fileName);
+			if (header.noBlocks < 0 || header.noBlocks > scene->sceneParams->localBlockNum)
+				throw std::runtime_error("The snapshot " + fileName + " holds more voxel blocks than the scene");
+
+			std::vector<Vector3s> blockPos(header.noBlocks);
+			if (header.noBlocks > 0) ifs.read((char*)&blockPos[0], header.noBlocks * sizeof(Vector3s));
+
+			// a mapping that reaches past the end of the file would fault on access, so the size is checked up front
+			ifs.seekg(0, std::ios::end);
+			if (!ifs || (long long)ifs.tellg() < header.blockDataOffset + (long long)((size_t)header.noBlocks * SDF_BLOCK_SIZE3 * sizeof(TVoxel)))
+				throw std::runtime_error("Could not read the scene snapshot " + fileName);
+
+			int firstBlockId = scene->localVBA.MapBlocks(fileName, (size_t)header.blockDataOffset, header.noBlocks);
+			if (firstBlockId >= 0)
+			{
+				for (int blockId = 0; blockId < header.noBlocks; blockId++)
+				{
+					if (!AddEntry(scene, blockPos[blockId], firstBlockId + blockId))
+						throw std::runtime_error("The hash table is too small for the snapshot " + fileName);
+				}
+
+				scene->index.ResetModificationStamps();
+				scene->index.SetCheckpointStamp(scene->index.TakeModificationStamp());
+				return;
+			}
+
+			ifs.seekg(header.blockDataOffset);
+			for (int blockId = 0; blockId < header.noBlocks && ifs; blockId++)
+			{
+				TVoxel *voxelBlock = AllocateBlock(scene, blockPos[blockId]);
+				if (voxelBlock == NULL) throw std::runtime_error("The hash table is too small for the snapshot " + fileName);
+
+				ifs.read((char*)voxelBlock, SDF_BLOCK_SIZE3 * sizeof(TVoxel));
+			}
+
+			if (!ifs) throw std::runtime_error("Could not read the scene snapshot " + fileName);
+
+			// the scene now matches the snapshot
+			scene->index.ResetModificationStamps();
+			scene->index.SetCheckpointStamp(scene->index.TakeModificationStamp());
+		}
+
+		/** \brief
+		    Appends the voxel blocks of @p scene that have been
+		    modified or removed since the last snapshot or
+		    checkpoint to the log @p logFileName, creating it if
+		    needed, and returns their number.
+
+		    The changes of one checkpoint are written as a group,
+		    the number of modified blocks followed by the position
+		    and voxels of each, then the number of removed blocks
+		    followed by their positions. Blocks swapped out to the
+		    global cache count as removed, as they are not part of
+		    a snapshot either. A group that has been cut short by a
+		    crash is ignored by CompactFiles(), which has to be
+		    called before appending to such a log again.
+
+		    Returns -1 and leaves the log untouched if the changes
+		    are no longer known, e.g. after the scene has been
+		    reset. A new snapshot has to be written with
+		    SaveToFile() then, which supersedes the log.
+		*/
+		static int AppendToLog(ITMScene<TVoxel, ITMVoxelBlockHash> *scene, const std::string &logFileName)
+		{
+			CheckScene(scene);
+
+			const ITMHashEntry *hashTable = scene->index.GetEntries();
+			const TVoxel *localVBA = scene->localVBA.GetVoxelBlocks();
+
+			std::vector<ITMBlockChange> changes;
+			if (!scene->index.GetChangedBlocks(scene->index.GetCheckpointStamp(), changes)) return -1;
+
+			// a block that has moved to another entry is listed as removed from the old one, so only positions without a live block are removed
+			std::vector<int> entryIds;
+			std::map<long long, Vector3s> removedBlocks;
+			for (size_t changeId = 0; changeId < changes.size(); changeId++)
+				if (changes[changeId].ptr < 0) removedBlocks[PackBlockPos(changes[changeId].pos)] = changes[changeId].pos;
+			for (size_t changeId = 0; changeId < changes.size(); changeId++)
+			{
+				if (changes[changeId].ptr < 0) continue;
+				entryIds.push_back(changes[changeId].entryId);
+				removedBlocks.erase(PackBlockPos(changes[changeId].pos));
+			}
+
+			bool isNewLog = !std::ifstream(logFileName.c_str()).good();
+			std::ofstream ofs(logFileName.c_str(), std::ios::binary | std::ios::app);
+			if (!ofs) throw std::runtime_error("Could not open " + logFileName + " for writing");
+
+			if (isNewLog)
+			{
+				ITMSceneSnapshotHeader header = MakeHeader(scene->sceneParams, 0, true);
+				ofs.write((const char*)&header, sizeof(ITMSceneSnapshotHeader));
+			}
+
+			int noBlocks = (int)entryIds.size();
+			ofs.write((const char*)&noBlocks, sizeof(int));
+			for (int i = 0; i < noBlocks; i++)
+			{
+				const ITMHashEntry &hashEntry = hashTable[entryIds[i]];
+				ofs.write((const char*)&hashEntry.pos, sizeof(Vector3s));
+				ofs.write((const char*)(localVBA + (size_t)hashEntry.ptr * SDF_BLOCK_SIZE3), SDF_BLOCK_SIZE3 * sizeof(TVoxel));
+			}
+
+			int noRemovedBlocks = (int)removedBlocks.size();
+			ofs.write((const char*)&noRemovedBlocks, sizeof(int));
+			for (std::map<long long, Vector3s>::const_iterator it = removedBlocks.begin(); it != removedBlocks.end(); ++it)
+				ofs.write((const char*)&it->second, sizeof(Vector3s));
+
+			ofs.flush();
+			if (!ofs) throw std::runtime_error("Could not append to the checkpoint log " + logFileName);
+
+			scene->index.SetCheckpointStamp(scene->index.TakeModificationStamp());
+			return noBlocks + noRemovedBlocks;
+		}
+
+		/** Applies the log @p logFileName to the snapshot @p fileName, which is replaced by the result, and removes the log. */
+		static void CompactFiles(const std::string &fileName, const std::string &logFileName)
+		{
+			std::ifstream ifs(fileName.c_str(), std::ios::binary);
+			if (!ifs) throw std::runtime_error("Could not open " + fileName + " for reading");
+
+			ITMSceneSnapshotHeader header = ReadHeader(ifs, fileName);
+			ITMSceneSnapshotHeader expected = header;
+			ITMSceneSnapshotHeader::GetMagic(expected.magic, false);
+			expected.version = ITMSceneSnapshotHeader::currentVersion;
+			CheckHeader(header, expected, fileName);
+
+			std::vector<Vector3s> blockPos(header.noBlocks);
+			std::vector<TVoxel> blockData((size_t)header.noBlocks * SDF_BLOCK_SIZE3);
+			if (header.noBlocks > 0)
+			{
+				ifs.read((char*)&blockPos[0], header.noBlocks * sizeof(Vector3s));
+				ifs.seekg(header.blockDataOffset);
+				ifs.read((char*)&blockData[0], blockData.size() * sizeof(TVoxel));
+			}
+			if (!ifs) throw std::runtime_error("Could not read the scene snapshot " + fileName);
+			ifs.close();
+
+			std::map<long long, int> blockIds;
+			for (int blockId = 0; blockId < header.noBlocks; blockId++) blockIds[PackBlockPos(blockPos[blockId])] = blockId;
+			std::vector<bool> isRemoved(blockPos.size(), false);
+
+			std::ifstream logIfs(logFileName.c_str(), std::ios::binary);
+			if (logIfs)
+			{
+				ITMSceneSnapshotHeader logHeader = ReadHeader(logIfs, logFileName);
+				ITMSceneSnapshotHeader::GetMagic(expected.magic, true);
+				CheckHeader(logHeader, expected, logFileName);
+
+				// the rest of the log bounds the size of a group, so that a corrupt count ends the log instead of allocating for it
+				long long groupsBegin = (long long)logIfs.tellg();
+				logIfs.seekg(0, std::ios::end);
+				long long logSize = (long long)logIfs.tellg();
+				logIfs.seekg(groupsBegin);
+				const long long blockRecordSize = (long long)(sizeof(Vector3s) + SDF_BLOCK_SIZE3 * sizeof(TVoxel));
+
+				int noBlocks;
+				while (logIfs.read((char*)&noBlocks, sizeof(int)) && noBlocks >= 0)
+				{
+					if ((long long)noBlocks * blockRecordSize > logSize - (long long)logIfs.tellg()) break;
+
+					std::vector<Vector3s> groupPos(noBlocks);
+					std::vector<TVoxel> groupData((size_t)noBlocks * SDF_BLOCK_SIZE3);
+
+					bool isComplete = true;
+					for (int blockId = 0; blockId < noBlocks && isComplete; blockId++)
+					{
+						isComplete = logIfs.read((char*)&groupPos[blockId], sizeof(Vector3s)) &&
+							logIfs.read((char*)&groupData[(size_t)blockId * SDF_BLOCK_SIZE3], SDF_BLOCK_SIZE3 * sizeof(TVoxel));
+					}
+
+					int noRemovedBlocks = 0;
+					isComplete = isComplete && logIfs.read((char*)&noRemovedBlocks, sizeof(int)) && noRemovedBlocks >= 0 &&
+						(long long)noRemovedBlocks * (long long)sizeof(Vector3s) <= logSize - (long long)logIfs.tellg();
+
+					std::vector<Vector3s> removedPos(isComplete ? noRemovedBlocks : 0);
+					if (noRemovedBlocks > 0 && isComplete) isComplete = (bool)logIfs.read((char*)&removedPos[0], noRemovedBlocks * sizeof(Vector3s));
+					if (!isComplete) break;
+
+					// later groups override the blocks of earlier ones
+					for (int blockId = 0; blockId < noBlocks; blockId++)
+					{
+						std::map<long long, int>::iterator it = blockIds.find(PackBlockPos(groupPos[blockId]));
+						int targetId;
+						if (it != blockIds.end()) targetId = it->second;
+						else
+						{
+							targetId = (int)blockPos.size();
+							blockIds[PackBlockPos(groupPos[blockId])] = targetId;
+							blockPos.push_back(groupPos[blockId]);
+							blockData.resize(blockData.size() + SDF_BLOCK_SIZE3);
+							isRemoved.push_back(false);
+						}
+
+						memcpy(&blockData[(size_t)targetId * SDF_BLOCK_SIZE3], &groupData[(size_t)blockId * SDF_BLOCK_SIZE3], SDF_BLOCK_SIZE3 * sizeof(TVoxel));
+						isRemoved[targetId] = false;
+					}
+
+					// a group never both writes and removes a block, so the order within it does not matter
+					for (int blockId = 0; blockId < noRemovedBlocks; blockId++)
+					{
+						std::map<long long, int>::iterator it = blockIds.find(PackBlockPos(removedPos[blockId]));
+						if (it != blockIds.end()) isRemoved[it->second] = true;
+					}
+				}
+				logIfs.close();
+			}
+
+			std::vector<Vector3s> keptBlockPos;
+			std::vector<const TVoxel*> voxelBlocks;
+			for (size_t blockId = 0; blockId < blockPos.size(); blockId++)
+			{
+				if (isRemoved[blockId]) continue;
+				keptBlockPos.push_back(blockPos[blockId]);
+				voxelBlocks.push_back(&blockData[blockId * SDF_BLOCK_SIZE3]);
+			}
+
+			WriteFile(fileName, header, keptBlockPos, voxelBlocks);
+			remove(logFileName.c_str());
+		}
+	};
+}
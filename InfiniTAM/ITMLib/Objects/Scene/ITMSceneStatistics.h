@@ -0,0 +1,173 @@
+// Copyright 2014-2017 Oxford University Innovation Limited and the authors of InfiniTAM
+
+#pragma once
+
+#include <string.h>
+#include <vector>
+
+#include "ITMRepresentationAccess.h"
+#include "ITMScene.h"
+
+namespace ITMLib
+{
+	/** \brief
+	    Fill state of the index and the local voxel block array of
+	    a scene. Once the local voxel block array or the excess list
+	    of the voxel block hash run out, new geometry is dropped, so
+	    these numbers tell how close a scene is to that point.
+	*/
+	struct ITMHashStatistics
+	{
+		/** @{ */
+		/** Buckets (slots for the probing hash) of the table, the ones holding an entry and the ratio of the two. */
+		int noBuckets, noOccupiedBuckets;
+		float bucketLoadFactor;
+		/** @} */
+
+		/** @{ */
+		/** Size of the excess list and the number of its entries in use, 0 for indices without one. */
+		int excessListSize, noUsedExcessEntries;
+		/** @} */
+
+		/** Longest chain of entries that share a bucket, or longest probe sequence for the probing hash. */
+		int longestChain;
+
+		/** @{ */
+		/** Size of the local voxel block array, the blocks in use and the entries whose block is swapped out. */
+		int noLocalBlocks, noUsedLocalBlocks, noSwappedOutBlocks;
+		/** @} */
+
+		/** @{ */
+		/** Allocation requests dropped in the last allocation pass and since the scene was reset. */
+		int noDroppedAllocations, noTotalDroppedAllocations;
+		/** @} */
+
+		/** Blocks visible in the last frame, filled in by the caller since it is part of the render state. */
+		int noVisibleBlocks;
+
+		/** Host memory held by the neighbour links of the voxel block hash, 0 if it keeps none. */
+		size_t neighbourLinkBytes;
+	};
+
+	/** \brief
+	    Computes ITMHashStatistics for a scene. The counters kept by
+	    the scene are read directly, the load factor and chain length
+	    need a pass over the whole table, which is copied to the host
+	    first for scenes on the GPU.
+	*/
+	template<class TVoxel, class TIndex>
+	class ITMSceneStatistics
+	{
+	public:
+		/** Fills in the statistics of the local voxel block array, the index has no hash table. */
+		static void Compute(const ITMScene<TVoxel, TIndex> *scene, ITMHashStatistics &stats)
+		{
+			memset(&stats, 0, sizeof(ITMHashStatistics));
+
+			stats.noLocalBlocks = scene->index.getNumAllocatedVoxelBlocks();
+			stats.noUsedLocalBlocks = stats.noLocalBlocks;
+		}
+	};
+
+	/** Returns the entries of @p hashTable, copied to @p hostEntries if the table is in device memory. */
+	template<class TEntry>
+	inline const TEntry *getHostHashEntries(const TEntry *hashTable, int noTotalEntries, MemoryDeviceType memoryType, std::vector<TEntry> &hostEntries)
+	{
+		if (memoryType != MEMORYDEVICE_CUDA) return hashTable;
+
+		hostEntries.resize(noTotalEntries);
+#ifndef COMPILE_WITHOUT_CUDA
+		ORcudaSafeCall(cudaMemcpy(&hostEntries[0], hashTable, noTotalEntries * sizeof(TEntry), cudaMemcpyDeviceToHost));
+#endif
+		return &hostEntries[0];
+	}
+
+	/** Fills in the statistics of the local voxel block array and the dropped allocations of a hash indexed scene. */
+	template<class TVoxel, class TIndex>
+	inline void computeLocalBlockStatistics(const ITMScene<TVoxel, TIndex> *scene, ITMHashStatistics &stats)
+	{
+		// uncommitted pages of a paged array count as free
+		stats.noLocalBlocks = scene->index.getNumAllocatedVoxelBlocks();
+		stats.noUsedLocalBlocks = scene->localVBA.GetNumCommittedBlocks() - scene->localVBA.lastFreeBlockId - 1;
+
+		stats.noDroppedAllocations = scene->index.GetNoDroppedAllocations();
+		stats.noTotalDroppedAllocations = scene->index.GetNoTotalDroppedAllocations();
+	}
+
+	template<class TVoxel>
+	class ITMSceneStatistics<TVoxel, ITMVoxelBlockHash>
+	{
+	public:
+		static void Compute(const ITMScene<TVoxel, ITMVoxelBlockHash> *scene, ITMHashStatistics &stats)
+		{
+			memset(&stats, 0, sizeof(ITMHashStatistics));
+			computeLocalBlockStatistics(scene, stats);
+
+			int noBuckets = scene->index.getNumBuckets();
+			int noTotalEntries = scene->index.noTotalEntries;
+
+			std::vector<ITMHashEntry> hostEntries;
+			const ITMHashEntry *hashTable = getHostHashEntries(scene->index.GetEntries(), noTotalEntries,
+				scene->localVBA.GetMemoryType(), hostEntries);
+
+			stats.noBuckets = noBuckets;
+			stats.excessListSize = scene->index.getExcessListSize();
+			stats.noUsedExcessEntries = stats.excessListSize - scene->index.GetLastFreeExcessListId() - 1;
+
+			for (int entryId = 0; entryId < noTotalEntries; entryId++)
+				if (hashTable[entryId].ptr == -1) stats.noSwappedOutBlocks++;
+
+			// free buckets never start a chain, see ITMHashEntry::ptr
+			for (int bucketId = 0; bucketId < noBuckets; bucketId++)
+			{
+				if (hashTable[bucketId].ptr < -1) continue;
+				stats.noOccupiedBuckets++;
+
+				int chainLength = 1;
+				for (int entryId = bucketId; hashTable[entryId].offset >= 1 && chainLength <= noTotalEntries; chainLength++)
+					entryId = noBuckets + hashTable[entryId].offset - 1;
+
+				stats.longestChain = MAX(stats.longestChain, chainLength);
+			}
+
+			stats.bucketLoadFactor = (float)stats.noOccupiedBuckets / (float)noBuckets;
+			stats.neighbourLinkBytes = scene->index.GetNeighbourLinksMemoryUsage();
+		}
+	};
+
+	template<class TVoxel>
+	class ITMSceneStatistics<TVoxel, ITMVoxelBlockProbingHash>
+	{
+	public:
+		static void Compute(const ITMScene<TVoxel, ITMVoxelBlockProbingHash> *scene, ITMHashStatistics &stats)
+		{
+			memset(&stats, 0, sizeof(ITMHashStatistics));
+			computeLocalBlockStatistics(scene, stats);
+
+			int noSlots = scene->index.noTotalEntries;
+
+			std::vector<ITMProbingHashEntry> hostEntries;
+			const ITMProbingHashEntry *hashTable = getHostHashEntries(scene->index.GetEntries(), noSlots,
+				scene->localVBA.GetMemoryType(), hostEntries);
+
+			stats.noBuckets = noSlots;
+
+			int hashMask = noSlots - 1;
+			for (int slotId = 0; slotId < noSlots; slotId++)
+			{
+				const ITMProbingHashEntry &hashEntry = hashTable[slotId];
+				if (hashEntry.key == PROBING_HASH_EMPTY_KEY) continue;
+
+				stats.noOccupiedBuckets++;
+				if (hashEntry.ptr == -1) stats.noSwappedOutBlocks++;
+
+				// a lookup probes every slot from the home slot of the block up to this one
+				int homeSlotId = hashIndex(unpackBlockKey(hashEntry.key), hashMask);
+				int probeLength = ((slotId - homeSlotId) & hashMask) + 1;
+				stats.longestChain = MAX(stats.longestChain, probeLength);
+			}
+
+			stats.bucketLoadFactor = (float)stats.noOccupiedBuckets / (float)noSlots;
+		}
+	};
+}
@@ -6,30 +6,24 @@
 #include <stdlib.h>
 #include <fstream>
 #include <iostream>
+#include <algorithm>
+#include <vector>
 #endif
 
 #include "../../Utils/ITMMath.h"
 #include "../../../ORUtils/MemoryBlock.h"
 #include "../../../ORUtils/MemoryBlockPersister.h"
+#include "../../Utils/ITMSceneParams.h"
 
 #define SDF_BLOCK_SIZE 8				// SDF block size
 #define SDF_BLOCK_SIZE3 512				// SDF_BLOCK_SIZE3 = SDF_BLOCK_SIZE * SDF_BLOCK_SIZE * SDF_BLOCK_SIZE
 
-#define SDF_LOCAL_BLOCK_NUM 0x40000		// Number of locally stored blocks, currently 2^17
-
-#define SDF_BUCKET_NUM 0x100000			// Number of Hash Bucket, should be 2^n and bigger than SDF_LOCAL_BLOCK_NUM, SDF_HASH_MASK = SDF_BUCKET_NUM - 1
-#define SDF_HASH_MASK 0xfffff			// Used for get hashing value of the bucket index,  SDF_HASH_MASK = SDF_BUCKET_NUM - 1
-#define SDF_EXCESS_LIST_SIZE 0x20000	// 0x20000 Size of excess list, used to handle collisions. Also max offset (unsigned short) value.
-
-//// for loop closure
-//#define SDF_LOCAL_BLOCK_NUM 0x10000		// Number of locally stored blocks, currently 2^12
-//
-//#define SDF_BUCKET_NUM 0x40000			// Number of Hash Bucket, should be 2^n and bigger than SDF_LOCAL_BLOCK_NUM, SDF_HASH_MASK = SDF_BUCKET_NUM - 1
-//#define SDF_HASH_MASK 0x3ffff			// Used for get hashing value of the bucket index,  SDF_HASH_MASK = SDF_BUCKET_NUM - 1
-//#define SDF_EXCESS_LIST_SIZE 0x8000		// 0x8000 Size of excess list, used to handle collisions. Also max offset (unsigned short) value.
-
 #define SDF_TRANSFER_BLOCK_NUM 0x1000	// Maximum number of blocks transfered in one swap operation
 
+template<typename T> _CPU_AND_GPU_CODE_ inline int hashIndex(const THREADPTR(T) & blockPos, int hashMask) {
+	return (((uint)blockPos.x * 73856093u) ^ ((uint)blockPos.y * 19349669u) ^ ((uint)blockPos.z * 83492791u)) & (uint)hashMask;
+}
+
 /** \brief
 	A single entry in the hash table.
 */
@@ -49,6 +43,21 @@ struct ITMHashEntry
 
 namespace ITMLib
 {
+	/** \brief
+	    A voxel block that has changed since a given
+	    modification stamp, see
+	    ITMVoxelBlockHash::GetChangedBlocks().
+	*/
+	struct ITMBlockChange
+	{
+		/** Position of the block. */
+		Vector3s pos;
+		/** Entry that holds or held the block. */
+		int entryId;
+		/** Current state of the block, the same as ITMHashEntry::ptr, -2 if it has been removed from the table. */
+		int ptr;
+	};
+
 	/** \brief
 	This is the central class for the voxel block hash
 	implementation. It contains all the data needed on the CPU
@@ -62,18 +71,35 @@ namespace ITMLib
 		struct IndexCache {
 			Vector3i blockPos;
 			int blockPtr;
+#ifndef __METALC__
+			/** Neighbour links of the table, see GetNeighbourLinks(), followed when a lookup leaves the cached block, or NULL. */
+			const int *neighbourLinks;
+			_CPU_AND_GPU_CODE_ IndexCache(void) : blockPos(0x7fffffff), blockPtr(-1), neighbourLinks(NULL) {}
+#else
 			_CPU_AND_GPU_CODE_ IndexCache(void) : blockPos(0x7fffffff), blockPtr(-1) {}
+#endif
 		};
 
-		/** Maximum number of total entries. */
-		static const CONSTPTR(int) noTotalEntries = SDF_BUCKET_NUM + SDF_EXCESS_LIST_SIZE;
 		static const CONSTPTR(int) voxelBlockSize = SDF_BLOCK_SIZE * SDF_BLOCK_SIZE * SDF_BLOCK_SIZE;
 
+		/** Neighbour links per voxel block, one for each block of the 3x3x3 cube around it, see GetNeighbourLinks(). */
+		static const CONSTPTR(int) noNeighbourLinks = 27;
+
 #ifndef __METALC__
+		/** Maximum number of total entries, i.e. the buckets followed by the excess list. */
+		const int noTotalEntries;
+
 	private:
 		int lastFreeExcessListId;
 
-		/** The actual data in the hash table. */
+		/** Number of hash buckets (a power of two), size of the excess list and number of locally stored voxel blocks. */
+		int noBuckets, excessListSize, noLocalBlocks;
+
+		/** The actual data in the hash table. The first element is a
+		header holding the bucket mask (in offset) and the number of
+		buckets (in ptr), so that device code can find them at
+		entry -1 of the table returned by GetEntries().
+		*/
 		ORUtils::MemoryBlock<ITMHashEntry> *hashEntries;
 
 		/** Identifies which entries of the overflow
@@ -83,28 +109,196 @@ namespace ITMLib
 		*/
 		ORUtils::MemoryBlock<int> *excessAllocationList;
 
+		/** Dense list of the entries that hold a local voxel
+		block, see GetLiveEntryIDs(), and the position of each
+		voxel block's entry in it. Only kept for scenes on the
+		CPU, NULL otherwise.
+		*/
+		ORUtils::MemoryBlock<int> *liveEntryIDs, *liveEntryPositions;
+		int noLiveEntries;
+
+		/** One record per change of an entry, appended with the
+		stamp that was current at the time, so that the log is
+		sorted by stamp.
+		*/
+		struct StampRecord
+		{
+			uint stamp;
+			int entryId;
+			Vector3s pos;
+		};
+
+		/** Log of the changes to the entries, see
+		GetChangedBlocks(), and the position of the latest
+		record of each entry in it, -1 if there is none. Only
+		kept for scenes on the CPU, NULL otherwise.
+		*/
+		std::vector<StampRecord> stampLog;
+		ORUtils::MemoryBlock<int> *lastStampRecords;
+
+		/** Stamp given to changes made now, changes made before the
+		lost stamp are no longer in the log and the stamp of the
+		last snapshot or checkpoint.
+		*/
+		uint currentStamp, lostStamp, checkpointStamp;
+
+		/** Keeps only the latest record of each entry. A record
+		that is dropped although its entry has since been given
+		another block cannot be recovered from the latest one,
+		so queries from before it are answered as lost.
+		*/
+		void CompactStampLog(void)
+		{
+			int *lastStampRecords_ptr = lastStampRecords->GetData(MEMORYDEVICE_CPU);
+
+			size_t noKeptRecords = 0;
+			for (size_t recordId = 0; recordId < stampLog.size(); recordId++)
+			{
+				const StampRecord &record = stampLog[recordId];
+				int &lastRecordId = lastStampRecords_ptr[record.entryId];
+
+				if ((size_t)lastRecordId == recordId)
+				{
+					lastRecordId = (int)noKeptRecords;
+					stampLog[noKeptRecords++] = record;
+				}
+				else if (stampLog[lastRecordId].pos != record.pos) lostStamp = std::max(lostStamp, record.stamp);
+			}
+			stampLog.resize(noKeptRecords);
+		}
+
+		int noDroppedAllocations, noTotalDroppedAllocations;
+
+		/** Links to the neighbours of each local voxel block, see
+		GetNeighbourLinks(), and a flag per block telling whether
+		its links have been built. Only kept for scenes on the CPU
+		with ITMSceneParams::useNeighbourBlockLinks, NULL otherwise.
+		*/
+		ORUtils::MemoryBlock<int> *neighbourLinks;
+		ORUtils::MemoryBlock<uchar> *neighbourLinksBuilt;
+
+		/** Live blocks whose links have been built, the links are complete if that is all of them. */
+		int noLinkedBlocks;
+
+		/** Entry holding the local voxel block at @p blockPos, -1 if the block is swapped out or not in the table. */
+		int FindLocalEntry(const Vector3i &blockPos) const
+		{
+			const ITMHashEntry *hashTable = GetEntries();
+			int entryId = hashIndex(blockPos, noBuckets - 1);
+
+			while (true)
+			{
+				const ITMHashEntry &hashEntry = hashTable[entryId];
+				if (IS_EQUAL3(hashEntry.pos, blockPos) && hashEntry.ptr >= 0) return entryId;
+
+				if (hashEntry.offset < 1) return -1;
+				entryId = noBuckets + hashEntry.offset - 1;
+			}
+		}
+
+		/** Removes the links of the neighbours to the voxel block @p blockPtr, which is about to be released. */
+		void UnlinkNeighbourBlocks(int blockPtr)
+		{
+			uchar *neighbourLinksBuilt_ptr = neighbourLinksBuilt->GetData(MEMORYDEVICE_CPU);
+
+			// no neighbour links to a block that has been added since the links were last built
+			if (!neighbourLinksBuilt_ptr[blockPtr]) return;
+			neighbourLinksBuilt_ptr[blockPtr] = 0;
+			noLinkedBlocks--;
+
+			const ITMHashEntry *hashTable = GetEntries();
+			int *neighbourLinks_ptr = neighbourLinks->GetData(MEMORYDEVICE_CPU);
+			const int *blockLinks = neighbourLinks_ptr + blockPtr * noNeighbourLinks;
+
+			for (int linkId = 0; linkId < noNeighbourLinks; linkId++)
+			{
+				if (blockLinks[linkId] < 0) continue;
+
+				// the opposite link of the neighbour points back to the block
+				int neighbourPtr = hashTable[blockLinks[linkId]].ptr;
+				if (neighbourPtr >= 0 && neighbourLinksBuilt_ptr[neighbourPtr])
+					neighbourLinks_ptr[neighbourPtr * noNeighbourLinks + noNeighbourLinks - 1 - linkId] = -1;
+			}
+		}
+
 		MemoryDeviceType memoryType;
 
+		void WriteHeader(void)
+		{
+			ITMHashEntry header;
+			header.pos = Vector3s((short)0, (short)0, (short)0);
+			header.offset = noBuckets - 1;
+			header.ptr = noBuckets;
+
+			if (memoryType == MEMORYDEVICE_CUDA)
+			{
+#ifndef COMPILE_WITHOUT_CUDA
+				ORcudaSafeCall(cudaMemcpy(hashEntries->GetData(MEMORYDEVICE_CUDA), &header, sizeof(ITMHashEntry), cudaMemcpyHostToDevice));
+#endif
+			}
+			else hashEntries->GetData(MEMORYDEVICE_CPU)[0] = header;
+		}
+
 	public:
-		ITMVoxelBlockHash(MemoryDeviceType memoryType)
+		ITMVoxelBlockHash(const ITMSceneParams *sceneParams, MemoryDeviceType memoryType)
+			: noTotalEntries(getNumEntries(sceneParams))
 		{
+			if (sceneParams->hashBucketNum <= 0 || (sceneParams->hashBucketNum & (sceneParams->hashBucketNum - 1)) != 0)
+				throw std::runtime_error("The number of hash buckets must be a power of two");
+			if (sceneParams->hashBucketNum <= sceneParams->localBlockNum)
+				throw std::runtime_error("The number of hash buckets must be larger than the number of local voxel blocks");
+
 			this->memoryType = memoryType;
-			hashEntries = new ORUtils::MemoryBlock<ITMHashEntry>(noTotalEntries, memoryType);
-			excessAllocationList = new ORUtils::MemoryBlock<int>(SDF_EXCESS_LIST_SIZE, memoryType);
+			this->noBuckets = sceneParams->hashBucketNum;
+			this->excessListSize = sceneParams->excessListSize;
+			this->noLocalBlocks = sceneParams->localBlockNum;
+
+			hashEntries = new ORUtils::MemoryBlock<ITMHashEntry>(noTotalEntries + 1, memoryType);
+			excessAllocationList = new ORUtils::MemoryBlock<int>(excessListSize, memoryType);
+			WriteHeader();
+
+			liveEntryIDs = liveEntryPositions = NULL;
+			lastStampRecords = NULL;
+			neighbourLinks = NULL; neighbourLinksBuilt = NULL;
+			if (memoryType == MEMORYDEVICE_CPU)
+			{
+				liveEntryIDs = new ORUtils::MemoryBlock<int>(noLocalBlocks, MEMORYDEVICE_CPU);
+				liveEntryPositions = new ORUtils::MemoryBlock<int>(noLocalBlocks, MEMORYDEVICE_CPU);
+
+				lastStampRecords = new ORUtils::MemoryBlock<int>(noTotalEntries, MEMORYDEVICE_CPU);
+
+				if (sceneParams->useNeighbourBlockLinks)
+				{
+					neighbourLinks = new ORUtils::MemoryBlock<int>((size_t)noLocalBlocks * noNeighbourLinks, MEMORYDEVICE_CPU);
+					neighbourLinksBuilt = new ORUtils::MemoryBlock<uchar>(noLocalBlocks, MEMORYDEVICE_CPU);
+				}
+			}
+			noLiveEntries = 0;
+			ResetNeighbourLinks();
+
+			currentStamp = 1;
+			lostStamp = checkpointStamp = 0;
+			ResetModificationStamps();
+			ResetDroppedAllocations();
 		}
 
 		~ITMVoxelBlockHash(void)
 		{
 			delete hashEntries;
 			delete excessAllocationList;
+			delete liveEntryIDs;
+			delete liveEntryPositions;
+			delete lastStampRecords;
+			delete neighbourLinks;
+			delete neighbourLinksBuilt;
 		}
 
 		/** Get the list of actual entries in the hash table. */
-		const ITMHashEntry *GetEntries(void) const { return hashEntries->GetData(memoryType); }
-		ITMHashEntry *GetEntries(void) { return hashEntries->GetData(memoryType); }
+		const ITMHashEntry *GetEntries(void) const { return hashEntries->GetData(memoryType) + 1; }
+		ITMHashEntry *GetEntries(void) { return hashEntries->GetData(memoryType) + 1; }
 
-		const IndexData *getIndexData(void) const { return hashEntries->GetData(memoryType); }
-		IndexData *getIndexData(void) { return hashEntries->GetData(memoryType); }
+		const IndexData *getIndexData(void) const { return hashEntries->GetData(memoryType) + 1; }
+		IndexData *getIndexData(void) { return hashEntries->GetData(memoryType) + 1; }
 
 		/** Get the list that identifies which entries of the
 		overflow list are allocated. This is used if too
@@ -113,18 +307,254 @@ namespace ITMLib
 		const int *GetExcessAllocationList(void) const { return excessAllocationList->GetData(memoryType); }
 		int *GetExcessAllocationList(void) { return excessAllocationList->GetData(memoryType); }
 
-		int GetLastFreeExcessListId(void) { return lastFreeExcessListId; }
+		int GetLastFreeExcessListId(void) const { return lastFreeExcessListId; }
 		void SetLastFreeExcessListId(int lastFreeExcessListId) { this->lastFreeExcessListId = lastFreeExcessListId; }
 
+		/** Allocation requests dropped in the last allocation pass and since the last reset, because the local voxel block array or the excess list was full. Only counted by the CPU engines. */
+		int GetNoDroppedAllocations(void) const { return noDroppedAllocations; }
+		int GetNoTotalDroppedAllocations(void) const { return noTotalDroppedAllocations; }
+
+		/** Called by the allocating engines after each allocation pass. */
+		void AddDroppedAllocations(int noDroppedAllocations)
+		{
+			this->noDroppedAllocations = noDroppedAllocations;
+			noTotalDroppedAllocations += noDroppedAllocations;
+		}
+
+		void ResetDroppedAllocations(void) { noDroppedAllocations = noTotalDroppedAllocations = 0; }
+
+		/** Get the list of entries that hold a block of the
+		local voxel block array (ptr >= 0), in no particular
+		order. The CPU engines keep it up to date as blocks are
+		allocated, swapped out or deleted, so that passes over
+		the whole scene only need to visit these entries
+		instead of the whole table. Not available for scenes on
+		the GPU.
+		*/
+		const int *GetLiveEntryIDs(void) const { return liveEntryIDs->GetData(MEMORYDEVICE_CPU); }
+		int *GetLiveEntryIDs(void) { return liveEntryIDs->GetData(MEMORYDEVICE_CPU); }
+
+		int GetNoLiveEntries(void) const { return noLiveEntries; }
+		void SetNoLiveEntries(int noLiveEntries) { this->noLiveEntries = noLiveEntries; }
+
+		/** Stores @p entryId, which holds the voxel block @p blockPtr, at position @p listPos of the live list. */
+		void SetLiveEntry(int listPos, int entryId, int blockPtr)
+		{
+			liveEntryIDs->GetData(MEMORYDEVICE_CPU)[listPos] = entryId;
+			liveEntryPositions->GetData(MEMORYDEVICE_CPU)[blockPtr] = listPos;
+		}
+
+		/** Appends @p entryId after it has been given the voxel block @p blockPtr. */
+		void AddLiveEntry(int entryId, int blockPtr) { SetLiveEntry(noLiveEntries++, entryId, blockPtr); }
+
+		/** Removes the entry holding the voxel block @p blockPtr, before that block is released. The last entry of the list takes its place. */
+		void RemoveLiveEntry(int blockPtr)
+		{
+			if (neighbourLinks != NULL) UnlinkNeighbourBlocks(blockPtr);
+
+			int listPos = liveEntryPositions->GetData(MEMORYDEVICE_CPU)[blockPtr];
+			int lastEntryId = liveEntryIDs->GetData(MEMORYDEVICE_CPU)[--noLiveEntries];
+			SetLiveEntry(listPos, lastEntryId, GetEntries()[lastEntryId].ptr);
+		}
+
+		/** Rebuilds the live list from the table, e.g. after it has been loaded. */
+		void RebuildLiveEntries(void)
+		{
+			noLiveEntries = 0;
+			ResetNeighbourLinks();
+			if (liveEntryIDs == NULL) return;
+
+			const ITMHashEntry *hashTable = GetEntries();
+			for (int entryId = 0; entryId < noTotalEntries; entryId++)
+				if (hashTable[entryId].ptr >= 0) AddLiveEntry(entryId, hashTable[entryId].ptr);
+		}
+
+		/** \brief
+		    Neighbour links let passes that read across the borders
+		    of voxel blocks, like raycasting and meshing on the CPU,
+		    find the neighbours of a block by an array index instead
+		    of a hash lookup. Each local voxel block @p blockPtr has
+		    noNeighbourLinks links starting at blockPtr *
+		    noNeighbourLinks, one per block of the 3x3x3 cube around
+		    it with x running fastest, so that the block itself is
+		    in the middle. A link holds the entry of the neighbour,
+		    or -1 if the neighbour is not in the local voxel block
+		    array. Readers follow them through IndexCache.
+
+		    The links of a block are removed from its neighbours as
+		    soon as it is swapped out or freed. The links of newly
+		    allocated blocks are built by BuildNeighbourLinks(),
+		    which costs a hash lookup per neighbour once instead of
+		    on every read. Returns NULL if the links are not kept,
+		    see ITMSceneParams::useNeighbourBlockLinks, or if blocks
+		    have been allocated since they were last built.
+		*/
+		const int *GetNeighbourLinks(void) const
+		{
+			if (neighbourLinks == NULL || noLinkedBlocks != noLiveEntries) return NULL;
+			return neighbourLinks->GetData(MEMORYDEVICE_CPU);
+		}
+
+		/** Builds the links of the blocks allocated since the last call, see GetNeighbourLinks(). Called once per frame by ITMDenseMapper. */
+		void BuildNeighbourLinks(void)
+		{
+			if (neighbourLinks == NULL || noLinkedBlocks == noLiveEntries) return;
+
+			const ITMHashEntry *hashTable = GetEntries();
+			const int *liveEntryIDs_ptr = liveEntryIDs->GetData(MEMORYDEVICE_CPU);
+			int *neighbourLinks_ptr = neighbourLinks->GetData(MEMORYDEVICE_CPU);
+			uchar *neighbourLinksBuilt_ptr = neighbourLinksBuilt->GetData(MEMORYDEVICE_CPU);
+
+			for (int liveId = 0; liveId < noLiveEntries; liveId++)
+			{
+				int entryId = liveEntryIDs_ptr[liveId];
+				const ITMHashEntry &hashEntry = hashTable[entryId];
+				if (neighbourLinksBuilt_ptr[hashEntry.ptr]) continue;
+
+				int *blockLinks = neighbourLinks_ptr + hashEntry.ptr * noNeighbourLinks;
+				for (int linkId = 0; linkId < noNeighbourLinks; linkId++)
+				{
+					Vector3i offset(linkId % 3 - 1, (linkId / 3) % 3 - 1, linkId / 9 - 1);
+					int neighbourId = FindLocalEntry(hashEntry.pos.toInt() + offset);
+					blockLinks[linkId] = neighbourId;
+
+					// neighbours whose links are built already learn about the new block, the others find it when theirs are built
+					if (neighbourId < 0) continue;
+					int neighbourPtr = hashTable[neighbourId].ptr;
+					if (neighbourLinksBuilt_ptr[neighbourPtr])
+						neighbourLinks_ptr[neighbourPtr * noNeighbourLinks + noNeighbourLinks - 1 - linkId] = entryId;
+				}
+
+				neighbourLinksBuilt_ptr[hashEntry.ptr] = 1;
+				noLinkedBlocks++;
+			}
+		}
+
+		/** Forgets all neighbour links, called when the whole table has been replaced. */
+		void ResetNeighbourLinks(void)
+		{
+			if (neighbourLinksBuilt != NULL) neighbourLinksBuilt->Clear();
+			noLinkedBlocks = 0;
+		}
+
+		/** Memory taken by the neighbour links, zero if they are not kept. */
+		size_t GetNeighbourLinksMemoryUsage(void) const
+		{
+			if (neighbourLinks == NULL) return 0;
+			return neighbourLinks->dataSize * sizeof(int) + neighbourLinksBuilt->dataSize * sizeof(uchar);
+		}
+
+		/** \brief
+		    Modification stamps let consumers of the scene, like
+		    meshing, checkpoints or caches of rendered views, find
+		    the blocks that have changed since they last looked.
+
+		    A consumer takes a stamp with TakeModificationStamp()
+		    once it has caught up with the scene, and later passes
+		    it to GetChangedBlocks(). The CPU engines stamp the
+		    entries whose block they integrate into, swap in or
+		    out, or free as garbage. Not available for scenes on
+		    the GPU.
+		*/
+		uint TakeModificationStamp(void) { return currentStamp++; }
+
+		/** Records a change of the block held by @p entryId. Has to be called before the entry is cleared, as its position is recorded. */
+		void StampEntry(int entryId)
+		{
+			Vector3s pos = GetEntries()[entryId].pos;
+			int &lastRecordId = lastStampRecords->GetData(MEMORYDEVICE_CPU)[entryId];
+
+			// a change since the last stamp was taken is only recorded once
+			if (lastRecordId >= 0 && stampLog[lastRecordId].stamp == currentStamp && stampLog[lastRecordId].pos == pos) return;
+
+			if (stampLog.size() >= 2 * (size_t)noTotalEntries)
+			{
+				CompactStampLog();
+				if (lastRecordId >= 0 && stampLog[lastRecordId].stamp == currentStamp && stampLog[lastRecordId].pos == pos) return;
+			}
+
+			StampRecord record = { currentStamp, entryId, pos };
+			lastRecordId = (int)stampLog.size();
+			stampLog.push_back(record);
+		}
+
+		/** \brief
+		    Fills @p changes with the blocks that have changed
+		    since @p sinceStamp was taken, in the order of their
+		    latest change. A position is listed twice if its block
+		    has moved to another entry, so the changes have to be
+		    applied in order.
+
+		    Returns false if the changes are no longer known,
+		    because the scene has been reset or loaded or the log
+		    has been compacted since. The consumer then has to
+		    process the whole scene.
+		*/
+		bool GetChangedBlocks(uint sinceStamp, std::vector<ITMBlockChange> &changes) const
+		{
+			changes.clear();
+			if (sinceStamp < lostStamp) return false;
+
+			const ITMHashEntry *hashTable = GetEntries();
+			const int *lastStampRecords_ptr = lastStampRecords->GetData(MEMORYDEVICE_CPU);
+
+			size_t firstRecordId = 0, endRecordId = stampLog.size();
+			while (firstRecordId < endRecordId)
+			{
+				size_t recordId = (firstRecordId + endRecordId) / 2;
+				if (stampLog[recordId].stamp <= sinceStamp) firstRecordId = recordId + 1;
+				else endRecordId = recordId;
+			}
+
+			for (size_t recordId = firstRecordId; recordId < stampLog.size(); recordId++)
+			{
+				const StampRecord &record = stampLog[recordId];
+				int lastRecordId = lastStampRecords_ptr[record.entryId];
+
+				// earlier records of the same block are covered by the latest one
+				bool isLatest = (size_t)lastRecordId == recordId;
+				if (!isLatest && stampLog[lastRecordId].pos == record.pos) continue;
+
+				const ITMHashEntry &hashEntry = hashTable[record.entryId];
+				bool isPresent = isLatest && hashEntry.pos == record.pos && hashEntry.ptr >= -1;
+
+				ITMBlockChange change = { record.pos, record.entryId, isPresent ? hashEntry.ptr : -2 };
+				changes.push_back(change);
+			}
+
+			return true;
+		}
+
+		/** Forgets all changes, called when the whole table has been replaced. Queries from before are answered as lost. */
+		void ResetModificationStamps(void)
+		{
+			lostStamp = currentStamp;
+			stampLog.clear();
+			if (lastStampRecords != NULL) lastStampRecords->Clear(0xff);
+		}
+
+		/** Stamp taken by the last snapshot or checkpoint of the scene, see ITMSceneSnapshot. */
+		uint GetCheckpointStamp(void) const { return checkpointStamp; }
+		void SetCheckpointStamp(uint checkpointStamp) { this->checkpointStamp = checkpointStamp; }
+
 #ifdef COMPILE_WITH_METAL
+		// the hash table starts one entry into these buffers, see hashEntries
 		const void* GetEntries_MB(void) { return hashEntries->GetMetalBuffer(); }
 		const void* GetExcessAllocationList_MB(void) { return excessAllocationList->GetMetalBuffer(); }
 		const void* getIndexData_MB(void) const { return hashEntries->GetMetalBuffer(); }
 #endif
 
+		/** Number of entries, i.e. buckets and excess list, of a table built from @p sceneParams. */
+		static int getNumEntries(const ITMSceneParams *sceneParams) { return sceneParams->hashBucketNum + sceneParams->excessListSize; }
+
+		/** Number of hash buckets, the excess list starts at this entry. */
+		int getNumBuckets(void) const { return noBuckets; }
+		/** Size of the excess list. */
+		int getExcessListSize(void) const { return excessListSize; }
+
 		/** Maximum number of total entries. */
-		int getNumAllocatedVoxelBlocks(void) { return SDF_LOCAL_BLOCK_NUM; }
-		int getVoxelBlockSize(void) { return SDF_BLOCK_SIZE3; }
+		int getNumAllocatedVoxelBlocks(void) const { return noLocalBlocks; }
+		int getVoxelBlockSize(void) const { return SDF_BLOCK_SIZE3; }
 		/**
 		 * @brief 在k键后调用，保存体素
 		 * @param {type} 
@@ -157,6 +587,13 @@ namespace ITMLib
 			ifs >> this->lastFreeExcessListId;
 			ORUtils::MemoryBlockPersister::LoadMemoryBlock(hashEntriesFileName.c_str(), *hashEntries, memoryType);
 			ORUtils::MemoryBlockPersister::LoadMemoryBlock(excessAllocationListFileName.c_str(), *excessAllocationList, memoryType);
+
+			if (hashEntries->dataSize != (size_t)noTotalEntries + 1 || excessAllocationList->dataSize != (size_t)excessListSize)
+				throw std::runtime_error("The hash table in " + inputDirectory + " does not match the configured hash size");
+			WriteHeader();
+			RebuildLiveEntries();
+			ResetModificationStamps();
+			checkpointStamp = TakeModificationStamp();
 		}
 
 		// Suppress the default copy constructor and assignment operator
@@ -0,0 +1,161 @@
+// Copyright 2014-2017 Oxford University Innovation Limited and the authors of InfiniTAM
+
+#pragma once
+
+#ifndef __METALC__
+#include <stdlib.h>
+#include <fstream>
+#include <iostream>
+#endif
+
+#include "ITMVoxelBlockHash.h"
+
+/** Key of a free slot, packed block positions never set the upper 16 bits. */
+#define PROBING_HASH_EMPTY_KEY 0xffffffffffffffffull
+
+/** \brief
+	A single slot in the open addressing hash table.
+*/
+struct ITMProbingHashEntry
+{
+	/** Position of the corner of the 8x8x8 volume, packed into a
+		single word by packBlockKey(), or PROBING_HASH_EMPTY_KEY for a
+		free slot. A probe compares one word per slot.
+	*/
+	unsigned long long key;
+	/** Pointer to the voxel block array, see ITMHashEntry::ptr. */
+	int ptr;
+	/** Unused, keeps the slots 16 byte aligned. */
+	int padding;
+};
+
+namespace ITMLib
+{
+	/** \brief
+	Voxel block hash using open addressing with linear probing
+	instead of buckets and an excess list. Colliding blocks are
+	stored in the next free slot, so a lookup walks consecutive
+	slots rather than following offsets into the excess list.
+	Slots are never freed, so a probe can stop at the first free
+	slot. The number of slots is sceneParams->hashBucketNum and
+	should be a few times larger than localBlockNum to keep the
+	probe sequences short.
+
+	Only the CPU engines support this index, and it does not
+	support swapping.
+	*/
+	class ITMVoxelBlockProbingHash
+	{
+	public:
+		typedef ITMProbingHashEntry IndexData;
+
+		struct IndexCache {
+			Vector3i blockPos;
+			int blockPtr;
+			_CPU_AND_GPU_CODE_ IndexCache(void) : blockPos(0x7fffffff), blockPtr(-1) {}
+		};
+
+		static const CONSTPTR(int) voxelBlockSize = SDF_BLOCK_SIZE * SDF_BLOCK_SIZE * SDF_BLOCK_SIZE;
+
+#ifndef __METALC__
+		/** Number of slots in the table. */
+		const int noTotalEntries;
+
+	private:
+		int noLocalBlocks;
+
+		/** The actual data in the hash table. As for
+		ITMVoxelBlockHash, the first element is a header holding the
+		slot mask (in key) and the number of slots (in ptr).
+		*/
+		ORUtils::MemoryBlock<ITMProbingHashEntry> *hashEntries;
+
+		int noDroppedAllocations, noTotalDroppedAllocations;
+
+		MemoryDeviceType memoryType;
+
+		void WriteHeader(void)
+		{
+			ITMProbingHashEntry header;
+			header.key = (unsigned long long)(noTotalEntries - 1);
+			header.ptr = noTotalEntries;
+			header.padding = 0;
+
+			hashEntries->GetData(MEMORYDEVICE_CPU)[0] = header;
+		}
+
+	public:
+		ITMVoxelBlockProbingHash(const ITMSceneParams *sceneParams, MemoryDeviceType memoryType)
+			: noTotalEntries(getNumEntries(sceneParams))
+		{
+			if (sceneParams->hashBucketNum <= 0 || (sceneParams->hashBucketNum & (sceneParams->hashBucketNum - 1)) != 0)
+				throw std::runtime_error("The number of hash buckets must be a power of two");
+			if (sceneParams->hashBucketNum <= sceneParams->localBlockNum)
+				throw std::runtime_error("The number of hash buckets must be larger than the number of local voxel blocks");
+			if (memoryType != MEMORYDEVICE_CPU)
+				throw std::runtime_error("The probing voxel block hash is only supported on the CPU");
+
+			this->memoryType = memoryType;
+			this->noLocalBlocks = sceneParams->localBlockNum;
+
+			hashEntries = new ORUtils::MemoryBlock<ITMProbingHashEntry>(noTotalEntries + 1, memoryType);
+			WriteHeader();
+			ResetDroppedAllocations();
+		}
+
+		~ITMVoxelBlockProbingHash(void)
+		{
+			delete hashEntries;
+		}
+
+		/** Get the list of actual entries in the hash table. */
+		const ITMProbingHashEntry *GetEntries(void) const { return hashEntries->GetData(memoryType) + 1; }
+		ITMProbingHashEntry *GetEntries(void) { return hashEntries->GetData(memoryType) + 1; }
+
+		const IndexData *getIndexData(void) const { return hashEntries->GetData(memoryType) + 1; }
+		IndexData *getIndexData(void) { return hashEntries->GetData(memoryType) + 1; }
+
+		/** Allocation requests dropped in the last allocation pass and since the last reset, because the local voxel block array was full. */
+		int GetNoDroppedAllocations(void) const { return noDroppedAllocations; }
+		int GetNoTotalDroppedAllocations(void) const { return noTotalDroppedAllocations; }
+
+		/** Called by the allocating engine after each allocation pass. */
+		void AddDroppedAllocations(int noDroppedAllocations)
+		{
+			this->noDroppedAllocations = noDroppedAllocations;
+			noTotalDroppedAllocations += noDroppedAllocations;
+		}
+
+		void ResetDroppedAllocations(void) { noDroppedAllocations = noTotalDroppedAllocations = 0; }
+
+		/** Number of slots of a table built from @p sceneParams. */
+		static int getNumEntries(const ITMSceneParams *sceneParams) { return sceneParams->hashBucketNum; }
+
+		/** Maximum number of total entries. */
+		int getNumAllocatedVoxelBlocks(void) const { return noLocalBlocks; }
+		int getVoxelBlockSize(void) const { return SDF_BLOCK_SIZE3; }
+
+		void SaveToDirectory(const std::string &outputDirectory) const
+		{
+			std::string hashEntriesFileName = outputDirectory + "hash.dat";
+
+			ORUtils::MemoryBlockPersister::SaveMemoryBlock(hashEntriesFileName, *hashEntries, memoryType);
+		}
+
+		void LoadFromDirectory(const std::string &inputDirectory)
+		{
+			std::string hashEntriesFileName = inputDirectory + "hash.dat";
+
+			ORUtils::MemoryBlockPersister::LoadMemoryBlock(hashEntriesFileName.c_str(), *hashEntries, memoryType);
+
+			if (hashEntries->dataSize != (size_t)noTotalEntries + 1)
+				throw std::runtime_error("The hash table in " + inputDirectory + " does not match the configured hash size");
+			WriteHeader();
+		}
+
+		// Suppress the default copy constructor and assignment operator
+		ITMVoxelBlockProbingHash(const ITMVoxelBlockProbingHash&);
+		ITMVoxelBlockProbingHash& operator=(const ITMVoxelBlockProbingHash&);
+#endif
+	};
+}
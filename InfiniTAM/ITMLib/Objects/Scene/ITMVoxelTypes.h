@@ -4,6 +4,73 @@
 
 #include "../../Utils/ITMMath.h"
 
+#if defined(__F16C__) && !defined(__CUDACC__) && !defined(COMPILE_WITHOUT_SIMD)
+#include <immintrin.h>
+#define ITM_HALF_F16C
+#endif
+
+/** \brief
+    IEEE 754 half precision number, converted to and from float
+    implicitly so that voxel types can store their sdf in it.
+    Conversions round to nearest and use the F16C instructions
+    where they are available.
+*/
+struct ITMHalf
+{
+	ushort bits;
+
+	_CPU_AND_GPU_CODE_ ITMHalf() {}
+	_CPU_AND_GPU_CODE_ ITMHalf(float x) { bits = fromFloat(x); }
+	_CPU_AND_GPU_CODE_ operator float() const { return toFloat(bits); }
+
+	_CPU_AND_GPU_CODE_ static ushort fromFloat(float x)
+	{
+#ifdef ITM_HALF_F16C
+		return (ushort)_cvtss_sh(x, _MM_FROUND_TO_NEAREST_INT);
+#else
+		union { float f; uint u; } value;
+		value.f = x;
+
+		uint sign = (value.u >> 16) & 0x8000, absBits = value.u & 0x7fffffff;
+
+		// too large for a half, infinite or not a number
+		if (absBits >= 0x477ff000) return (ushort)(sign | (absBits > 0x7f800000 ? 0x7e00 : 0x7c00));
+
+		// subnormal halves are multiples of 2^-24, the spacing of floats in [0.5, 1), so the addition rounds them
+		if (absBits < 0x38800000)
+		{
+			value.u = absBits;
+			value.f += 0.5f;
+			return (ushort)(sign | (value.u - 0x3f000000));
+		}
+
+		// rebias the exponent from 127 to 15 and round the mantissa to nearest even
+		return (ushort)(sign | ((absBits + 0xc8000fff + ((absBits >> 13) & 1)) >> 13));
+#endif
+	}
+
+	_CPU_AND_GPU_CODE_ static float toFloat(ushort bits)
+	{
+#ifdef ITM_HALF_F16C
+		return _cvtsh_ss(bits);
+#else
+		union { float f; uint u; } value;
+
+		uint sign = (uint)(bits & 0x8000) << 16, exponent = (bits >> 10) & 0x1f, mantissa = bits & 0x3ff;
+
+		if (exponent == 0)
+		{
+			value.f = (float)mantissa * (1.0f / 16777216.0f);
+			value.u |= sign;
+		}
+		else if (exponent == 31) value.u = sign | 0x7f800000 | (mantissa << 13);
+		else value.u = sign | ((exponent + 112) << 23) | (mantissa << 13);
+
+		return value.f;
+#endif
+	}
+};
+
 /** \brief
     Stores the information of a single voxel in the volume
 */
@@ -16,6 +83,7 @@ struct ITMVoxel_f_rgb
 	static const CONSTPTR(bool) hasColorInformation = true;
 	static const CONSTPTR(bool) hasConfidenceInformation = false;
 	static const CONSTPTR(bool) hasSemanticInformation = false;
+	static const CONSTPTR(bool) hasSeparateColourInformation = false;
 
 	/** Value of the truncated signed distance transformation. */
 	float sdf;
@@ -47,6 +115,7 @@ struct ITMVoxel_s_rgb
 	static const CONSTPTR(bool) hasColorInformation = true;
 	static const CONSTPTR(bool) hasConfidenceInformation = false;
 	static const CONSTPTR(bool) hasSemanticInformation = false;
+	static const CONSTPTR(bool) hasSeparateColourInformation = false;
 
 	/** Value of the truncated signed distance transformation. */
 	short sdf;
@@ -77,6 +146,7 @@ struct ITMVoxel_s
 	static const CONSTPTR(bool) hasColorInformation = false;
 	static const CONSTPTR(bool) hasConfidenceInformation = false;
 	static const CONSTPTR(bool) hasSemanticInformation = false;
+	static const CONSTPTR(bool) hasSeparateColourInformation = false;
 
 	/** Value of the truncated signed distance transformation. */
 	short sdf;
@@ -101,6 +171,7 @@ struct ITMVoxel_f
 	static const CONSTPTR(bool) hasColorInformation = false;
 	static const CONSTPTR(bool) hasConfidenceInformation = false;
 	static const CONSTPTR(bool) hasSemanticInformation = false;
+	static const CONSTPTR(bool) hasSeparateColourInformation = false;
 
 	/** Value of the truncated signed distance transformation. */
 	float sdf;
@@ -125,6 +196,7 @@ struct ITMVoxel_f_conf
 	static const CONSTPTR(bool) hasColorInformation = false;
 	static const CONSTPTR(bool) hasConfidenceInformation = true;
 	static const CONSTPTR(bool) hasSemanticInformation = false;
+	static const CONSTPTR(bool) hasSeparateColourInformation = false;
 
 	/** Value of the truncated signed distance transformation. */
 	float sdf;
@@ -142,3 +214,165 @@ struct ITMVoxel_f_conf
 	}
 };
 
+/** \brief
+    Depth only voxel in two bytes, for scenes that are limited by
+    memory bandwidth rather than precision. The sdf, which is
+    relative to mu, is quantised to 8 bits and shares a 16 bit word
+    with the weight, so maxW must not exceed 255.
+*/
+struct ITMVoxel_u8
+{
+	_CPU_AND_GPU_CODE_ static signed char SDF_initialValue() { return 127; }
+	_CPU_AND_GPU_CODE_ static float valueToFloat(float x) { return (float)(x) / 127.0f; }
+	// rounded rather than truncated, as the steps are too coarse for the running average otherwise
+	_CPU_AND_GPU_CODE_ static signed char floatToValue(float x) { return (signed char)((x) * 127.0f + ((x) >= 0.0f ? 0.5f : -0.5f)); }
+
+	static const CONSTPTR(bool) hasColorInformation = false;
+	static const CONSTPTR(bool) hasConfidenceInformation = false;
+	static const CONSTPTR(bool) hasSemanticInformation = false;
+	static const CONSTPTR(bool) hasSeparateColourInformation = false;
+
+	/** Value of the truncated signed distance transformation. */
+	signed char sdf;
+	/** Number of fused observations that make up @p sdf. */
+	uchar w_depth;
+
+	_CPU_AND_GPU_CODE_ ITMVoxel_u8()
+	{
+		sdf = SDF_initialValue();
+		w_depth = 0;
+	}
+};
+
+/** \brief
+    Depth only voxel with the sdf stored as a half precision float.
+    It takes as much memory as ITMVoxel_s, but keeps the relative
+    precision of a float close to the surface.
+*/
+struct ITMVoxel_h
+{
+	_CPU_AND_GPU_CODE_ static ITMHalf SDF_initialValue() { return ITMHalf(1.0f); }
+	_CPU_AND_GPU_CODE_ static float valueToFloat(float x) { return x; }
+	_CPU_AND_GPU_CODE_ static ITMHalf floatToValue(float x) { return ITMHalf(x); }
+
+	static const CONSTPTR(bool) hasColorInformation = false;
+	static const CONSTPTR(bool) hasConfidenceInformation = false;
+	static const CONSTPTR(bool) hasSemanticInformation = false;
+	static const CONSTPTR(bool) hasSeparateColourInformation = false;
+
+	/** Value of the truncated signed distance transformation. */
+	ITMHalf sdf;
+	/** Number of fused observations that make up @p sdf. */
+	uchar w_depth;
+	/** Padding that may or may not improve performance on certain GPUs */
+	//uchar pad;
+
+	_CPU_AND_GPU_CODE_ ITMVoxel_h()
+	{
+		sdf = SDF_initialValue();
+		w_depth = 0;
+	}
+};
+
+/** \brief
+    Colour of a voxel whose type keeps it apart from the geometry,
+    see hasSeparateColourInformation. The colour stream is indexed
+    exactly like the voxel blocks, so readVoxel() and
+    readFromSDF_color4u_interpolated() work on it unchanged.
+*/
+struct ITMVoxelColour
+{
+	static const CONSTPTR(bool) hasColorInformation = true;
+	static const CONSTPTR(bool) hasConfidenceInformation = false;
+	static const CONSTPTR(bool) hasSemanticInformation = false;
+	static const CONSTPTR(bool) hasSeparateColourInformation = false;
+
+	/** RGB colour information stored for this voxel. */
+	Vector3u clr;
+	/** Number of observations that made up @p clr. */
+	uchar w_color;
+
+	_CPU_AND_GPU_CODE_ ITMVoxelColour()
+	{
+		clr = Vector3u((uchar)0);
+		w_color = 0;
+	}
+};
+
+/** \brief
+    Geometry of an ITMVoxel_s_rgb whose colour is stored in a
+    separate ITMVoxelColour array. Tracking, raycasting and meshing
+    only touch the three bytes of geometry per voxel, the colour is
+    read when rendering colour from the volume. Host memory only.
+*/
+struct ITMVoxel_s_rgb_split
+{
+	_CPU_AND_GPU_CODE_ static short SDF_initialValue() { return 32767; }
+	_CPU_AND_GPU_CODE_ static float valueToFloat(float x) { return (float)(x) / 32767.0f; }
+	_CPU_AND_GPU_CODE_ static short floatToValue(float x) { return (short)((x) * 32767.0f); }
+
+	static const CONSTPTR(bool) hasColorInformation = false;
+	static const CONSTPTR(bool) hasConfidenceInformation = false;
+	static const CONSTPTR(bool) hasSemanticInformation = false;
+	static const CONSTPTR(bool) hasSeparateColourInformation = true;
+
+	/** Value of the truncated signed distance transformation. */
+	short sdf;
+	/** Number of fused observations that make up @p sdf. */
+	uchar w_depth;
+
+	_CPU_AND_GPU_CODE_ ITMVoxel_s_rgb_split()
+	{
+		sdf = SDF_initialValue();
+		w_depth = 0;
+	}
+};
+
+/** \brief
+    Geometry of an ITMVoxel_f_rgb whose colour is stored in a
+    separate ITMVoxelColour array, see ITMVoxel_s_rgb_split.
+*/
+struct ITMVoxel_f_rgb_split
+{
+	_CPU_AND_GPU_CODE_ static float SDF_initialValue() { return 1.0f; }
+	_CPU_AND_GPU_CODE_ static float valueToFloat(float x) { return x; }
+	_CPU_AND_GPU_CODE_ static float floatToValue(float x) { return x; }
+
+	static const CONSTPTR(bool) hasColorInformation = false;
+	static const CONSTPTR(bool) hasConfidenceInformation = false;
+	static const CONSTPTR(bool) hasSemanticInformation = false;
+	static const CONSTPTR(bool) hasSeparateColourInformation = true;
+
+	/** Value of the truncated signed distance transformation. */
+	float sdf;
+	/** Number of fused observations that make up @p sdf. */
+	uchar w_depth;
+
+	_CPU_AND_GPU_CODE_ ITMVoxel_f_rgb_split()
+	{
+		sdf = SDF_initialValue();
+		w_depth = 0;
+	}
+};
+
+/** \brief
+    Type of the voxels that hold the colour of a TVoxel: TVoxel
+    itself, or ITMVoxelColour if TVoxel keeps its colour apart.
+*/
+template<class TVoxel, bool hasSeparateColour = TVoxel::hasSeparateColourInformation>
+struct ITMColourVoxel
+{
+	typedef TVoxel Type;
+
+	static Type *Select(TVoxel *voxels, Type *colours) { return voxels; }
+	static const Type *Select(const TVoxel *voxels, const Type *colours) { return voxels; }
+};
+
+template<class TVoxel>
+struct ITMColourVoxel<TVoxel, true>
+{
+	typedef ITMVoxelColour Type;
+
+	static Type *Select(TVoxel *voxels, Type *colours) { return colours; }
+	static const Type *Select(const TVoxel *voxels, const Type *colours) { return colours; }
+};
@@ -35,6 +35,12 @@ namespace ITMLib
 		/// Current pose of the depth camera.
 		ORUtils::SE3Pose *pose_d;
 
+		/// Pose of the depth camera at the previous frame, see StorePreviousPose().
+		ORUtils::SE3Pose *pose_d_prev;
+
+		/// Whether pose_d_prev has been stored since the last reset.
+		bool hasPreviousPose;
+
 		/// Tracking quality: 1.0: success, 0.0: failure
 		enum TrackingResult
 		{
@@ -71,10 +77,37 @@ namespace ITMLib
 			return false;
 		}
 
+		/// Remembers the current pose, called once per frame after the pose has been finalised.
+		void StorePreviousPose(void)
+		{
+			pose_d_prev->SetFrom(pose_d);
+			hasPreviousPose = true;
+		}
+
+		/** \brief
+		    Extrapolates the pose of the depth camera @p noFrames
+		    frames ahead, assuming that it keeps moving as it did
+		    between the previous and the current frame. Without a
+		    previous pose this is the current pose.
+		*/
+		void PredictPose(ORUtils::SE3Pose *predictedPose, int noFrames) const
+		{
+			Matrix4f M = pose_d->GetM();
+
+			if (hasPreviousPose)
+			{
+				Matrix4f motion = M * pose_d_prev->GetInvM();
+				for (int i = 0; i < noFrames; i++) M = motion * M;
+			}
+
+			predictedPose->SetM(M);
+		}
+
 		ITMTrackingState(Vector2i imgSize, MemoryDeviceType memoryType)
 		: pointCloud(new ITMPointCloud(imgSize, memoryType)),
 			pose_pointCloud(new ORUtils::SE3Pose),
-			pose_d(new ORUtils::SE3Pose)
+			pose_d(new ORUtils::SE3Pose),
+			pose_d_prev(new ORUtils::SE3Pose)
 		{
 			Reset();
 		}
@@ -83,6 +116,7 @@ namespace ITMLib
 		{
 			delete pointCloud;
 			delete pose_d;
+			delete pose_d_prev;
 			delete pose_pointCloud;
 		}
 
@@ -90,7 +124,9 @@ namespace ITMLib
 		{
 			this->age_pointCloud = -1;
 			this->pose_d->SetFrom(0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+			this->pose_d_prev->SetFrom(0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
 			this->pose_pointCloud->SetFrom(0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+			this->hasPreviousPose = false;
 			this->trackerResult = TRACKING_GOOD;
 			this->trackerScore = 0.0f;
 		}
@@ -38,12 +38,23 @@ ITMLibSettings::ITMLibSettings(void)
 	/// enable or disable bilateral depth filtering
 	useBilateralFilter = false;
 
+	/// print the fill state of the voxel block hash after every frame - needs a pass over the whole table
+	reportHashStatistics = false;
+
+	/// only integrate when the camera moved by 1cm or 2 degrees, 5% of the depth image changed or after 30 skipped frames
+	/// - for fixed cameras, the skipped frames are still tracked against the last raycast
+	useMotionGatedFusion = false;
+	fusionMinTranslation = 0.01f;
+	fusionMinRotation = static_cast<float>(2 * M_PI / 180);
+	fusionMinDepthChange = 0.05f;
+	fusionMaxSkippedFrames = 30;
+
 	/// what to do on tracker failure: ignore, relocalise or stop integration - not supported in loop closure version
 	behaviourOnFailure = FAILUREMODE_IGNORE;
 
 	/// switch between various library modes - basic, with loop closure, etc.
-	libMode = LIBMODE_BASIC;
-	//libMode = LIBMODE_BASIC_SURFELS;
+	SetLibMode(LIBMODE_BASIC);
+	//SetLibMode(LIBMODE_BASIC_SURFELS);
 
 	//// Default ICP tracking
 	//trackerConfig = "type=icp,levels=rrrbb,minstep=1e-3,"
@@ -77,6 +88,25 @@ ITMLibSettings::ITMLibSettings(void)
 	}
 }
 
+void ITMLibSettings::SetLibMode(LibMode libMode)
+{
+	this->libMode = libMode;
+
+	/// the loop closure version keeps one scene per local map, so each of them gets a smaller voxel block hash
+	if (libMode == LIBMODE_LOOPCLOSURE)
+	{
+		sceneParams.localBlockNum = 0x10000;
+		sceneParams.hashBucketNum = 0x40000;
+		sceneParams.excessListSize = 0x8000;
+	}
+	else
+	{
+		sceneParams.localBlockNum = ITMSceneParams::defaultLocalBlockNum;
+		sceneParams.hashBucketNum = ITMSceneParams::defaultHashBucketNum;
+		sceneParams.excessListSize = ITMSceneParams::defaultExcessListSize;
+	}
+}
+
 MemoryDeviceType ITMLibSettings::GetMemoryType() const
 {
 	return deviceType == ITMLibSettings::DEVICE_CUDA ? MEMORYDEVICE_CUDA : MEMORYDEVICE_CPU;
@@ -50,6 +50,21 @@ namespace ITMLib
 		bool skipPoints;
 
 		bool createMeshingEngine;
+
+		/// Print the fill state of the scene index after every frame, see ITMHashStatistics.
+		bool reportHashStatistics;
+
+		/// Only fuse frames that differ from the last fused one, see ITMFusionGate.
+		bool useMotionGatedFusion;
+
+		/// Camera motion in metres and radians since the last fused frame above which a frame is fused.
+		float fusionMinTranslation, fusionMinRotation;
+
+		/// Fraction of depth pixels changed by more than mu since the last fused frame above which a frame is fused.
+		float fusionMinDepthChange;
+
+		/// Frames skipped in a row after which a frame is fused regardless.
+		int fusionMaxSkippedFrames;
         
 		FailureMode behaviourOnFailure;
 		SwappingMode swappingMode;
@@ -69,5 +84,8 @@ namespace ITMLib
 		ITMLibSettings& operator=(const ITMLibSettings&);
 
 		MemoryDeviceType GetMemoryType() const;
+
+		/// Select the library mode, also sizes the voxel block hash for it - call before changing sceneParams
+		void SetLibMode(LibMode libMode);
 	};
 }
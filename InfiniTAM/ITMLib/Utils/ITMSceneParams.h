@@ -2,6 +2,8 @@
 
 #pragma once
 
+#include <string>
+
 namespace ITMLib
 {
 	/** \brief
@@ -42,16 +44,95 @@ namespace ITMLib
 		/** Stop integration once maxW has been reached. */
 		bool stopIntegratingAtMaxW;
 
+		/** @{ */
+		/** \brief
+		    Capacity of the voxel block hash: @p localBlockNum
+		    voxel blocks are held in the local voxel block array,
+		    @p hashBucketNum buckets (must be a power of two and
+		    larger than @p localBlockNum) are addressed by the
+		    hash function and @p excessListSize entries are kept
+		    for resolving collisions.
+		*/
+		int localBlockNum, hashBucketNum, excessListSize;
+		/** @} */
+
+		/** @{ */
+		/** Default capacity of the voxel block hash, see @ref localBlockNum. */
+		static const int defaultLocalBlockNum = 0x40000, defaultHashBucketNum = 0x100000, defaultExcessListSize = 0x20000;
+		/** @} */
+
+		/** \brief
+		    Memory for the local voxel block array is committed
+		    in pages of @p localBlockPageSize voxel blocks as the
+		    scene grows, up to @ref localBlockNum blocks. A value
+		    of zero commits all blocks up front.
+		*/
+		int localBlockPageSize;
+
+		/** \brief
+		    Voxel blocks swapped out of the local voxel block
+		    array are kept in main memory by default. If
+		    @p swapDirectory is set, they are instead written
+		    to a temporary file in that directory, so that the
+		    size of the mapped area is bounded by disk space.
+		*/
+		std::string swapDirectory;
+
+		/** \brief
+		    Swapped out voxel blocks are stored with the sdf
+		    quantised to @p swapSdfBits bits, either 16 or 8.
+		    With 16 bits the default short voxels are stored
+		    without loss, 8 bits trade some precision of the
+		    swapped out sdf values for less memory.
+		*/
+		int swapSdfBits;
+
+		/** \brief
+		    With swapping enabled, voxel blocks that become
+		    visible from the camera pose extrapolated
+		    @p swapPrefetchFrames frames ahead are swapped in
+		    before they are observed. Zero disables this.
+		*/
+		int swapPrefetchFrames;
+
+		/** \brief
+		    Every @p freeEmptyBlocksInterval frames, the voxel
+		    blocks that are out of view and hold no surface are
+		    returned to the free lists, so that long sessions
+		    do not run out of voxel blocks. Zero, the default,
+		    disables this.
+		*/
+		int freeEmptyBlocksInterval;
+
+		/** \brief
+		    Keep links from each voxel block to its neighbours,
+		    see ITMVoxelBlockHash::GetNeighbourLinks(), so that
+		    raycasting and meshing on the CPU find neighbouring
+		    blocks without hash lookups. Costs 109 bytes per
+		    block of the local voxel block array.
+		*/
+		bool useNeighbourBlockLinks;
+
 		ITMSceneParams(void) {}
 
 		ITMSceneParams(float mu, int maxW, float voxelSize, 
-			float viewFrustum_min, float viewFrustum_max, bool stopIntegratingAtMaxW)
+			float viewFrustum_min, float viewFrustum_max, bool stopIntegratingAtMaxW,
+			int localBlockNum = defaultLocalBlockNum, int hashBucketNum = defaultHashBucketNum, int excessListSize = defaultExcessListSize,
+			int localBlockPageSize = 0x4000)
 		{
 			this->mu = mu;
 			this->maxW = maxW;
 			this->voxelSize = voxelSize;
 			this->viewFrustum_min = viewFrustum_min; this->viewFrustum_max = viewFrustum_max;
 			this->stopIntegratingAtMaxW = stopIntegratingAtMaxW;
+			this->localBlockNum = localBlockNum;
+			this->hashBucketNum = hashBucketNum;
+			this->excessListSize = excessListSize;
+			this->localBlockPageSize = localBlockPageSize;
+			this->swapSdfBits = 16;
+			this->swapPrefetchFrames = 5;
+			this->freeEmptyBlocksInterval = 0;
+			this->useNeighbourBlockLinks = false;
 		}
 
 		explicit ITMSceneParams(const ITMSceneParams *sceneParams) { this->SetFrom(sceneParams); }
@@ -64,6 +145,15 @@ namespace ITMLib
 			this->mu = sceneParams->mu;
 			this->maxW = sceneParams->maxW;
 			this->stopIntegratingAtMaxW = sceneParams->stopIntegratingAtMaxW;
+			this->localBlockNum = sceneParams->localBlockNum;
+			this->hashBucketNum = sceneParams->hashBucketNum;
+			this->excessListSize = sceneParams->excessListSize;
+			this->localBlockPageSize = sceneParams->localBlockPageSize;
+			this->swapDirectory = sceneParams->swapDirectory;
+			this->swapSdfBits = sceneParams->swapSdfBits;
+			this->swapPrefetchFrames = sceneParams->swapPrefetchFrames;
+			this->freeEmptyBlocksInterval = sceneParams->freeEmptyBlocksInterval;
+			this->useNeighbourBlockLinks = sceneParams->useNeighbourBlockLinks;
 		}
 	};
 }
@@ -0,0 +1,122 @@
+// Copyright 2014-2017 Oxford University Innovation Limited and the authors of InfiniTAM
+
+#include "MappedFile.h"
+
+#include <stdexcept>
+#include <vector>
+
+#if defined _MSC_VER
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace ORUtils;
+
+MappedFile::MappedFile(const std::string &directory)
+{
+	fileSize = 0;
+
+	std::string prefix = directory.empty() ? std::string(".") : directory;
+	if (prefix[prefix.size() - 1] != '/' && prefix[prefix.size() - 1] != '\\') prefix += '/';
+
+#if defined _MSC_VER
+	char fileName[MAX_PATH];
+	if (GetTempFileNameA(prefix.c_str(), "itm", 0, fileName) == 0)
+		throw std::runtime_error("Could not create a temporary file in " + directory);
+
+	HANDLE file = CreateFileA(fileName, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+		FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		DeleteFileA(fileName);
+		throw std::runtime_error("Could not create a temporary file in " + directory);
+	}
+
+	handle = (intptr_t)file;
+#else
+	std::string pattern = prefix + "itm_XXXXXX";
+	std::vector<char> fileName(pattern.begin(), pattern.end());
+	fileName.push_back('\0');
+
+	int fd = mkstemp(&fileName[0]);
+	if (fd < 0) throw std::runtime_error("Could not create a temporary file in " + directory);
+
+	// the open descriptor keeps the file alive, its space is reclaimed when it is closed
+	unlink(&fileName[0]);
+
+	handle = (intptr_t)fd;
+#endif
+}
+
+MappedFile::~MappedFile(void)
+{
+#if defined _MSC_VER
+	CloseHandle((HANDLE)handle);
+#else
+	close((int)handle);
+#endif
+}
+
+size_t MappedFile::GetAllocationGranularity(void)
+{
+#if defined _MSC_VER
+	SYSTEM_INFO systemInfo;
+	GetSystemInfo(&systemInfo);
+	return systemInfo.dwAllocationGranularity;
+#else
+	return (size_t)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+void *MappedFile::Map(size_t offset, size_t size)
+{
+	if (offset % GetAllocationGranularity() != 0)
+		throw std::runtime_error("File mappings must start at a multiple of the allocation granularity");
+
+	size_t end = offset + size;
+
+#if defined _MSC_VER
+	// the mapping object extends the file, the view keeps it alive after the handle is closed
+	HANDLE mapping = CreateFileMappingA((HANDLE)handle, NULL, PAGE_READWRITE,
+		(DWORD)((unsigned long long)end >> 32), (DWORD)(end & 0xffffffff), NULL);
+	if (mapping == NULL) throw std::runtime_error("Could not grow the mapped file");
+
+	void *ptr = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS,
+		(DWORD)((unsigned long long)offset >> 32), (DWORD)(offset & 0xffffffff), size);
+	CloseHandle(mapping);
+	if (ptr == NULL) throw std::runtime_error("Could not map file");
+#else
+	if (end > fileSize)
+	{
+		// reserve the disk space now, running out of it while writing to the mapping would raise SIGBUS
+#if defined __linux__
+		if (posix_fallocate((int)handle, (off_t)fileSize, (off_t)(end - fileSize)) != 0)
+			throw std::runtime_error("Could not grow the mapped file");
+#else
+		if (ftruncate((int)handle, (off_t)end) != 0)
+			throw std::runtime_error("Could not grow the mapped file");
+#endif
+	}
+
+	void *ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, (int)handle, (off_t)offset);
+	if (ptr == MAP_FAILED) throw std::runtime_error("Could not map file");
+#endif
+
+	if (end > fileSize) fileSize = end;
+	return ptr;
+}
+
+void MappedFile::Unmap(void *ptr, size_t size)
+{
+	if (ptr == NULL) return;
+
+#if defined _MSC_VER
+	UnmapViewOfFile(ptr);
+#else
+	munmap(ptr, size);
+#endif
+}
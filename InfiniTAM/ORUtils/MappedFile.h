@@ -0,0 +1,45 @@
+// Copyright 2014-2017 Oxford University Innovation Limited and the authors of InfiniTAM
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+namespace ORUtils
+{
+	/** \brief
+	    Anonymous temporary file whose contents are accessed through
+	    memory mappings. The file is created in a given directory and
+	    removed again by the operating system once it is closed, so
+	    nothing is left behind if the process terminates. Regions are
+	    mapped individually, so pointers into a region stay valid while
+	    the file grows.
+	*/
+	class MappedFile
+	{
+	private:
+		intptr_t handle;
+		size_t fileSize;
+
+	public:
+		/** Creates an empty temporary file in @p directory. */
+		explicit MappedFile(const std::string &directory);
+		~MappedFile(void);
+
+		/** Granularity (in bytes) to which the offsets passed to Map must be aligned. */
+		static size_t GetAllocationGranularity(void);
+
+		/** Grows the file to cover [@p offset, @p offset + @p size) if needed and maps that region read-write. */
+		void *Map(size_t offset, size_t size);
+
+		/** Unmaps a region previously obtained from Map. */
+		static void Unmap(void *ptr, size_t size);
+
+		size_t GetFileSize(void) const { return fileSize; }
+
+		// Suppress the default copy constructor and assignment operator
+		MappedFile(const MappedFile&);
+		MappedFile& operator=(const MappedFile&);
+	};
+}
@@ -0,0 +1,109 @@
+// Copyright 2014-2017 Oxford University Innovation Limited and the authors of InfiniTAM
+
+#include "VirtualMemory.h"
+
+#include <stdexcept>
+
+#if defined _MSC_VER
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#ifndef MAP_NORESERVE
+#define MAP_NORESERVE 0
+#endif
+#endif
+
+using namespace ORUtils;
+
+size_t VirtualMemory::GetPageSize(void)
+{
+#if defined _MSC_VER
+	SYSTEM_INFO systemInfo;
+	GetSystemInfo(&systemInfo);
+	return systemInfo.dwPageSize;
+#else
+	return (size_t)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+void *VirtualMemory::Reserve(size_t size)
+{
+#if defined _MSC_VER
+	void *ptr = VirtualAlloc(NULL, size, MEM_RESERVE, PAGE_NOACCESS);
+	if (ptr == NULL) throw std::runtime_error("Could not reserve address space");
+#else
+	void *ptr = mmap(NULL, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (ptr == MAP_FAILED) throw std::runtime_error("Could not reserve address space");
+#endif
+	return ptr;
+}
+
+void VirtualMemory::Commit(void *ptr, size_t size)
+{
+	if (size == 0) return;
+
+	size_t pageSize = GetPageSize();
+	size_t begin = (size_t)ptr & ~(pageSize - 1);
+	size_t end = ((size_t)ptr + size + pageSize - 1) & ~(pageSize - 1);
+
+#if defined _MSC_VER
+	if (VirtualAlloc((void*)begin, end - begin, MEM_COMMIT, PAGE_READWRITE) == NULL)
+		throw std::runtime_error("Could not commit memory");
+#else
+	if (mprotect((void*)begin, end - begin, PROT_READ | PROT_WRITE) != 0)
+		throw std::runtime_error("Could not commit memory");
+#endif
+}
+
+void VirtualMemory::Decommit(void *ptr, size_t size)
+{
+	size_t pageSize = GetPageSize();
+	size_t begin = ((size_t)ptr + pageSize - 1) & ~(pageSize - 1);
+	size_t end = ((size_t)ptr + size) & ~(pageSize - 1);
+	if (end <= begin) return;
+
+#if defined _MSC_VER
+	VirtualFree((void*)begin, end - begin, MEM_DECOMMIT);
+#else
+	// replacing the pages instead of just discarding them also drops any file mapping
+	mmap((void*)begin, end - begin, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+#endif
+}
+
+bool VirtualMemory::MapFile(void *ptr, size_t size, const std::string &fileName, size_t offset)
+{
+	size_t pageSize = GetPageSize();
+	if ((size_t)ptr % pageSize != 0 || offset % pageSize != 0)
+		throw std::runtime_error("File mappings must start at a multiple of the page size");
+
+#if defined _MSC_VER
+	// views cannot be placed into address space reserved with VirtualAlloc
+	return false;
+#else
+	int fd = open(fileName.c_str(), O_RDONLY);
+	if (fd < 0) throw std::runtime_error("Could not open " + fileName + " for mapping");
+
+	// the mapping keeps the file alive, the descriptor is not needed any more
+	void *mapped = mmap(ptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, (off_t)offset);
+	close(fd);
+
+	if (mapped == MAP_FAILED) throw std::runtime_error("Could not map " + fileName);
+	return true;
+#endif
+}
+
+void VirtualMemory::Release(void *ptr, size_t size)
+{
+	if (ptr == NULL) return;
+
+#if defined _MSC_VER
+	VirtualFree(ptr, 0, MEM_RELEASE);
+#else
+	munmap(ptr, size);
+#endif
+}
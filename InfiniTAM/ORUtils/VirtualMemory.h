@@ -0,0 +1,44 @@
+// Copyright 2014-2017 Oxford University Innovation Limited and the authors of InfiniTAM
+
+#pragma once
+
+#include <stddef.h>
+#include <string>
+
+namespace ORUtils
+{
+	/** \brief
+	    Thin wrappers around the operating system's virtual memory
+	    interface. Address space is reserved once and physical memory
+	    is then committed and decommitted in pieces, so that pointers
+	    into the reserved range stay valid for its whole lifetime.
+	*/
+	namespace VirtualMemory
+	{
+		/** Granularity (in bytes) at which memory can be committed and decommitted. */
+		size_t GetPageSize(void);
+
+		/** Reserves @p size bytes of address space without committing any memory to it. */
+		void *Reserve(size_t size);
+
+		/** Makes the pages covering [@p ptr, @p ptr + @p size) readable and writable. */
+		void Commit(void *ptr, size_t size);
+
+		/** Returns the pages fully contained in [@p ptr, @p ptr + @p size) to the operating system, this also drops file mappings made by MapFile. */
+		void Decommit(void *ptr, size_t size);
+
+		/** \brief
+		    Maps @p size bytes of @p fileName, starting at @p offset,
+		    copy-on-write to @p ptr inside a reserved range. Writes go
+		    to private memory and never reach the file. Both @p ptr
+		    and @p offset have to be multiples of GetPageSize().
+
+		    \return false if the platform cannot map files into
+		    reserved address space, the range is left untouched then
+		*/
+		bool MapFile(void *ptr, size_t size, const std::string &fileName, size_t offset);
+
+		/** Releases a range previously obtained from Reserve. */
+		void Release(void *ptr, size_t size);
+	}
+}
@@ -0,0 +1,9 @@
+###############################
+# OfferMortonVoxelOrder.cmake #
+###############################
+
+OPTION(USE_MORTON_VOXEL_ORDER "Store the voxels of a block in Z-order?" OFF)
+
+IF(USE_MORTON_VOXEL_ORDER)
+  ADD_DEFINITIONS(-DUSE_MORTON_VOXEL_ORDER)
+ENDIF()